@@ -0,0 +1,66 @@
+// bench/bench_arena.c
+// Load time of files with many objects, heap against arena storage. Each
+// object's faces are large enough to get an arena block of their own.
+// Configure with -DENABLE_ASAN=OFF for meaningful numbers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "wavefront.h"
+
+#define FACES_PER_OBJECT 400
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char* make_objects(size_t objects, size_t* size) {
+  char*  obj = malloc(16 * (FACES_PER_OBJECT + 2)
+                      + objects * (24 + 32 * FACES_PER_OBJECT));
+  size_t n   = 0;
+  if (!obj)
+    return NULL;
+  for (int i = 0; i < FACES_PER_OBJECT + 2; i++)
+    n += sprintf(obj + n, "v %d 0 0\n", i);
+  for (size_t o = 0; o < objects; o++) {
+    n += sprintf(obj + n, "o part%zu\n", o);
+    for (int i = 1; i <= FACES_PER_OBJECT; i++)
+      n += sprintf(obj + n, "f %d %d %d\n", i, i + 1, i + 2);
+  }
+  *size = n;
+  return obj;
+}
+
+static double load_seconds(const char* obj, size_t size, int use_arena) {
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.use_arena = use_arena;
+  wf_scene_t scene;
+  double     start = now_seconds();
+  if (wf_load_obj_from_memory(obj, size, &scene, &options) != WF_SUCCESS)
+    return -1.0;
+  double elapsed = now_seconds() - start;
+  wf_free_scene(&scene);
+  return elapsed;
+}
+
+int main(void) {
+  static const size_t counts[] = { 5000, 10000, 20000 };
+  wf_set_log_callback(NULL, NULL);
+
+  printf("%10s %10s %10s\n", "objects", "heap ms", "arena ms");
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    size_t size;
+    char*  obj = make_objects(counts[c], &size);
+    if (!obj)
+      return 1;
+    double heap  = load_seconds(obj, size, 0);
+    double arena = load_seconds(obj, size, 1);
+    free(obj);
+    if (heap < 0.0 || arena < 0.0)
+      return 1;
+    printf("%10zu %10.1f %10.1f\n", counts[c], heap * 1e3, arena * 1e3);
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+// bench/bench_bvh.c
+// BVH build time against triangle count, on one thread and on every
+// processor, plus ray throughput of the result. Configure with
+// -DENABLE_ASAN=OFF for meaningful numbers.
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "wavefront.h"
+
+#define RAY_COUNT 100000
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float next_float(unsigned* seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  return (*seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// Small triangles scattered through the unit cube
+static void make_soup(wf_scene_t* scene, wf_face* tris, size_t count) {
+  unsigned seed = 12345;
+  for (size_t i = 0; i < count; i++) {
+    wf_vec3 c = { next_float(&seed), next_float(&seed), next_float(&seed) };
+    for (int j = 0; j < 3; j++) {
+      wf_vec3* v = &scene->vertices[3 * i + j];
+      v->x       = c.x + (next_float(&seed) - 0.5f) * 0.02f;
+      v->y       = c.y + (next_float(&seed) - 0.5f) * 0.02f;
+      v->z       = c.z + (next_float(&seed) - 0.5f) * 0.02f;
+      tris[i].vertices[j].v_idx = (int)(3 * i + j);
+    }
+  }
+  scene->vertex_count = 3 * count;
+}
+
+int main(void) {
+  static const size_t counts[] = { 16384, 65536, 262144, 1048576 };
+  size_t              max      = counts[3];
+  wf_scene_t          scene    = { 0 };
+  wf_face*            tris     = calloc(max, sizeof(wf_face));
+  scene.vertices               = malloc(3 * max * sizeof(wf_vec3));
+  if (!tris || !scene.vertices)
+    return 1;
+
+  printf("%10s %10s %12s %12s %12s\n", "triangles", "nodes", "1 thread ms",
+         "all ms", "Mrays/s");
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    make_soup(&scene, tris, counts[c]);
+
+    wf_bvh_options_t options = { .num_threads = 1 };
+    wf_bvh_t         bvh;
+    double           start = now_seconds();
+    if (wf_bvh_build(&scene, tris, counts[c], &options, &bvh) != WF_SUCCESS)
+      return 1;
+    double serial = now_seconds() - start;
+    wf_free_bvh(&bvh);
+
+    options.num_threads = 0;
+    start               = now_seconds();
+    if (wf_bvh_build(&scene, tris, counts[c], &options, &bvh) != WF_SUCCESS)
+      return 1;
+    double parallel = now_seconds() - start;
+
+    unsigned seed = 777;
+    size_t   hits = 0;
+    start         = now_seconds();
+    for (int r = 0; r < RAY_COUNT; r++) {
+      wf_vec3      o = { next_float(&seed), next_float(&seed), -1.0f };
+      wf_vec3      d = { next_float(&seed) - 0.5f, next_float(&seed) - 0.5f,
+                         1.0f };
+      wf_bvh_hit_t hit;
+      hits += wf_bvh_intersect(&bvh, o, d, FLT_MAX, &hit);
+    }
+    double trace = now_seconds() - start;
+
+    printf("%10zu %10zu %12.2f %12.2f %12.2f (%zu hits)\n", counts[c],
+           bvh.node_count, serial * 1e3, parallel * 1e3,
+           RAY_COUNT / trace * 1e-6, hits);
+    wf_free_bvh(&bvh);
+  }
+
+  free(tris);
+  free(scene.vertices);
+  return 0;
+}
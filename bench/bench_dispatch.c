@@ -0,0 +1,98 @@
+// bench/bench_dispatch.c
+// Keyword recognition: first-byte switch against the linear strncmp scan it
+// replaced. Configure with -DENABLE_ASAN=OFF for meaningful numbers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "obj_keyword.h"
+
+#define LINE_COUNT 100000
+#define ROUNDS     50
+
+// Previous dispatch table, longest commands first
+static const struct {
+  const char* command;
+  size_t      command_len;
+} LINEAR_COMMANDS[] = {
+  { "usemtl", 6 }, { "mtllib", 6 }, { "cstype", 6 }, { "parm", 4 },
+  { "trim", 4 },   { "hole", 4 },   { "scrv", 4 },   { "surf", 4 },
+  { "curv", 4 },   { "bmat", 4 },   { "step", 4 },   { "deg", 3 },
+  { "end", 3 },    { "tex", 3 },    { "vp", 2 },     { "vt", 2 },
+  { "vn", 2 },     { "sp", 2 },     { "f", 1 },      { "o", 1 },
+  { "g", 1 },      { "s", 1 },      { "l", 1 },      { "v", 1 },
+  { NULL, 0 }
+};
+
+static int linear_match(const char* line, size_t line_len) {
+  for (int i = 0; LINEAR_COMMANDS[i].command; i++) {
+    if (LINEAR_COMMANDS[i].command_len <= line_len
+        && strncmp(line, LINEAR_COMMANDS[i].command,
+                   LINEAR_COMMANDS[i].command_len)
+               == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Line mix of a typical textured, lit mesh
+static const char* sample_line(unsigned r) {
+  r %= 100;
+  if (r < 45)
+    return "v 0.125 -1.5 3.75";
+  if (r < 60)
+    return "vt 0.5 0.25";
+  if (r < 75)
+    return "vn 0 1 0";
+  if (r < 97)
+    return "f 1/1/1 2/2/2 3/3/3";
+  if (r < 98)
+    return "usemtl material";
+  if (r < 99)
+    return "s 1";
+  return "g group";
+}
+
+int main(void) {
+  const char** lines   = malloc(LINE_COUNT * sizeof(char*));
+  size_t*      lengths = malloc(LINE_COUNT * sizeof(size_t));
+  if (!lines || !lengths)
+    return 1;
+
+  unsigned seed = 12345;
+  for (size_t i = 0; i < LINE_COUNT; i++) {
+    seed       = seed * 1103515245u + 12345u;
+    lines[i]   = sample_line(seed >> 16);
+    lengths[i] = strlen(lines[i]);
+  }
+
+  unsigned long checksum = 0;
+  double        start    = now_seconds();
+  for (int r = 0; r < ROUNDS; r++)
+    for (size_t i = 0; i < LINE_COUNT; i++)
+      checksum += linear_match(lines[i], lengths[i]);
+  double linear = now_seconds() - start;
+
+  start = now_seconds();
+  for (int r = 0; r < ROUNDS; r++)
+    for (size_t i = 0; i < LINE_COUNT; i++)
+      checksum += wf_obj_keyword(lines[i], lengths[i]);
+  double table = now_seconds() - start;
+
+  double n = (double)LINE_COUNT * ROUNDS;
+  printf("linear strncmp scan: %6.2f ns/line\n", linear * 1e9 / n);
+  printf("first-byte switch:   %6.2f ns/line\n", table * 1e9 / n);
+  printf("speedup:             %6.2fx (checksum %lu)\n", linear / table,
+         checksum);
+
+  free(lines);
+  free(lengths);
+  return 0;
+}
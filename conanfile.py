@@ -32,7 +32,6 @@ class WavefrontParserConan(ConanFile):
     def requirements(self):
         # project depends on cmocka for testing
         self.requires("cmocka/1.1.7")
-        self.requires("log4c/1.0.0@local/stable")
 
     # ====== configure for package ======
     exports_sources = (
@@ -74,6 +73,7 @@ class WavefrontParserConan(ConanFile):
             variables={
                 "WF_BUILD_EXAMPLES": "ON" if self.options.build_examples else "OFF",
                 "WF_BUILD_TESTS": "ON" if self.options.build_tests else "OFF",
+                "WF_BUILD_BENCHMARKS": "OFF",
             }
         )
         cmake.build()
@@ -133,3 +133,4 @@ class WavefrontParserConan(ConanFile):
         self.cpp_info.libs = ["wavefront-parser"]
         if self.settings.os in ["Linux", "FreeBSD"]:
             self.cpp_info.system_libs.append("m")
+            self.cpp_info.system_libs.append("pthread")
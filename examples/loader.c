@@ -1,9 +1,16 @@
 // examples/loader.c
 #include <stdio.h>
 #include <stdlib.h>
-#include "log4c.h"
 #include "wavefront.h"
 
+// Forward library warnings and errors to stderr
+static void log_to_stderr(wf_log_level_t level, const char* message,
+                          void* user) {
+  (void)user;
+  if (level >= WF_LOG_WARN)
+    fprintf(stderr, "wavefront: %s\n", message);
+}
+
 int main(int argc, char* argv[]) {
   if (argc != 2) {
     fprintf(stderr, "Usage: %s <obj_file>\n", argv[0]);
@@ -11,29 +18,28 @@ int main(int argc, char* argv[]) {
   }
 
   // Initialize logging
-  // log_init(LOG_LEVEL_DEBUG);
-  log_init(LOG_LEVEL_WARN);
+  wf_set_log_callback(log_to_stderr, NULL);
 
   const char*        filename = argv[1];
   wf_scene_t         scene;
   wf_parse_options_t options;
   wf_parse_options_init(&options);
 
-  LOG_INFO("Loading Wavefront file: %s", filename);
+  printf("Loading Wavefront file: %s\n", filename);
 
   wf_error_t err = wf_load_obj(filename, &scene, &options);
   if (err != WF_SUCCESS) {
-    LOG_ERROR("Failed to load OBJ file: %s", wf_get_error(&scene));
+    fprintf(stderr, "Failed to load OBJ file: %s\n", wf_get_error(&scene));
     wf_free_scene(&scene);
     return 1;
   }
 
   // Print scene summary
-  LOG_INFO("Scene loaded successfully!");
-  LOG_INFO("Vertices: %zu", scene.vertex_count);
-  LOG_INFO("Texture coordinates: %zu", scene.texcoord_count);
-  LOG_INFO("Normals: %zu", scene.normal_count);
-  LOG_INFO("Materials: %zu", scene.material_count);
+  printf("Scene loaded successfully!\n");
+  printf("Vertices: %zu\n", scene.vertex_count);
+  printf("Texture coordinates: %zu\n", scene.texcoord_count);
+  printf("Normals: %zu\n", scene.normal_count);
+  printf("Materials: %zu\n", scene.material_count);
 
   // Count total faces
   size_t       total_faces = 0;
@@ -42,13 +48,13 @@ int main(int argc, char* argv[]) {
     total_faces += obj->face_count;
     obj = obj->next;
   }
-  LOG_INFO("Total faces: %zu", total_faces);
+  printf("Total faces: %zu\n", total_faces);
 
   // Validate scene
   if (wf_validate_scene(&scene)) {
-    LOG_INFO("Scene validation passed!");
+    printf("Scene validation passed!\n");
   } else {
-    LOG_WARN("Scene validation failed!");
+    fprintf(stderr, "Scene validation failed!\n");
   }
 
   wf_print_options_t opt;
@@ -59,11 +65,11 @@ int main(int argc, char* argv[]) {
   size_t   triangle_count = 0;
   err = wf_scene_to_triangles(&scene, &triangles, &triangle_count);
   if (err == WF_SUCCESS) {
-    LOG_INFO("Converted to %zu triangles", triangle_count);
+    printf("Converted to %zu triangles\n", triangle_count);
     free(triangles);
   }
 
   wf_free_scene(&scene);
-  LOG_INFO("Done!");
+  printf("Done!\n");
   return 0;
 }
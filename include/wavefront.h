@@ -9,6 +9,7 @@
 #define WAVEFRONT_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -24,7 +25,8 @@ typedef enum {
   WF_ERROR_INVALID_FORMAT,
   WF_ERROR_OUT_OF_MEMORY,
   WF_ERROR_UNSUPPORTED_FEATURE,
-  WF_ERROR_INTERNAL
+  WF_ERROR_INTERNAL,
+  WF_ERROR_CANCELLED
 } wf_error_t;
 
 /**
@@ -57,7 +59,8 @@ typedef struct {
  * Automatically triangulated during parsing
  */
 typedef struct {
-  wf_vertex_index vertices[3]; /**< Triangle vertices */
+  wf_vertex_index vertices[3];     /**< Triangle vertices */
+  unsigned        smoothing_group; /**< s statement in effect, 0 for off */
   size_t          material_idx;
 } wf_face;
 
@@ -102,20 +105,62 @@ typedef struct {
   } map_options;
 } wf_material_t;
 
+/**
+ * @brief Consecutive faces of an object that share a material
+ */
+typedef struct {
+  size_t start;        /**< First face of the run */
+  size_t count;        /**< Number of faces */
+  size_t material_idx; /**< Material, (size_t)-1 for none */
+} wf_material_run_t;
+
 /**
  * @brief Object/Group structure
  * OBJ files can have multiple objects/groups
  */
 typedef struct wf_object_s {
-  char*    name;         /**< Object/group name */
-  wf_face* faces;        /**< Array of faces */
-  size_t   face_count;   /**< Number of faces */
-  size_t   face_cap;     /**< Cap of faces */
-  size_t   material_idx; /**< Current material idx */
+  char*              name;               /**< Object/group name */
+  wf_face*           faces;              /**< Array of faces */
+  size_t             face_count;         /**< Number of faces */
+  size_t             face_cap;           /**< Cap of faces */
+  size_t             material_idx;       /**< Last material used, or -1 */
+  wf_material_run_t* material_runs;      /**< Materials in face order */
+  size_t             material_run_count; /**< Number of material runs */
+  size_t             material_run_cap;   /**< Cap of material runs */
   // char*               material_name; /**< Current material name */
   struct wf_object_s* next; /**< Next object in list */
 } wf_object_t;
 
+/**
+ * @brief One vec3 attribute stored as structure of arrays
+ * xs, ys and zs each hold padded_count floats, start on the scene's SoA
+ * alignment and are zero past count, so SIMD loops need no scalar tail.
+ */
+typedef struct {
+  float* xs;
+  float* ys;
+  float* zs;
+  size_t count;        /**< Number of elements */
+  size_t padded_count; /**< count rounded up to alignment / sizeof(float) */
+} wf_soa3_t;
+
+/**
+ * @brief Axis-aligned bounding box
+ * Empty when min is greater than max, as for a box of no points.
+ */
+typedef struct {
+  wf_vec3 min;
+  wf_vec3 max;
+} wf_aabb_t;
+
+/**
+ * @brief Bounding sphere
+ */
+typedef struct {
+  wf_vec3 center;
+  float   radius;
+} wf_sphere_t;
+
 /**
  * @brief Main scene structure
  */
@@ -137,12 +182,16 @@ typedef struct {
   size_t parameter_cap; /**< Capacity of parameters */
 
   /* Materials */
-  wf_material_t* materials;      /**< Array of materials */
-  size_t         material_count; /**< Number of materials */
-  size_t         material_cap;   /**< Capacity of materials */
+  wf_material_t*          materials;      /**< Array of materials */
+  size_t                  material_count; /**< Number of materials */
+  size_t                  material_cap;   /**< Capacity of materials */
+  struct wf_name_index_s* material_index; /**< Materials by name, see
+                                               wf_scene_find_material */
 
   /* Objects/Groups */
-  wf_object_t* objects; /**< Linked list of objects */
+  wf_object_t*            objects;      /**< Linked list of objects */
+  struct wf_name_index_s* object_index; /**< Objects by name, see
+                                             wf_scene_find_object */
 
   /* Free-form geometry (NURBS, curves, surfaces) */
   struct {
@@ -153,10 +202,61 @@ typedef struct {
     size_t               surface_count;
   } freeform;
 
+  /* Structure-of-arrays geometry, see wf_scene_convert_to_soa. While in use
+     vertices, texcoords and normals are NULL; read them with
+     wf_scene_vertex and friends. */
+  struct {
+    wf_soa3_t vertices;
+    wf_soa3_t texcoords;
+    wf_soa3_t normals;
+    size_t    alignment; /**< 0 while geometry is stored as wf_vec3 arrays */
+  } soa;
+
+  /* Bounds tracked while parsing, see wf_parse_options_t::compute_bounds */
+  wf_aabb_t bounds;     /**< Box of all vertices */
+  int       has_bounds; /**< bounds is valid */
+
   /* Error handling */
   char* error_message; /**< Last error message */
+
+  /* Memory */
+  struct wf_arena_s* arena; /**< Owns all scene memory, NULL for the heap */
 } wf_scene_t;
 
+/**
+ * @brief Expected element counts used to pre-size scene arrays
+ * Arrays still grow if a count turns out too small.
+ */
+typedef struct {
+  size_t vertices;   /**< Number of v statements */
+  size_t texcoords;  /**< Number of vt statements */
+  size_t normals;    /**< Number of vn statements */
+  size_t parameters; /**< Number of vp statements */
+} wf_size_hints_t;
+
+/**
+ * @brief Source of OBJ and MTL file contents
+ * Replaces the file system for wf_load_obj and for mtllib references, e.g.
+ * to load from an archive already in memory. lookup is tried first and lets
+ * the parser use the provider's buffer without copying; otherwise the file is
+ * read through open/size/read/close. Members may be NULL.
+ */
+typedef struct {
+  /** Point data at the whole file; the buffer must stay valid until the
+      load returns. Returns 0 on success, non-zero if the file is unknown */
+  int (*lookup)(void* user, const char* path, const char** data,
+                size_t* size);
+  /** Open a file, returns NULL if it does not exist */
+  void* (*open)(void* user, const char* path);
+  /** Size of an opened file in bytes, used to size the read buffer */
+  size_t (*size)(void* user, void* handle);
+  /** Read up to size bytes, returns 0 at the end of the file */
+  size_t (*read)(void* user, void* handle, char* data, size_t size);
+  /** Release a handle returned by open */
+  void (*close)(void* user, void* handle);
+  void* user; /**< Passed through to every member */
+} wf_io_t;
+
 /**
  * @brief Parse options
  */
@@ -167,6 +267,31 @@ typedef struct {
   int    strict_mode;      /**< Fail on unsupported features (default: 0) */
   int    preserve_indices; /**< Keep 1-based indices (default: 0) */
   size_t max_line_length;  /**< Maximum line length (default: 4096) */
+  int    use_mmap;         /**< Memory-map regular files, falls back to
+                                stdio for pipes (default: 1) */
+  size_t num_threads;      /**< Threads for parsing mapped files, 0 uses
+                                every processor (default: 1) */
+  int    presize;          /**< Count a mapped file first and allocate every
+                                array once at its exact size (default: 0) */
+  const wf_size_hints_t* size_hints; /**< Known counts, skips the counting
+                                          pass (default: NULL) */
+  int use_arena; /**< Allocate the whole scene from an arena so that
+                      wf_free_scene releases it in a few calls (default: 0) */
+  const wf_io_t* io; /**< Provider for the OBJ and its MTL files, NULL for
+                          the file system (default: NULL) */
+  size_t soa_alignment; /**< Convert v/vt/vn to structure of arrays with this
+                             alignment after parsing, 0 keeps wf_vec3 arrays
+                             (default: 0) */
+  int compute_bounds; /**< Track the box of all vertices while parsing into
+                           scene->bounds (default: 0) */
+  int compress_cache; /**< Write wf_load_obj_cached caches with compressed
+                           faces, see wf_binary_options_t (default: 0) */
+  const volatile int* cancel; /**< Checked every 1024 lines, parsing stops
+                                   with WF_ERROR_CANCELLED once it is
+                                   nonzero (default: NULL) */
+  int use_mtl_cache; /**< Copy materials from a process-wide cache of parsed
+                          MTL files keyed by path, size and mtime instead of
+                          parsing them again; not used with io (default: 0) */
 } wf_parse_options_t;
 
 /**
@@ -184,6 +309,160 @@ void wf_parse_options_init(wf_parse_options_t* options);
 wf_error_t wf_load_obj(const char* filename, wf_scene_t* scene,
                        const wf_parse_options_t* options);
 
+/**
+ * @brief Load Wavefront OBJ data from memory
+ * mtllib names are resolved as written, through options->io when set and
+ * otherwise relative to the working directory.
+ * @param data OBJ file contents, need not be NUL-terminated
+ * @param size Size of data in bytes
+ * @param scene Output scene structure
+ * @param options Parse options (can be NULL for defaults)
+ * @return WF_SUCCESS on success, error code otherwise
+ */
+wf_error_t wf_load_obj_from_memory(const char* data, size_t size,
+                                   wf_scene_t*               scene,
+                                   const wf_parse_options_t* options);
+
+/**
+ * @brief Pending wf_load_obj_async load
+ */
+typedef struct wf_load_s wf_load_t;
+
+/**
+ * @brief Completion callback of wf_load_obj_async
+ * Runs on a worker thread. The scene stays owned by the load until
+ * wf_load_wait hands it over.
+ */
+typedef void (*wf_load_callback_t)(void* user, wf_error_t result,
+                                   wf_scene_t* scene);
+
+/**
+ * @brief Load an OBJ file on a background thread
+ * Loads run on a process-wide pool with one worker per processor, created
+ * on first use. Every load must be released with wf_load_wait.
+ * @param filename Path to OBJ file, copied
+ * @param options Parse options (can be NULL for defaults), copied; what
+ *        they point to must outlive the load. options->cancel is replaced.
+ * @param completion Called once the load has finished (can be NULL)
+ * @param user Passed to completion
+ * @return Load handle, NULL when out of memory
+ */
+wf_load_t* wf_load_obj_async(const char*               filename,
+                             const wf_parse_options_t* options,
+                             wf_load_callback_t completion, void* user);
+
+/**
+ * @brief Check whether a load has finished, without blocking
+ * @return Nonzero once the load and its completion callback are done
+ */
+int wf_load_poll(wf_load_t* load);
+
+/**
+ * @brief Ask a load to stop
+ * A load that has not finished yet then ends with WF_ERROR_CANCELLED, within
+ * 1024 lines of parsing, and its partial scene is freed.
+ */
+void wf_load_cancel(wf_load_t* load);
+
+/**
+ * @brief Wait for a load to finish and release it
+ * Must not be called from the completion callback.
+ * @param load Load from wf_load_obj_async
+ * @param scene Receives the scene as wf_load_obj would leave it, to be freed
+ *        with wf_free_scene; NULL frees it instead
+ * @return Result of the load
+ */
+wf_error_t wf_load_wait(wf_load_t* load, wf_scene_t* scene);
+
+/**
+ * @brief OBJ parser fed incrementally by the caller
+ */
+typedef struct wf_push_parser_s wf_push_parser_t;
+
+/**
+ * @brief Start parsing OBJ data that arrives in pieces
+ * A zeroed scene is filled from scratch. A populated one is appended to:
+ * negative indices resolve against the elements it already holds, new faces
+ * go to new objects, and its layout and bounds are kept up to date. mtllib
+ * names are resolved as in wf_load_obj_from_memory. num_threads, presize
+ * and use_mmap do not apply.
+ * @param scene Scene to fill, zeroed or populated
+ * @param options Parse options (can be NULL for defaults)
+ * @return Parser to feed and finish, NULL when out of memory
+ */
+wf_push_parser_t* wf_obj_parser_create(wf_scene_t*               scene,
+                                       const wf_parse_options_t* options);
+
+/**
+ * @brief Parse the next piece of OBJ data
+ * Pieces may split lines anywhere. Complete lines are parsed in place and
+ * only the unfinished line at the end is copied until the rest arrives.
+ * @param parser Parser from wf_obj_parser_create
+ * @param data Next bytes of the OBJ data
+ * @param size Size of data in bytes
+ * @return WF_SUCCESS on success; once an error occurred, every later call
+ *         returns it and ignores its data
+ */
+wf_error_t wf_obj_parser_feed(wf_push_parser_t* parser, const char* data,
+                              size_t size);
+
+/**
+ * @brief Parse the last line, complete the scene and release the parser
+ * The parser is released even on error; the scene then holds what was
+ * parsed and is freed with wf_free_scene as usual.
+ * @param parser Parser from wf_obj_parser_create
+ * @return WF_SUCCESS on success, otherwise the first error of the parse
+ */
+wf_error_t wf_obj_parser_finish(wf_push_parser_t* parser);
+
+/**
+ * @brief Callbacks for wf_parse_stream
+ * Every member may be NULL. A callback returning non-zero stops parsing
+ * with WF_ERROR_CANCELLED. Pointers passed to callbacks are only valid for
+ * the duration of the call.
+ */
+typedef struct {
+  /** Consecutive v statements, delivered in batches */
+  int (*vertices)(void* user, const wf_vec3* vertices, size_t count);
+  /** Consecutive vt statements, delivered in batches */
+  int (*texcoords)(void* user, const wf_vec3* texcoords, size_t count);
+  /** Consecutive vn statements, delivered in batches */
+  int (*normals)(void* user, const wf_vec3* normals, size_t count);
+  /** Consecutive vp statements, delivered in batches */
+  int (*parameters)(void* user, const wf_vec4* parameters, size_t count);
+  /** One triangle when triangulating, otherwise the whole polygon. Indices
+      are resolved like wf_load_obj does */
+  int (*face)(void* user, const wf_vertex_index* indices, size_t count);
+  /** o or g statement */
+  int (*object)(void* user, const char* name, int is_group);
+  /** usemtl statement */
+  int (*usemtl)(void* user, const char* name);
+  /** mtllib statement; the library is not loaded */
+  int (*mtllib)(void* user, const char* path);
+} wf_callbacks_t;
+
+/**
+ * @brief Parse an OBJ file without building a scene
+ * Memory use does not depend on the file size. Elements are reported in
+ * file order: a vertex batch is always delivered before any face that
+ * follows it in the file.
+ * @param filename Path to OBJ file
+ * @param callbacks Functions to call for each element
+ * @param user Passed through to every callback
+ * @return WF_SUCCESS on success, error code otherwise
+ */
+wf_error_t wf_parse_stream(const char*           filename,
+                           const wf_callbacks_t* callbacks, void* user);
+
+/**
+ * @brief wf_parse_stream with explicit parse options
+ * triangulate, strict_mode, preserve_indices, max_line_length and use_mmap
+ * apply; options that shape a scene are ignored.
+ */
+wf_error_t wf_parse_stream_ex(const char* filename,
+                              const wf_parse_options_t* options,
+                              const wf_callbacks_t* callbacks, void* user);
+
 /**
  * @brief Load MTL file separately
  * @param filename Path to MTL file
@@ -194,6 +473,98 @@ wf_error_t wf_load_obj(const char* filename, wf_scene_t* scene,
 wf_error_t wf_load_mtl(const char* filename, wf_material_t** materials,
                        size_t* material_count, size_t* material_cap);
 
+/**
+ * @brief Load MTL data from memory
+ * @param data MTL file contents, need not be NUL-terminated
+ * @param size Size of data in bytes
+ * @param materials Output materials array
+ * @param material_count Output material count
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_load_mtl_from_memory(const char* data, size_t size,
+                                   wf_material_t** materials,
+                                   size_t*         material_count,
+                                   size_t*         material_cap);
+
+/**
+ * @brief State of the MTL cache used by use_mtl_cache
+ */
+typedef struct {
+  size_t entries; /**< Parsed MTL files held */
+  size_t hits;    /**< mtllib statements served from the cache */
+  size_t misses;  /**< mtllib statements that parsed their file */
+} wf_mtl_cache_stats_t;
+
+/**
+ * @brief Empty the MTL cache and reset its counters. Safe while loads are
+ *        running; materials they are copying are freed once they are done.
+ */
+void wf_mtl_cache_clear(void);
+
+/**
+ * @brief Read the MTL cache counters
+ * @param stats Output
+ */
+void wf_mtl_cache_get_stats(wf_mtl_cache_stats_t* stats);
+
+/**
+ * @brief Binary scene options
+ */
+typedef struct {
+  int use_mmap;       /**< Map the file and fix its pointers up in place,
+                           otherwise read it into memory (default: 1) */
+  int compress_faces; /**< Save faces with wf_encode_index_buffer; they are
+                           then decoded on load instead of mapped
+                           (default: 0) */
+} wf_binary_options_t;
+
+/**
+ * @brief Initialize binary scene options with defaults
+ */
+void wf_binary_options_init(wf_binary_options_t* options);
+
+/**
+ * @brief Save a scene in the binary scene format
+ * The file holds geometry, materials, objects, faces and material runs,
+ * little-endian with every section 64-byte aligned. It is only readable by
+ * builds with the same pointer size and structure layout.
+ * @param scene Scene to save
+ * @param filename Output path, replaced atomically
+ * @param options Binary options (can be NULL for defaults)
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_save_scene_binary(const wf_scene_t* scene, const char* filename,
+                                const wf_binary_options_t* options);
+
+/**
+ * @brief Load a scene saved with wf_save_scene_binary
+ * The arrays point into the mapped file, which the scene's arena owns; the
+ * scene can be modified and is released with wf_free_scene.
+ * @param filename Path to the binary scene
+ * @param scene Output scene structure
+ * @param options Binary options (can be NULL for defaults)
+ * @return WF_SUCCESS on success, WF_ERROR_INVALID_FORMAT for files that are
+ *         corrupt or written by an incompatible build
+ */
+wf_error_t wf_load_scene_binary(const char* filename, wf_scene_t* scene,
+                                const wf_binary_options_t* options);
+
+/**
+ * @brief Load an OBJ file through a binary sidecar cache
+ * The cache is used when it was built from the same path with the same size,
+ * mtime, content hash and scene-shaping options; otherwise the OBJ is parsed
+ * with wf_load_obj and the cache rewritten. Changes to MTL files alone are
+ * not detected. Falls back to wf_load_obj when options->io is set.
+ * @param filename Path to OBJ file
+ * @param cache_filename Cache path, NULL for filename + ".wfcache"
+ * @param scene Output scene structure
+ * @param options Parse options (can be NULL for defaults)
+ * @return WF_SUCCESS on success, error code otherwise
+ */
+wf_error_t wf_load_obj_cached(const char* filename, const char* cache_filename,
+                              wf_scene_t*               scene,
+                              const wf_parse_options_t* options);
+
 /**
  * @brief Free scene memory
  * @param scene Scene to free
@@ -214,6 +585,28 @@ const char* wf_get_error(const wf_scene_t* scene);
  */
 int wf_validate_scene(const wf_scene_t* scene);
 
+/**
+ * @brief Find an object or group by name
+ * Uses the hash index built when the scene is loaded; scenes assembled by
+ * hand are scanned. When several objects share a name the first one is
+ * returned.
+ * @param scene Scene to search
+ * @param name Object or group name
+ * @return The object, NULL if no object has that name
+ */
+wf_object_t* wf_scene_find_object(const wf_scene_t* scene, const char* name);
+
+/**
+ * @brief Find a material by name
+ * Names match exactly. Uses the hash index built as MTL files are loaded;
+ * scenes assembled by hand are scanned. When several materials share a name
+ * the first one is returned.
+ * @param scene Scene to search
+ * @param name Material name as given to newmtl
+ * @return Index into scene->materials, (size_t)-1 if there is none
+ */
+size_t wf_scene_find_material(const wf_scene_t* scene, const char* name);
+
 /**
  * @brief Convert scene to triangles only (for ray tracing)
  * @param scene Input scene
@@ -224,6 +617,493 @@ int wf_validate_scene(const wf_scene_t* scene);
 wf_error_t wf_scene_to_triangles(const wf_scene_t* scene, wf_face** triangles,
                                  size_t* triangle_count);
 
+/**
+ * @brief Triangles of one material in wf_scene_triangles_by_material output
+ */
+typedef struct {
+  size_t material_idx;   /**< Material, (size_t)-1 for none */
+  size_t first_triangle; /**< Offset into the triangle array */
+  size_t triangle_count; /**< Number of triangles */
+} wf_material_batch_t;
+
+/**
+ * @brief Convert scene to triangles grouped by material, one batch per draw
+ * Batches are sorted by material index with faces without a material last,
+ * and keep file order within a batch.
+ * @param scene Input scene
+ * @param triangles Output triangle array
+ * @param triangle_count Output triangle count
+ * @param batches Output batch array, only non-empty batches
+ * @param batch_count Output batch count
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_scene_triangles_by_material(const wf_scene_t*     scene,
+                                          wf_face**             triangles,
+                                          size_t*               triangle_count,
+                                          wf_material_batch_t** batches,
+                                          size_t*               batch_count);
+
+/**
+ * @brief Store vertices, texcoords and normals as structure of arrays
+ * Replaces the wf_vec3 arrays by scene->soa. A scene already in SoA form is
+ * re-laid out for the new alignment.
+ * @param scene Scene to convert
+ * @param alignment Alignment and SIMD width in bytes: 16, 32 or 64
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_scene_convert_to_soa(wf_scene_t* scene, size_t alignment);
+
+/**
+ * @brief Restore wf_vec3 arrays after wf_scene_convert_to_soa
+ * @param scene Scene to convert
+ * @return WF_SUCCESS on success, including scenes that are not SoA
+ */
+wf_error_t wf_scene_convert_to_aos(wf_scene_t* scene);
+
+/**
+ * @brief Vertex position i, whichever layout the scene uses
+ */
+wf_vec3 wf_scene_vertex(const wf_scene_t* scene, size_t i);
+
+/**
+ * @brief Texture coordinate i, whichever layout the scene uses
+ */
+wf_vec3 wf_scene_texcoord(const wf_scene_t* scene, size_t i);
+
+/**
+ * @brief Normal i, whichever layout the scene uses
+ */
+wf_vec3 wf_scene_normal(const wf_scene_t* scene, size_t i);
+
+/**
+ * @brief How face normals are weighted when averaged at a vertex
+ */
+typedef enum {
+  WF_NORMAL_WEIGHT_AREA = 0, /**< By triangle area */
+  WF_NORMAL_WEIGHT_ANGLE     /**< By the corner angle, independent of how
+                                  polygons were triangulated */
+} wf_normal_weight_t;
+
+/**
+ * @brief Normal generation options
+ * A zeroed struct selects area weighting on every processor.
+ */
+typedef struct {
+  size_t             num_threads; /**< Worker threads, 0 uses every
+                                       processor */
+  wf_normal_weight_t weighting;
+} wf_normal_options_t;
+
+/**
+ * @brief Replace the scene's normals by generated ones
+ * Corners that share a position and a non-zero smoothing group get one
+ * averaged normal; faces with smoothing off get their face normal. Every
+ * face's vn_idx is rewritten, -1 for faces with an invalid position index.
+ * Existing normals are discarded. The scene must not use preserve_indices.
+ * @param scene Scene to update
+ * @param options Weighting and threading (can be NULL for defaults)
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_scene_generate_normals(wf_scene_t*                scene,
+                                     const wf_normal_options_t* options);
+
+/**
+ * @brief Vertex of an interleaved indexed mesh (32 bytes)
+ */
+typedef struct {
+  wf_vec3 position;
+  wf_vec3 normal; /**< Zero when the corner has no normal */
+  float   u, v;   /**< Zero when the corner has no texture coordinate */
+} wf_mesh_vertex_t;
+
+/**
+ * @brief Range of the index buffer drawn with one material
+ */
+typedef struct {
+  size_t      first_index;  /**< Offset into indices */
+  size_t      index_count;  /**< Number of indices, three per triangle */
+  size_t      material_idx; /**< Material, (size_t)-1 for none or for an
+                                 object using several */
+  const char* name; /**< Object name, NULL when grouped by material. Points
+                         into the scene */
+} wf_mesh_group_t;
+
+/**
+ * @brief Indexed mesh options
+ * A zeroed struct selects interleaved vertices grouped by object.
+ */
+typedef struct {
+  int separate_streams; /**< Fill positions/texcoords/normals instead of
+                             vertices */
+  int by_material;      /**< One group per material instead of per object */
+} wf_mesh_options_t;
+
+/**
+ * @brief Scene geometry with one index per unique (v, vt, vn) corner
+ */
+typedef struct {
+  size_t            vertex_count; /**< Unique corners */
+  wf_mesh_vertex_t* vertices;     /**< Interleaved layout, else NULL */
+  wf_vec3*          positions;    /**< Separate layout, else NULL */
+  wf_vec3*          texcoords;    /**< Separate layout, NULL if no corner has
+                                       a texture coordinate */
+  wf_vec3*          normals;      /**< Separate layout, NULL if no corner has
+                                       a normal */
+  uint32_t*         indices;      /**< Three per triangle */
+  size_t            index_count;
+  wf_mesh_group_t*  groups; /**< Non-empty groups in object or material
+                                 order */
+  size_t            group_count;
+} wf_indexed_mesh_t;
+
+/**
+ * @brief Build an indexed mesh for GPU upload or ray tracing
+ * Identical (v, vt, vn) corners share one vertex. Triangles whose position
+ * index is invalid are skipped. The scene must not use preserve_indices.
+ * @param scene Input scene
+ * @param options Layout and grouping (can be NULL for defaults)
+ * @param mesh Output mesh, release with wf_free_indexed_mesh
+ * @return WF_SUCCESS on success, WF_ERROR_UNSUPPORTED_FEATURE if the mesh
+ *         needs more than 2^32 - 1 vertices
+ */
+wf_error_t wf_scene_build_indexed_mesh(const wf_scene_t*        scene,
+                                       const wf_mesh_options_t* options,
+                                       wf_indexed_mesh_t*       mesh);
+
+/**
+ * @brief Free an indexed mesh
+ * @param mesh Mesh to free
+ */
+void wf_free_indexed_mesh(wf_indexed_mesh_t* mesh);
+
+/**
+ * @brief Vertex cache optimization options
+ * A zeroed struct selects the defaults.
+ */
+typedef struct {
+  size_t cache_size; /**< Entries of the simulated FIFO post-transform
+                          cache (default: 16) */
+} wf_mesh_optimize_options_t;
+
+/**
+ * @brief Vertex cache efficiency of an index buffer
+ */
+typedef struct {
+  float acmr; /**< Average cache miss ratio: transformed vertices per
+                   triangle, 0.5 to 3 */
+  float atvr; /**< Average transform to vertex ratio: transformed vertices
+                   per vertex used, 1 is ideal */
+} wf_mesh_cache_stats_t;
+
+/**
+ * @brief Measure how well a mesh's index order uses a vertex cache
+ * @param mesh Mesh to measure
+ * @param cache_size Entries of the simulated FIFO cache, 0 for 16
+ * @param stats Output
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_indexed_mesh_cache_stats(const wf_indexed_mesh_t* mesh,
+                                       size_t                   cache_size,
+                                       wf_mesh_cache_stats_t*   stats);
+
+/**
+ * @brief Reorder a mesh for GPU vertex cache and vertex fetch locality
+ * Triangles are reordered within each group with Tipsify, then vertices
+ * are renumbered in order of first use. Groups, winding and the set of
+ * triangles are unchanged. The cache statistics are logged at info level.
+ * @param mesh Mesh to reorder in place
+ * @param options Cache size (can be NULL for defaults)
+ * @param before Statistics of the original order (can be NULL)
+ * @param after Statistics of the new order (can be NULL)
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_indexed_mesh_optimize(wf_indexed_mesh_t*                mesh,
+                                    const wf_mesh_optimize_options_t* options,
+                                    wf_mesh_cache_stats_t*            before,
+                                    wf_mesh_cache_stats_t*            after);
+
+/**
+ * @brief Storage of quantized positions
+ */
+typedef enum {
+  WF_POSITION_UNORM16 = 0, /**< 16-bit fixed point across the scene box */
+  WF_POSITION_HALF         /**< IEEE half floats */
+} wf_position_format_t;
+
+/**
+ * @brief Storage of quantized texture coordinates (u and v only)
+ */
+typedef enum {
+  WF_TEXCOORD_UNORM16 = 0, /**< 16-bit fixed point across the used range */
+  WF_TEXCOORD_HALF         /**< IEEE half floats */
+} wf_texcoord_format_t;
+
+/**
+ * @brief Quantization options
+ * A zeroed struct selects 16-bit fixed point for everything.
+ */
+typedef struct {
+  wf_position_format_t position_format;
+  wf_texcoord_format_t texcoord_format;
+} wf_quantize_options_t;
+
+/**
+ * @brief How to decode wf_quantized_scene_t buffers, and the error measured
+ * while encoding them
+ * Fixed point values decode as offset + q / 65535 * scale per component.
+ * Normals are octahedral: with x = qx / 32767 and y = qy / 32767,
+ * z = 1 - |x| - |y|; if z < 0, x and y become (1 - |y|) * sign(x) and
+ * (1 - |x|) * sign(y); the result is then normalized.
+ */
+typedef struct {
+  wf_position_format_t position_format;
+  wf_texcoord_format_t texcoord_format;
+  float                position_offset[3]; /**< Scene box minimum */
+  float                position_scale[3];  /**< Scene box extent */
+  float                texcoord_offset[2];
+  float                texcoord_scale[2];
+  float                position_error; /**< Largest error of a coordinate */
+  float                texcoord_error; /**< Largest error of u or v */
+  float                normal_error;   /**< Largest angle to the input
+                                            normal, radians */
+} wf_quantize_header_t;
+
+/**
+ * @brief Compact copy of a scene's vertex attributes
+ * Element i of each buffer encodes element i of the scene array, so face
+ * indices apply unchanged. Zero-length normals decode as (0, 0, 1).
+ */
+typedef struct {
+  wf_quantize_header_t header;
+  uint16_t*            positions; /**< Three per vertex */
+  uint16_t*            texcoords; /**< Two per texture coordinate */
+  int16_t*             normals;   /**< Two per normal */
+  size_t               vertex_count;
+  size_t               texcoord_count;
+  size_t               normal_count;
+} wf_quantized_scene_t;
+
+/**
+ * @brief Quantize vertex positions, texture coordinates and normals
+ * Takes 14 bytes per vertex, texture coordinate and normal instead of 36.
+ * The error of every element is measured and reported in the header.
+ * @param scene Input scene, in either layout
+ * @param options Formats (can be NULL for defaults)
+ * @param quantized Output, release with wf_free_quantized_scene
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_scene_quantize(const wf_scene_t*            scene,
+                             const wf_quantize_options_t* options,
+                             wf_quantized_scene_t*        quantized);
+
+/**
+ * @brief Decode quantized position i
+ */
+wf_vec3 wf_quantized_position(const wf_quantized_scene_t* quantized,
+                              size_t                      i);
+
+/**
+ * @brief Decode quantized texture coordinate i, with z = 0
+ */
+wf_vec3 wf_quantized_texcoord(const wf_quantized_scene_t* quantized,
+                              size_t                      i);
+
+/**
+ * @brief Decode quantized normal i
+ */
+wf_vec3 wf_quantized_normal(const wf_quantized_scene_t* quantized, size_t i);
+
+/**
+ * @brief Free buffers from wf_scene_quantize
+ * @param quantized Quantized scene to free
+ */
+void wf_free_quantized_scene(wf_quantized_scene_t* quantized);
+
+/**
+ * @brief Largest size of an index buffer encoding
+ * @param index_count Number of indices, a multiple of 3
+ */
+size_t wf_index_buffer_bound(size_t index_count);
+
+/**
+ * @brief Losslessly compress a triangle index buffer
+ * Triangles sharing an edge with one of the 16 previous triangles take one
+ * byte, plus one when the third vertex is neither new nor recent. Buffers in
+ * first-use vertex order, as left by wf_indexed_mesh_optimize, compress
+ * best. Any uint32_t values are accepted.
+ * @param indices Indices, three per triangle
+ * @param index_count Number of indices, a multiple of 3
+ * @param out Output buffer
+ * @param out_size Size of out, at least wf_index_buffer_bound(index_count)
+ * @param size Output size of the encoding in bytes
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_encode_index_buffer(const uint32_t* indices, size_t index_count,
+                                  unsigned char* out, size_t out_size,
+                                  size_t* size);
+
+/**
+ * @brief Decode a buffer from wf_encode_index_buffer
+ * @param data Encoded bytes
+ * @param size Size of the encoding
+ * @param indices Output indices
+ * @param index_count Number of indices that were encoded
+ * @return WF_SUCCESS on success, WF_ERROR_INVALID_FORMAT if data is corrupt
+ *         or holds more or fewer indices
+ */
+wf_error_t wf_decode_index_buffer(const unsigned char* data, size_t size,
+                                  uint32_t* indices, size_t index_count);
+
+/**
+ * @brief Bounding volume options
+ */
+typedef struct {
+  size_t num_threads; /**< Worker threads, 0 uses every processor */
+} wf_bounds_options_t;
+
+/**
+ * @brief Bounding volumes of a scene and of each of its objects
+ */
+typedef struct {
+  wf_aabb_t    scene;        /**< Box of all vertices */
+  wf_aabb_t*   objects;      /**< Box of the vertices each object's faces
+                                  use, in object list order */
+  wf_sphere_t* spheres;      /**< Sphere around each object box's center */
+  size_t       object_count; /**< Entries in objects and spheres */
+} wf_bounds_t;
+
+/**
+ * @brief Compute bounding boxes and spheres
+ * Uses SSE or AVX min/max kernels where available and works on either
+ * geometry layout. The scene box is taken from scene->bounds when parsing
+ * already tracked it. Objects without valid faces get an empty box and a
+ * zero sphere.
+ * @param scene Input scene
+ * @param options Threading (can be NULL for a single thread)
+ * @param bounds Output, release with wf_free_bounds
+ * @return WF_SUCCESS on success
+ */
+wf_error_t wf_scene_compute_bounds(const wf_scene_t*          scene,
+                                   const wf_bounds_options_t* options,
+                                   wf_bounds_t*               bounds);
+
+/**
+ * @brief Free bounds from wf_scene_compute_bounds
+ * @param bounds Bounds to free
+ */
+void wf_free_bounds(wf_bounds_t* bounds);
+
+/**
+ * @brief BVH node (32 bytes)
+ * The two children of an inner node are adjacent, left first. Node 0 is the
+ * root.
+ */
+typedef struct {
+  float    min[3];
+  uint32_t first; /**< Inner node: left child. Leaf: first entry of the
+                       bvh triangle arrays */
+  float    max[3];
+  uint32_t count; /**< Triangles in a leaf, 0 for inner nodes */
+} wf_bvh_node_t;
+
+/**
+ * @brief BVH build options
+ * A zeroed struct selects the defaults.
+ */
+typedef struct {
+  size_t num_threads;   /**< Threads building subtrees, 0 uses every
+                             processor */
+  size_t max_leaf_size; /**< Largest leaf split further only if SAH says it
+                             pays (default: 4) */
+  size_t bin_count;     /**< SAH bins per axis, at most 64 (default: 16) */
+} wf_bvh_options_t;
+
+/**
+ * @brief Bounding volume hierarchy over triangles
+ */
+typedef struct {
+  wf_bvh_node_t* nodes;
+  size_t         node_count;
+  wf_vec3*       positions;      /**< Three corners per triangle, in leaf
+                                      order */
+  uint32_t*      indices;        /**< Input triangle of each entry */
+  size_t         triangle_count; /**< Entries in positions / 3 and indices */
+} wf_bvh_t;
+
+/**
+ * @brief Closest hit found by wf_bvh_intersect
+ */
+typedef struct {
+  float  t;        /**< Distance along the ray in units of direction */
+  float  u, v;     /**< Barycentric coordinates of corners 1 and 2 */
+  size_t triangle; /**< Index into the triangles given to wf_bvh_build */
+} wf_bvh_hit_t;
+
+/**
+ * @brief Build a BVH with binned SAH splits
+ * Subtrees are built in parallel. Triangle corners are copied into the BVH
+ * in leaf order so that traversal does not touch the scene. Triangles with
+ * an invalid position index are left out.
+ * @param scene Scene the triangles index into
+ * @param triangles Triangles, e.g. from wf_scene_to_triangles
+ * @param triangle_count Number of triangles
+ * @param options Build options (can be NULL for a single thread)
+ * @param bvh Output, release with wf_free_bvh
+ * @return WF_SUCCESS on success, WF_ERROR_UNSUPPORTED_FEATURE for more than
+ *         2^31 triangles
+ */
+wf_error_t wf_bvh_build(const wf_scene_t* scene, const wf_face* triangles,
+                        size_t triangle_count, const wf_bvh_options_t* options,
+                        wf_bvh_t* bvh);
+
+/**
+ * @brief Find the closest triangle a ray hits
+ * @param bvh BVH from wf_bvh_build
+ * @param origin Ray origin
+ * @param direction Ray direction, need not be normalized
+ * @param t_max Ignore hits farther than this
+ * @param hit Closest hit, written only when there is one
+ * @return 1 if the ray hits a triangle, 0 otherwise
+ */
+int wf_bvh_intersect(const wf_bvh_t* bvh, wf_vec3 origin, wf_vec3 direction,
+                     float t_max, wf_bvh_hit_t* hit);
+
+/**
+ * @brief Free a BVH
+ * @param bvh BVH to free
+ */
+void wf_free_bvh(wf_bvh_t* bvh);
+
+/**
+ * @brief Log severities passed to the log callback
+ */
+typedef enum {
+  WF_LOG_DEBUG = 0,
+  WF_LOG_INFO,
+  WF_LOG_WARN,
+  WF_LOG_ERROR
+} wf_log_level_t;
+
+/**
+ * @brief Receives every log message the library emits
+ * @param level Severity of the message
+ * @param message Formatted message without trailing newline
+ * @param user Pointer given to wf_set_log_callback
+ */
+typedef void (*wf_log_callback_t)(wf_log_level_t level, const char* message,
+                                  void* user);
+
+/**
+ * @brief Route library log messages to a callback
+ * By default warnings and errors are written to stderr. Passing NULL
+ * silences logging. Messages below the WF_LOG_LEVEL the library was built
+ * with are never generated. Not synchronized with running parses; set it
+ * before loading.
+ * @param callback Log sink, or NULL to disable logging
+ * @param user Passed through to the callback
+ */
+void wf_set_log_callback(wf_log_callback_t callback, void* user);
+
 /**
  * @brief Print options
  */
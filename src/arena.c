@@ -0,0 +1,355 @@
+// src/arena.c
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+
+#ifndef WF_ARENA_BLOCK_SIZE
+#  define WF_ARENA_BLOCK_SIZE (64 * 1024)
+#endif
+
+#define WF_ARENA_ALIGN 16
+#define WF_ARENA_ROUND(n)                                                      \
+  (((n) + WF_ARENA_ALIGN - 1) & ~(size_t)(WF_ARENA_ALIGN - 1))
+
+typedef struct wf_arena_block_s {
+  struct wf_arena_block_s* next;
+  size_t                   size; /**< Usable bytes after the header */
+  size_t                   used;
+} wf_arena_block_t;
+
+#define WF_ARENA_HEADER WF_ARENA_ROUND(sizeof(wf_arena_block_t))
+
+// Memory owned by the arena but allocated elsewhere
+typedef struct wf_arena_extern_s {
+  struct wf_arena_extern_s* next;
+  void*                     data;
+  size_t                    size;
+  void (*release)(void* data, size_t size);
+} wf_arena_extern_t;
+
+struct wf_arena_s {
+  wf_arena_block_t*  blocks;      /**< Shared blocks, the first one is
+                                       current */
+  wf_arena_block_t** large;       /**< Blocks of one allocation each, a
+                                       linear probing set keyed by the
+                                       allocation's address */
+  size_t             large_count;
+  size_t             large_slots; /**< Power of two, 0 before the first */
+  wf_arena_extern_t* external;    /**< Attached with wf_arena_attach */
+  size_t             block_size;
+  size_t             large_threshold;
+};
+
+static char* wf_arena_block_data(wf_arena_block_t* block) {
+  return (char*)block + WF_ARENA_HEADER;
+}
+
+static wf_arena_block_t* wf_arena_block_new(size_t size) {
+  wf_arena_block_t* block = malloc(WF_ARENA_HEADER + size);
+  if (block) {
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+  }
+  return block;
+}
+
+static void wf_arena_free_list(wf_arena_block_t* block) {
+  while (block) {
+    wf_arena_block_t* next = block->next;
+    free(block);
+    block = next;
+  }
+}
+
+wf_arena_t* wf_arena_create(size_t block_size) {
+  wf_arena_t* arena = calloc(1, sizeof(wf_arena_t));
+  if (!arena)
+    return NULL;
+  arena->block_size      = block_size ? block_size : WF_ARENA_BLOCK_SIZE;
+  arena->large_threshold = arena->block_size / 4;
+  return arena;
+}
+
+void wf_arena_destroy(wf_arena_t* arena) {
+  if (!arena)
+    return;
+  wf_arena_free_list(arena->blocks);
+  for (size_t i = 0; i < arena->large_slots; i++)
+    free(arena->large[i]);
+  free(arena->large);
+  while (arena->external) {
+    wf_arena_extern_t* next = arena->external->next;
+    arena->external->release(arena->external->data, arena->external->size);
+    free(arena->external);
+    arena->external = next;
+  }
+  free(arena);
+}
+
+static size_t wf_arena_large_home(const wf_arena_t* arena, const void* ptr) {
+  uint64_t h = (uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ull;
+  return (size_t)(h >> 32) & (arena->large_slots - 1);
+}
+
+// Slot of the dedicated block holding ptr, SIZE_MAX if there is none. Only
+// compares addresses, so ptr may point anywhere, even outside the arena.
+static size_t wf_arena_find_large(const wf_arena_t* arena, const void* ptr) {
+  if (arena->large_count == 0)
+    return SIZE_MAX;
+  size_t mask = arena->large_slots - 1;
+  for (size_t i = wf_arena_large_home(arena, ptr);; i = (i + 1) & mask) {
+    if (!arena->large[i])
+      return SIZE_MAX;
+    if (wf_arena_block_data(arena->large[i]) == ptr)
+      return i;
+  }
+}
+
+// Add a block to the set, which must have room for it
+static void wf_arena_put_large(wf_arena_t* arena, wf_arena_block_t* block) {
+  size_t mask = arena->large_slots - 1;
+  size_t i    = wf_arena_large_home(arena, wf_arena_block_data(block));
+  while (arena->large[i])
+    i = (i + 1) & mask;
+  arena->large[i] = block;
+  arena->large_count++;
+}
+
+// Make room for count more blocks, keeping the set at most half full.
+// Returns 0 on success, -1 when out of memory.
+static int wf_arena_reserve_large(wf_arena_t* arena, size_t count) {
+  size_t needed = arena->large_count + count;
+  if (2 * needed <= arena->large_slots)
+    return 0;
+  size_t slots = arena->large_slots ? arena->large_slots : 16;
+  while (slots < 2 * needed)
+    slots *= 2;
+  wf_arena_block_t** table = calloc(slots, sizeof(wf_arena_block_t*));
+  if (!table)
+    return -1;
+
+  wf_arena_block_t** old       = arena->large;
+  size_t             old_slots = arena->large_slots;
+  arena->large                 = table;
+  arena->large_slots           = slots;
+  arena->large_count           = 0;
+  for (size_t i = 0; i < old_slots; i++) {
+    if (old[i])
+      wf_arena_put_large(arena, old[i]);
+  }
+  free(old);
+  return 0;
+}
+
+// Empty slot i, shifting later blocks of its probe sequence back into the
+// hole so that lookups still find them
+static void wf_arena_remove_large(wf_arena_t* arena, size_t i) {
+  size_t mask     = arena->large_slots - 1;
+  arena->large[i] = NULL;
+  arena->large_count--;
+  for (size_t j = (i + 1) & mask; arena->large[j]; j = (j + 1) & mask) {
+    wf_arena_block_t* block = arena->large[j];
+    size_t home = wf_arena_large_home(arena, wf_arena_block_data(block));
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      arena->large[i] = block;
+      arena->large[j] = NULL;
+      i               = j;
+    }
+  }
+}
+
+void* wf_arena_alloc(wf_arena_t* arena, size_t size) {
+  if (!arena)
+    return malloc(size);
+  if (size == 0)
+    size = 1;
+
+  if (size > arena->large_threshold) {
+    wf_arena_block_t* block = NULL;
+    if (wf_arena_reserve_large(arena, 1) != 0
+        || !(block = wf_arena_block_new(size)))
+      return NULL;
+    block->used = size;
+    wf_arena_put_large(arena, block);
+    return wf_arena_block_data(block);
+  }
+
+  size_t            rounded = WF_ARENA_ROUND(size);
+  wf_arena_block_t* block   = arena->blocks;
+  if (!block || block->size - block->used < rounded) {
+    block = wf_arena_block_new(arena->block_size);
+    if (!block)
+      return NULL;
+    block->next   = arena->blocks;
+    arena->blocks = block;
+  }
+  void* p = wf_arena_block_data(block) + block->used;
+  block->used += rounded;
+  return p;
+}
+
+void* wf_arena_calloc(wf_arena_t* arena, size_t count, size_t size) {
+  if (!arena)
+    return calloc(count, size);
+  if (size && count > SIZE_MAX / size)
+    return NULL;
+  void* p = wf_arena_alloc(arena, count * size);
+  if (p)
+    memset(p, 0, count * size);
+  return p;
+}
+
+void* wf_arena_realloc(wf_arena_t* arena, void* ptr, size_t old_size,
+                       size_t new_size) {
+  if (!arena)
+    return realloc(ptr, new_size);
+  if (!ptr)
+    return wf_arena_alloc(arena, new_size);
+  if (new_size <= old_size)
+    return ptr;
+
+  // Only allocations above the threshold get a block of their own
+  size_t slot = old_size > arena->large_threshold
+                  ? wf_arena_find_large(arena, ptr)
+                  : SIZE_MAX;
+  if (slot != SIZE_MAX) {
+    wf_arena_block_t* block = arena->large[slot];
+    wf_arena_block_t* grown = realloc(block, WF_ARENA_HEADER + new_size);
+    if (!grown)
+      return NULL;
+    if (grown != block) {
+      wf_arena_remove_large(arena, slot);
+      wf_arena_put_large(arena, grown);
+    }
+    grown->size = new_size;
+    grown->used = new_size;
+    return wf_arena_block_data(grown);
+  }
+
+  // Extend the most recent small allocation in place
+  wf_arena_block_t* block = arena->blocks;
+  if (block && new_size <= arena->large_threshold) {
+    char*  data      = wf_arena_block_data(block);
+    size_t old_round = WF_ARENA_ROUND(old_size);
+    size_t new_round = WF_ARENA_ROUND(new_size);
+    if ((char*)ptr + old_round == data + block->used
+        && block->used - old_round + new_round <= block->size) {
+      block->used += new_round - old_round;
+      return ptr;
+    }
+  }
+
+  void* p = wf_arena_alloc(arena, new_size);
+  if (p)
+    memcpy(p, ptr, old_size);
+  return p;
+}
+
+void wf_arena_free(wf_arena_t* arena, void* ptr) {
+  if (!arena) {
+    free(ptr);
+    return;
+  }
+  if (!ptr)
+    return;
+  size_t slot = wf_arena_find_large(arena, ptr);
+  if (slot != SIZE_MAX) {
+    free(arena->large[slot]);
+    wf_arena_remove_large(arena, slot);
+  }
+}
+
+char* wf_arena_strndup(wf_arena_t* arena, const char* str, size_t n) {
+  if (!str)
+    return NULL;
+  if (!arena)
+    return wf_strndup(str, n);
+  size_t len = 0;
+  while (len < n && str[len])
+    len++;
+  char* copy = wf_arena_alloc(arena, len + 1);
+  if (copy) {
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+  }
+  return copy;
+}
+
+char* wf_arena_strdup(wf_arena_t* arena, const char* str) {
+  if (!str)
+    return NULL;
+  if (!arena)
+    return wf_strdup(str);
+  return wf_arena_strndup(arena, str, strlen(str));
+}
+
+void* wf_arena_realloc_array(wf_arena_t* arena, void* ptr, size_t* capacity,
+                             size_t count, size_t element_size) {
+  if (!arena)
+    return wf_realloc_array(ptr, capacity, count, element_size);
+  if (!capacity)
+    return NULL;
+  if (count <= *capacity)
+    return ptr;
+
+  size_t new_capacity = *capacity ? *capacity * 2 : 16;
+  if (new_capacity < count)
+    new_capacity = count;
+  void* new_ptr = wf_arena_realloc(arena, ptr, *capacity * element_size,
+                                   new_capacity * element_size);
+  if (new_ptr)
+    *capacity = new_capacity;
+  return new_ptr;
+}
+
+int wf_arena_attach(wf_arena_t* arena, void* data, size_t size,
+                    void (*release)(void* data, size_t size)) {
+  wf_arena_extern_t* ext = malloc(sizeof(wf_arena_extern_t));
+  if (!arena || !ext) {
+    free(ext);
+    return -1;
+  }
+  ext->next       = arena->external;
+  ext->data       = data;
+  ext->size       = size;
+  ext->release    = release;
+  arena->external = ext;
+  return 0;
+}
+
+int wf_arena_adopt(wf_arena_t* dst, wf_arena_t* src) {
+  if (!dst || !src)
+    return 0;
+  if (wf_arena_reserve_large(dst, src->large_count) != 0)
+    return -1;
+
+  // Keep dst's current block first so it stays the bump target
+  wf_arena_block_t** link = dst->blocks ? &dst->blocks->next : &dst->blocks;
+  wf_arena_block_t*  tail = src->blocks;
+  if (tail) {
+    while (tail->next)
+      tail = tail->next;
+    tail->next = *link;
+    *link      = src->blocks;
+  }
+
+  for (size_t i = 0; i < src->large_slots; i++) {
+    if (src->large[i])
+      wf_arena_put_large(dst, src->large[i]);
+  }
+  free(src->large);
+
+  wf_arena_extern_t* ext = src->external;
+  if (ext) {
+    while (ext->next)
+      ext = ext->next;
+    ext->next     = dst->external;
+    dst->external = src->external;
+  }
+
+  free(src);
+  return 0;
+}
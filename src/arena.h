@@ -0,0 +1,59 @@
+// src/arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump allocator owning every allocation of a scene. Small requests are
+// carved from shared blocks, large ones get a block of their own so they can
+// still be resized with realloc. Not thread-safe: give each thread its own
+// arena and combine them with wf_arena_adopt.
+//
+// Every function accepts a NULL arena and then behaves like the matching
+// malloc/realloc/free call, so callers can share one code path.
+typedef struct wf_arena_s wf_arena_t;
+
+// Create an arena; block_size 0 selects the default
+wf_arena_t* wf_arena_create(size_t block_size);
+
+// Release every block in one pass
+void wf_arena_destroy(wf_arena_t* arena);
+
+void* wf_arena_alloc(wf_arena_t* arena, size_t size);
+void* wf_arena_calloc(wf_arena_t* arena, size_t count, size_t size);
+
+// Grow an allocation of old_size bytes, the size it was allocated or last
+// grown to. The last small allocation and large allocations are resized in
+// place when possible.
+void* wf_arena_realloc(wf_arena_t* arena, void* ptr, size_t old_size,
+                       size_t new_size);
+
+// Frees large allocations early, small ones live until the arena is gone
+void wf_arena_free(wf_arena_t* arena, void* ptr);
+
+char* wf_arena_strdup(wf_arena_t* arena, const char* str);
+char* wf_arena_strndup(wf_arena_t* arena, const char* str, size_t n);
+
+// wf_realloc_array counterpart with the same growth policy
+void* wf_arena_realloc_array(wf_arena_t* arena, void* ptr, size_t* capacity,
+                             size_t count, size_t element_size);
+
+// Hand memory the arena did not allocate, such as a file mapping, over to
+// it: release(data, size) runs when the arena is destroyed. Returns 0 on
+// success, -1 when out of memory, in which case nothing is released.
+int wf_arena_attach(wf_arena_t* arena, void* data, size_t size,
+                    void (*release)(void* data, size_t size));
+
+// Move every block of src into dst and destroy src. Returns 0 on success,
+// -1 when out of memory, in which case both arenas are left unchanged.
+int wf_arena_adopt(wf_arena_t* dst, wf_arena_t* src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARENA_H
@@ -0,0 +1,125 @@
+// src/async.c
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+#include "log.h"
+#include "thread_pool.h"
+#include "wavefront.h"
+
+struct wf_load_s {
+  char*              filename;
+  wf_parse_options_t options;
+  wf_load_callback_t completion;
+  void*              user;
+  wf_scene_t         scene;
+  wf_error_t         result;
+  volatile int       cancel; /**< Accessed with WF_ATOMIC_LOAD and
+                                  WF_ATOMIC_STORE only */
+  int                done; /**< Guarded by lock */
+  pthread_mutex_t    lock;
+  pthread_cond_t     done_cond;
+};
+
+// Shared by every load for the life of the process
+static pthread_once_t    wf_load_pool_once = PTHREAD_ONCE_INIT;
+static wf_thread_pool_t* wf_load_pool;
+
+static void wf_load_pool_create(void) {
+  wf_load_pool = wf_thread_pool_create(0);
+}
+
+static void wf_load_task(void* arg) {
+  wf_load_t* load   = (wf_load_t*)arg;
+  wf_error_t result = WF_ERROR_CANCELLED;
+  if (!WF_ATOMIC_LOAD(&load->cancel))
+    result = wf_load_obj(load->filename, &load->scene, &load->options);
+
+  // Nothing of a cancelled parse is kept but the reason
+  if (result == WF_ERROR_CANCELLED) {
+    wf_free_scene(&load->scene);
+    load->scene.error_message = wf_strdup("Loading cancelled");
+    LOG_DEBUG("Cancelled loading %s", load->filename);
+  }
+  if (load->completion)
+    load->completion(load->user, result, &load->scene);
+
+  pthread_mutex_lock(&load->lock);
+  load->result = result;
+  load->done   = 1;
+  pthread_cond_broadcast(&load->done_cond);
+  pthread_mutex_unlock(&load->lock);
+}
+
+wf_load_t* wf_load_obj_async(const char*               filename,
+                             const wf_parse_options_t* options,
+                             wf_load_callback_t completion, void* user) {
+  if (!filename) {
+    return NULL;
+  }
+  pthread_once(&wf_load_pool_once, wf_load_pool_create);
+  if (!wf_load_pool)
+    return NULL;
+
+  wf_load_t* load = calloc(1, sizeof(wf_load_t));
+  if (!load)
+    return NULL;
+  load->filename = wf_strdup(filename);
+  if (!load->filename) {
+    free(load);
+    return NULL;
+  }
+  wf_parse_options_init(&load->options);
+  if (options)
+    load->options = *options;
+  load->options.cancel = &load->cancel;
+  load->completion     = completion;
+  load->user           = user;
+  pthread_mutex_init(&load->lock, NULL);
+  pthread_cond_init(&load->done_cond, NULL);
+
+  if (wf_thread_pool_submit(wf_load_pool, wf_load_task, load) != 0) {
+    pthread_mutex_destroy(&load->lock);
+    pthread_cond_destroy(&load->done_cond);
+    free(load->filename);
+    free(load);
+    return NULL;
+  }
+  return load;
+}
+
+int wf_load_poll(wf_load_t* load) {
+  if (!load)
+    return 0;
+  pthread_mutex_lock(&load->lock);
+  int done = load->done;
+  pthread_mutex_unlock(&load->lock);
+  return done;
+}
+
+void wf_load_cancel(wf_load_t* load) {
+  if (load)
+    WF_ATOMIC_STORE(&load->cancel, 1);
+}
+
+wf_error_t wf_load_wait(wf_load_t* load, wf_scene_t* scene) {
+  if (!load) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+
+  pthread_mutex_lock(&load->lock);
+  while (!load->done)
+    pthread_cond_wait(&load->done_cond, &load->lock);
+  pthread_mutex_unlock(&load->lock);
+
+  wf_error_t result = load->result;
+  if (scene)
+    *scene = load->scene;
+  else
+    wf_free_scene(&load->scene);
+  pthread_mutex_destroy(&load->lock);
+  pthread_cond_destroy(&load->done_cond);
+  free(load->filename);
+  free(load);
+  return result;
+}
@@ -0,0 +1,400 @@
+// src/bounds.c
+#include "bounds.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "thread_pool.h"
+
+// x86 gets SSE kernels, plus AVX ones picked at run time where the compiler
+// can target AVX per function. Define WF_BOUNDS_NO_SIMD to force scalar code.
+#if !defined(WF_BOUNDS_NO_SIMD)
+#  if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE__)           \
+      && defined(__GNUC__)
+#    include <immintrin.h>
+#    define WF_BOUNDS_SSE 1
+#    define WF_BOUNDS_AVX 1
+#    define WF_BOUNDS_TARGET_AVX __attribute__((target("avx")))
+#  elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <immintrin.h>
+#    define WF_BOUNDS_SSE 1
+#    ifdef __AVX__
+#      define WF_BOUNDS_AVX 1
+#      define WF_BOUNDS_TARGET_AVX
+#    endif
+#  endif
+#endif
+
+// Vertices per task of the parallel reduction
+#define WF_BOUNDS_MIN_TASK (64 * 1024)
+
+// Min/max of vec3 components over count floats, count a multiple of 3.
+// min and max hold x, y, z and are updated in place.
+static void wf_minmax3_scalar(const float* f, size_t count, float* min,
+                              float* max) {
+  for (size_t i = 0; i < count; i += 3) {
+    for (int c = 0; c < 3; c++) {
+      min[c] = f[i + c] < min[c] ? f[i + c] : min[c];
+      max[c] = f[i + c] > max[c] ? f[i + c] : max[c];
+    }
+  }
+}
+
+// Min/max over count floats
+static void wf_minmax1_scalar(const float* f, size_t count, float* min,
+                              float* max) {
+  for (size_t i = 0; i < count; i++) {
+    *min = f[i] < *min ? f[i] : *min;
+    *max = f[i] > *max ? f[i] : *max;
+  }
+}
+
+// Fold accumulators holding 3 * lanes floats, where float k belongs to
+// component k % 3
+static void wf_minmax3_fold(const float* mins, const float* maxs, size_t n,
+                            float* min, float* max) {
+  for (size_t k = 0; k < n; k++) {
+    min[k % 3] = mins[k] < min[k % 3] ? mins[k] : min[k % 3];
+    max[k % 3] = maxs[k] > max[k % 3] ? maxs[k] : max[k % 3];
+  }
+}
+
+#ifdef WF_BOUNDS_SSE
+// Four vertices are three registers: x y z x | y z x y | z x y z
+static void wf_minmax3_sse(const float* f, size_t count, float* min,
+                           float* max) {
+  size_t blocks = count / 12;
+  if (blocks) {
+    __m128 lo0 = _mm_loadu_ps(f), lo1 = _mm_loadu_ps(f + 4);
+    __m128 lo2 = _mm_loadu_ps(f + 8);
+    __m128 hi0 = lo0, hi1 = lo1, hi2 = lo2;
+    for (size_t b = 1; b < blocks; b++) {
+      const float* p = f + b * 12;
+      __m128       a = _mm_loadu_ps(p);
+      __m128       c = _mm_loadu_ps(p + 4);
+      __m128       d = _mm_loadu_ps(p + 8);
+      lo0            = _mm_min_ps(lo0, a);
+      lo1            = _mm_min_ps(lo1, c);
+      lo2            = _mm_min_ps(lo2, d);
+      hi0            = _mm_max_ps(hi0, a);
+      hi1            = _mm_max_ps(hi1, c);
+      hi2            = _mm_max_ps(hi2, d);
+    }
+    float mins[12], maxs[12];
+    _mm_storeu_ps(mins, lo0);
+    _mm_storeu_ps(mins + 4, lo1);
+    _mm_storeu_ps(mins + 8, lo2);
+    _mm_storeu_ps(maxs, hi0);
+    _mm_storeu_ps(maxs + 4, hi1);
+    _mm_storeu_ps(maxs + 8, hi2);
+    wf_minmax3_fold(mins, maxs, 12, min, max);
+  }
+  wf_minmax3_scalar(f + blocks * 12, count - blocks * 12, min, max);
+}
+
+static void wf_minmax1_sse(const float* f, size_t count, float* min,
+                           float* max) {
+  size_t blocks = count / 4;
+  if (blocks) {
+    __m128 lo = _mm_loadu_ps(f), hi = lo;
+    for (size_t b = 1; b < blocks; b++) {
+      __m128 a = _mm_loadu_ps(f + b * 4);
+      lo       = _mm_min_ps(lo, a);
+      hi       = _mm_max_ps(hi, a);
+    }
+    float mins[4], maxs[4];
+    _mm_storeu_ps(mins, lo);
+    _mm_storeu_ps(maxs, hi);
+    wf_minmax1_scalar(mins, 4, min, max);
+    wf_minmax1_scalar(maxs, 4, min, max);
+  }
+  wf_minmax1_scalar(f + blocks * 4, count - blocks * 4, min, max);
+}
+#endif
+
+#ifdef WF_BOUNDS_AVX
+// Eight vertices are three registers, component of float k is k % 3
+WF_BOUNDS_TARGET_AVX
+static void wf_minmax3_avx(const float* f, size_t count, float* min,
+                           float* max) {
+  size_t blocks = count / 24;
+  if (blocks) {
+    __m256 lo0 = _mm256_loadu_ps(f), lo1 = _mm256_loadu_ps(f + 8);
+    __m256 lo2 = _mm256_loadu_ps(f + 16);
+    __m256 hi0 = lo0, hi1 = lo1, hi2 = lo2;
+    for (size_t b = 1; b < blocks; b++) {
+      const float* p = f + b * 24;
+      __m256       a = _mm256_loadu_ps(p);
+      __m256       c = _mm256_loadu_ps(p + 8);
+      __m256       d = _mm256_loadu_ps(p + 16);
+      lo0            = _mm256_min_ps(lo0, a);
+      lo1            = _mm256_min_ps(lo1, c);
+      lo2            = _mm256_min_ps(lo2, d);
+      hi0            = _mm256_max_ps(hi0, a);
+      hi1            = _mm256_max_ps(hi1, c);
+      hi2            = _mm256_max_ps(hi2, d);
+    }
+    float mins[24], maxs[24];
+    _mm256_storeu_ps(mins, lo0);
+    _mm256_storeu_ps(mins + 8, lo1);
+    _mm256_storeu_ps(mins + 16, lo2);
+    _mm256_storeu_ps(maxs, hi0);
+    _mm256_storeu_ps(maxs + 8, hi1);
+    _mm256_storeu_ps(maxs + 16, hi2);
+    wf_minmax3_fold(mins, maxs, 24, min, max);
+  }
+  wf_minmax3_scalar(f + blocks * 24, count - blocks * 24, min, max);
+}
+
+WF_BOUNDS_TARGET_AVX
+static void wf_minmax1_avx(const float* f, size_t count, float* min,
+                           float* max) {
+  size_t blocks = count / 8;
+  if (blocks) {
+    __m256 lo = _mm256_loadu_ps(f), hi = lo;
+    for (size_t b = 1; b < blocks; b++) {
+      __m256 a = _mm256_loadu_ps(f + b * 8);
+      lo       = _mm256_min_ps(lo, a);
+      hi       = _mm256_max_ps(hi, a);
+    }
+    float mins[8], maxs[8];
+    _mm256_storeu_ps(mins, lo);
+    _mm256_storeu_ps(maxs, hi);
+    wf_minmax1_scalar(mins, 8, min, max);
+    wf_minmax1_scalar(maxs, 8, min, max);
+  }
+  wf_minmax1_scalar(f + blocks * 8, count - blocks * 8, min, max);
+}
+
+static int wf_bounds_have_avx(void) {
+#  ifdef __GNUC__
+  return __builtin_cpu_supports("avx");
+#  else
+  return 1;
+#  endif
+}
+#endif
+
+typedef void (*wf_minmax_fn_t)(const float*, size_t, float*, float*);
+
+typedef struct {
+  wf_minmax_fn_t minmax3;
+  wf_minmax_fn_t minmax1;
+} wf_bounds_kernels_t;
+
+static wf_bounds_kernels_t wf_bounds_kernels(void) {
+  wf_bounds_kernels_t k = { wf_minmax3_scalar, wf_minmax1_scalar };
+#if defined(WF_BOUNDS_AVX)
+  if (wf_bounds_have_avx()) {
+    k.minmax3 = wf_minmax3_avx;
+    k.minmax1 = wf_minmax1_avx;
+    return k;
+  }
+#endif
+#if defined(WF_BOUNDS_SSE)
+  k.minmax3 = wf_minmax3_sse;
+  k.minmax1 = wf_minmax1_sse;
+#endif
+  return k;
+}
+
+wf_aabb_t wf_bounds_vertices(const wf_scene_t* scene, size_t first,
+                             size_t count) {
+  wf_bounds_kernels_t k   = wf_bounds_kernels();
+  wf_aabb_t           box = wf_aabb_empty();
+  float               min[3], max[3];
+  memcpy(min, &box.min, sizeof(min));
+  memcpy(max, &box.max, sizeof(max));
+
+  if (scene->soa.alignment) {
+    const wf_soa3_t* soa = &scene->soa.vertices;
+    k.minmax1(soa->xs + first, count, &min[0], &max[0]);
+    k.minmax1(soa->ys + first, count, &min[1], &max[1]);
+    k.minmax1(soa->zs + first, count, &min[2], &max[2]);
+  } else if (count) {
+    k.minmax3(&scene->vertices[first].x, count * 3, min, max);
+  }
+
+  memcpy(&box.min, min, sizeof(min));
+  memcpy(&box.max, max, sizeof(max));
+  return box;
+}
+
+// Work shared by the tasks of wf_scene_compute_bounds
+typedef struct {
+  const wf_scene_t*   scene;
+  const wf_object_t** objects;
+  wf_bounds_t*        bounds;
+} wf_bounds_job_t;
+
+typedef struct {
+  const wf_bounds_job_t* job;
+  size_t                 first; /**< First vertex or object */
+  size_t                 count;
+  int                    objects; /**< Range is objects, not vertices */
+  wf_aabb_t              box;
+} wf_bounds_task_t;
+
+// Box over the vertices the object's faces use, and the smallest sphere
+// around its center that holds them
+static void wf_bounds_object(const wf_scene_t* scene, const wf_object_t* obj,
+                             wf_aabb_t* box, wf_sphere_t* sphere) {
+  *box = wf_aabb_empty();
+  for (size_t i = 0; i < obj->face_count; i++) {
+    for (int j = 0; j < 3; j++) {
+      int v = obj->faces[i].vertices[j].v_idx;
+      if (v >= 0 && (size_t)v < scene->vertex_count)
+        wf_aabb_add(box, wf_scene_vertex(scene, v));
+    }
+  }
+
+  memset(sphere, 0, sizeof(wf_sphere_t));
+  if (box->min.x > box->max.x)
+    return;
+  wf_vec3 c = { (box->min.x + box->max.x) * 0.5f,
+                (box->min.y + box->max.y) * 0.5f,
+                (box->min.z + box->max.z) * 0.5f };
+  float   r2 = 0.0f;
+  for (size_t i = 0; i < obj->face_count; i++) {
+    for (int j = 0; j < 3; j++) {
+      int v = obj->faces[i].vertices[j].v_idx;
+      if (v < 0 || (size_t)v >= scene->vertex_count)
+        continue;
+      wf_vec3 p  = wf_scene_vertex(scene, v);
+      float   dx = p.x - c.x, dy = p.y - c.y, dz = p.z - c.z;
+      float   d2 = dx * dx + dy * dy + dz * dz;
+      r2         = d2 > r2 ? d2 : r2;
+    }
+  }
+  sphere->center = c;
+  sphere->radius = sqrtf(r2);
+}
+
+static void wf_bounds_task(void* arg) {
+  wf_bounds_task_t*      task = arg;
+  const wf_bounds_job_t* job  = task->job;
+  if (!task->objects) {
+    task->box = wf_bounds_vertices(job->scene, task->first, task->count);
+    return;
+  }
+  for (size_t i = task->first; i < task->first + task->count; i++) {
+    wf_bounds_object(job->scene, job->objects[i], &job->bounds->objects[i],
+                     &job->bounds->spheres[i]);
+  }
+}
+
+// Split [0, total) into at most parts ranges of at least min_size
+static size_t wf_bounds_split(wf_bounds_task_t* tasks, const size_t* weights,
+                              size_t total, size_t parts, size_t min_size,
+                              int objects, const wf_bounds_job_t* job) {
+  size_t n = 0;
+  if (!weights) {
+    size_t per = (total + parts - 1) / parts;
+    per        = per < min_size ? min_size : per;
+    for (size_t first = 0; first < total; first += per, n++) {
+      tasks[n]       = (wf_bounds_task_t){ .job = job, .first = first };
+      tasks[n].count = total - first < per ? total - first : per;
+    }
+    return n;
+  }
+
+  // Objects: ranges of roughly equal face counts
+  size_t faces = 0;
+  for (size_t i = 0; i < total; i++)
+    faces += weights[i];
+  size_t per = faces / parts + 1;
+  size_t sum = 0, first = 0;
+  for (size_t i = 0; i < total; i++) {
+    sum += weights[i];
+    if (sum >= per || i + 1 == total) {
+      tasks[n++] = (wf_bounds_task_t){ .job     = job,
+                                       .first   = first,
+                                       .count   = i + 1 - first,
+                                       .objects = objects };
+      first      = i + 1;
+      sum        = 0;
+    }
+  }
+  return n;
+}
+
+wf_error_t wf_scene_compute_bounds(const wf_scene_t*          scene,
+                                   const wf_bounds_options_t* options,
+                                   wf_bounds_t*               bounds) {
+  if (!scene || !bounds) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  memset(bounds, 0, sizeof(wf_bounds_t));
+
+  size_t threads = options ? options->num_threads : 1;
+  if (threads == 0)
+    threads = wf_cpu_count();
+
+  size_t object_count = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next)
+    object_count++;
+
+  wf_bounds_job_t job     = { scene, NULL, bounds };
+  size_t*         faces   = malloc((object_count + 1) * sizeof(size_t));
+  job.objects             = malloc((object_count + 1) * sizeof(*job.objects));
+  bounds->objects         = calloc(object_count + 1, sizeof(wf_aabb_t));
+  bounds->spheres         = calloc(object_count + 1, sizeof(wf_sphere_t));
+  wf_bounds_task_t* tasks = malloc(2 * threads * sizeof(wf_bounds_task_t));
+  wf_error_t        result = WF_ERROR_OUT_OF_MEMORY;
+  if (!faces || !job.objects || !bounds->objects || !bounds->spheres || !tasks)
+    goto done;
+  bounds->object_count = object_count;
+
+  size_t i = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next, i++) {
+    job.objects[i] = obj;
+    faces[i]       = obj->face_count;
+  }
+
+  // Vertex tasks come first; the scene box is theirs, unless parsing
+  // already tracked it
+  size_t vertex_tasks = 0;
+  if (!scene->has_bounds) {
+    vertex_tasks = wf_bounds_split(tasks, NULL, scene->vertex_count, threads,
+                                   WF_BOUNDS_MIN_TASK, 0, &job);
+  }
+  size_t task_count =
+      vertex_tasks
+      + wf_bounds_split(tasks + vertex_tasks, faces, object_count, threads, 1,
+                        1, &job);
+
+  wf_thread_pool_t* pool = NULL;
+  if (threads > 1 && task_count > 1)
+    pool = wf_thread_pool_create(threads);
+  for (size_t t = 0; t < task_count; t++) {
+    if (!pool || wf_thread_pool_submit(pool, wf_bounds_task, &tasks[t]) != 0)
+      wf_bounds_task(&tasks[t]);
+  }
+  if (pool) {
+    wf_thread_pool_wait(pool);
+    wf_thread_pool_destroy(pool);
+  }
+
+  bounds->scene = scene->has_bounds ? scene->bounds : wf_aabb_empty();
+  for (size_t t = 0; t < vertex_tasks; t++)
+    wf_aabb_merge(&bounds->scene, &tasks[t].box);
+  LOG_DEBUG("Bounds of %zu vertices and %zu objects in %zu tasks",
+            scene->vertex_count, object_count, task_count);
+  result = WF_SUCCESS;
+
+done:
+  free(faces);
+  free(job.objects);
+  free(tasks);
+  if (result != WF_SUCCESS)
+    wf_free_bounds(bounds);
+  return result;
+}
+
+void wf_free_bounds(wf_bounds_t* bounds) {
+  if (!bounds)
+    return;
+  free(bounds->objects);
+  free(bounds->spheres);
+  memset(bounds, 0, sizeof(wf_bounds_t));
+}
@@ -0,0 +1,46 @@
+// src/bounds.h
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <float.h>
+#include "wavefront.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline wf_aabb_t wf_aabb_empty(void) {
+  wf_aabb_t box = { { FLT_MAX, FLT_MAX, FLT_MAX },
+                    { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+  return box;
+}
+
+static inline void wf_aabb_add(wf_aabb_t* box, wf_vec3 v) {
+  box->min.x = v.x < box->min.x ? v.x : box->min.x;
+  box->min.y = v.y < box->min.y ? v.y : box->min.y;
+  box->min.z = v.z < box->min.z ? v.z : box->min.z;
+  box->max.x = v.x > box->max.x ? v.x : box->max.x;
+  box->max.y = v.y > box->max.y ? v.y : box->max.y;
+  box->max.z = v.z > box->max.z ? v.z : box->max.z;
+}
+
+static inline void wf_aabb_merge(wf_aabb_t* box, const wf_aabb_t* other) {
+  wf_aabb_t b = *other;
+  box->min.x  = b.min.x < box->min.x ? b.min.x : box->min.x;
+  box->min.y  = b.min.y < box->min.y ? b.min.y : box->min.y;
+  box->min.z  = b.min.z < box->min.z ? b.min.z : box->min.z;
+  box->max.x  = b.max.x > box->max.x ? b.max.x : box->max.x;
+  box->max.y  = b.max.y > box->max.y ? b.max.y : box->max.y;
+  box->max.z  = b.max.z > box->max.z ? b.max.z : box->max.z;
+}
+
+// Box of vertices [first, first + count) of the scene, in either layout,
+// using the widest min/max kernel the processor supports
+wf_aabb_t wf_bounds_vertices(const wf_scene_t* scene, size_t first,
+                             size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOUNDS_H
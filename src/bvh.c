@@ -0,0 +1,440 @@
+// src/bvh.c
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bounds.h"
+#include "log.h"
+#include "thread_pool.h"
+#include "wavefront.h"
+
+#define WF_BVH_MAX_DEPTH 64
+#define WF_BVH_MAX_BINS  64
+
+// Subtrees with fewer triangles are built by the task that reached them
+#define WF_BVH_TASK_MIN 4096
+
+// Build state shared by all tasks. A subtree of n triangles owns 2n - 2
+// node slots for its descendants, so tasks never need to coordinate; the
+// unused slots of multi-triangle leaves are squeezed out afterwards.
+typedef struct {
+  const wf_aabb_t*  boxes;
+  const wf_vec3*    centroids;
+  uint32_t*         refs; /**< Triangle of each slot, reordered by splits */
+  wf_bvh_node_t*    nodes;
+  wf_thread_pool_t* pool;
+  size_t            max_leaf;
+  size_t            bins;
+} wf_bvh_builder_t;
+
+typedef struct {
+  wf_bvh_builder_t* builder;
+  uint32_t          node;
+  uint32_t          children; /**< First slot for the node's descendants */
+  uint32_t          begin;
+  uint32_t          end;
+  unsigned          depth;
+} wf_bvh_task_t;
+
+static float wf_aabb_area(const wf_aabb_t* box) {
+  float dx = box->max.x - box->min.x;
+  float dy = box->max.y - box->min.y;
+  float dz = box->max.z - box->min.z;
+  return dx * dy + dy * dz + dz * dx;
+}
+
+static float wf_vec3_axis(wf_vec3 v, int axis) {
+  return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+static size_t wf_bvh_bin(float c, float lo, float scale, size_t bins) {
+  float  f = (c - lo) * scale;
+  size_t k = f > 0.0f ? (size_t)f : 0;
+  return k < bins ? k : bins - 1;
+}
+
+// Pick the cheapest binned SAH split of [begin, end) and partition refs by
+// it. Returns the first triangle of the right half, or begin for a leaf.
+static uint32_t wf_bvh_split(wf_bvh_builder_t* b, uint32_t begin,
+                             uint32_t end, const wf_aabb_t* box,
+                             const wf_aabb_t* centroid_box) {
+  size_t n         = end - begin;
+  size_t bins      = b->bins;
+  float  best_cost = FLT_MAX;
+  int    best_axis = -1;
+  size_t best_bin  = 0;
+  float  lo[3], scale[3];
+
+  for (int axis = 0; axis < 3; axis++) {
+    lo[axis]     = wf_vec3_axis(centroid_box->min, axis);
+    float extent = wf_vec3_axis(centroid_box->max, axis) - lo[axis];
+    if (!(extent > 0.0f))
+      continue;
+    scale[axis] = bins / extent;
+
+    wf_aabb_t bin_box[WF_BVH_MAX_BINS];
+    size_t    bin_count[WF_BVH_MAX_BINS] = { 0 };
+    for (size_t k = 0; k < bins; k++)
+      bin_box[k] = wf_aabb_empty();
+    for (uint32_t i = begin; i < end; i++) {
+      uint32_t r = b->refs[i];
+      size_t   k = wf_bvh_bin(wf_vec3_axis(b->centroids[r], axis), lo[axis],
+                              scale[axis], bins);
+      bin_count[k]++;
+      wf_aabb_merge(&bin_box[k], &b->boxes[r]);
+    }
+
+    // Right-hand areas and counts for a split after each bin
+    float     right_area[WF_BVH_MAX_BINS];
+    size_t    right_count[WF_BVH_MAX_BINS];
+    wf_aabb_t acc   = wf_aabb_empty();
+    size_t    count = 0;
+    for (size_t k = bins - 1; k > 0; k--) {
+      wf_aabb_merge(&acc, &bin_box[k]);
+      count += bin_count[k];
+      right_area[k - 1]  = count ? wf_aabb_area(&acc) : 0.0f;
+      right_count[k - 1] = count;
+    }
+
+    acc   = wf_aabb_empty();
+    count = 0;
+    for (size_t k = 0; k + 1 < bins; k++) {
+      wf_aabb_merge(&acc, &bin_box[k]);
+      count += bin_count[k];
+      if (count == 0 || right_count[k] == 0)
+        continue;
+      float cost = wf_aabb_area(&acc) * count + right_area[k] * right_count[k];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin  = k;
+      }
+    }
+  }
+
+  // Traversing a node costs about as much as one triangle test
+  if (best_axis < 0)
+    return n <= b->max_leaf ? begin : begin + (uint32_t)(n / 2);
+  float area = wf_aabb_area(box);
+  if (n <= b->max_leaf && (area <= 0.0f || 1.0f + best_cost / area >= n))
+    return begin;
+
+  uint32_t i = begin, j = end;
+  while (i < j) {
+    uint32_t r = b->refs[i];
+    size_t   k = wf_bvh_bin(wf_vec3_axis(b->centroids[r], best_axis),
+                            lo[best_axis], scale[best_axis], bins);
+    if (k <= best_bin) {
+      i++;
+    } else {
+      b->refs[i]  = b->refs[--j];
+      b->refs[j]  = r;
+    }
+  }
+  return i > begin && i < end ? i : begin + (uint32_t)(n / 2);
+}
+
+static void wf_bvh_build_task(void* arg);
+
+static void wf_bvh_build_node(wf_bvh_builder_t* b, uint32_t node,
+                              uint32_t children, uint32_t begin, uint32_t end,
+                              unsigned depth) {
+  for (;;) {
+    wf_aabb_t box      = wf_aabb_empty();
+    wf_aabb_t centroid = wf_aabb_empty();
+    for (uint32_t i = begin; i < end; i++) {
+      wf_aabb_merge(&box, &b->boxes[b->refs[i]]);
+      wf_aabb_add(&centroid, b->centroids[b->refs[i]]);
+    }
+
+    wf_bvh_node_t* out = &b->nodes[node];
+    memcpy(out->min, &box.min, sizeof(out->min));
+    memcpy(out->max, &box.max, sizeof(out->max));
+
+    uint32_t mid = begin;
+    if (end - begin > 1 && depth + 1 < WF_BVH_MAX_DEPTH)
+      mid = wf_bvh_split(b, begin, end, &box, &centroid);
+    if (mid == begin) {
+      out->first = begin;
+      out->count = end - begin;
+      return;
+    }
+    out->first = children;
+    out->count = 0;
+
+    // Left subtree: slots children + 2 onwards, right one after it
+    uint32_t       left = mid - begin;
+    wf_bvh_task_t* task = NULL;
+    if (b->pool && left >= WF_BVH_TASK_MIN)
+      task = malloc(sizeof(wf_bvh_task_t));
+    if (task) {
+      *task = (wf_bvh_task_t){ b, children, children + 2, begin, mid,
+                               depth + 1 };
+      if (wf_thread_pool_submit(b->pool, wf_bvh_build_task, task) != 0) {
+        free(task);
+        task = NULL;
+      }
+    }
+    if (!task)
+      wf_bvh_build_node(b, children, children + 2, begin, mid, depth + 1);
+
+    node     = children + 1;
+    children = children + 2 * left;
+    begin    = mid;
+    depth++;
+  }
+}
+
+static void wf_bvh_build_task(void* arg) {
+  wf_bvh_task_t t = *(wf_bvh_task_t*)arg;
+  free(arg);
+  wf_bvh_build_node(t.builder, t.node, t.children, t.begin, t.end, t.depth);
+}
+
+// Copy the tree reachable from slot 0 into dense depth-first order
+static size_t wf_bvh_compact(const wf_bvh_node_t* slots, wf_bvh_node_t* out) {
+  uint32_t stack[2 * WF_BVH_MAX_DEPTH + 2][2];
+  size_t   top   = 0;
+  size_t   count = 1;
+  out[0]         = slots[0];
+  stack[top][0]  = 0;
+  stack[top][1]  = 0;
+  top++;
+  while (top > 0) {
+    top--;
+    uint32_t from = stack[top][0], to = stack[top][1];
+    if (slots[from].count)
+      continue;
+    uint32_t child  = slots[from].first;
+    out[to].first   = (uint32_t)count;
+    out[count]      = slots[child];
+    out[count + 1]  = slots[child + 1];
+    stack[top][0]   = child + 1;
+    stack[top++][1] = (uint32_t)count + 1;
+    stack[top][0]   = child;
+    stack[top++][1] = (uint32_t)count;
+    count += 2;
+  }
+  return count;
+}
+
+wf_error_t wf_bvh_build(const wf_scene_t* scene, const wf_face* triangles,
+                        size_t triangle_count, const wf_bvh_options_t* options,
+                        wf_bvh_t* bvh) {
+  if (!scene || !bvh || (!triangles && triangle_count)) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  memset(bvh, 0, sizeof(wf_bvh_t));
+  if (triangle_count > (size_t)INT32_MAX + 1)
+    return WF_ERROR_UNSUPPORTED_FEATURE;
+
+  wf_bvh_options_t opts = { .num_threads = 1 };
+  if (options)
+    opts = *options;
+  if (opts.num_threads == 0)
+    opts.num_threads = wf_cpu_count();
+  if (opts.max_leaf_size == 0)
+    opts.max_leaf_size = 4;
+  if (opts.bin_count == 0)
+    opts.bin_count = 16;
+  if (opts.bin_count < 2)
+    opts.bin_count = 2;
+  if (opts.bin_count > WF_BVH_MAX_BINS)
+    opts.bin_count = WF_BVH_MAX_BINS;
+
+  size_t     slot_count = triangle_count ? 2 * triangle_count - 1 : 1;
+  wf_vec3*   corners    = malloc((triangle_count + 1) * 3 * sizeof(wf_vec3));
+  wf_aabb_t* boxes      = malloc((triangle_count + 1) * sizeof(wf_aabb_t));
+  wf_vec3*   centroids  = malloc((triangle_count + 1) * sizeof(wf_vec3));
+  uint32_t*  source     = malloc((triangle_count + 1) * sizeof(uint32_t));
+  uint32_t*  refs       = malloc((triangle_count + 1) * sizeof(uint32_t));
+  wf_bvh_node_t* slots  = malloc(slot_count * sizeof(wf_bvh_node_t));
+  wf_error_t     result = WF_ERROR_OUT_OF_MEMORY;
+  if (!corners || !boxes || !centroids || !source || !refs || !slots)
+    goto done;
+
+  // Triangles with a valid position index for every corner
+  size_t n = 0;
+  for (size_t i = 0; i < triangle_count; i++) {
+    const wf_face* tri   = &triangles[i];
+    int            valid = 1;
+    for (int j = 0; j < 3; j++) {
+      int v = tri->vertices[j].v_idx;
+      valid &= v >= 0 && (size_t)v < scene->vertex_count;
+    }
+    if (!valid)
+      continue;
+    boxes[n] = wf_aabb_empty();
+    for (int j = 0; j < 3; j++) {
+      corners[3 * n + j] = wf_scene_vertex(scene, tri->vertices[j].v_idx);
+      wf_aabb_add(&boxes[n], corners[3 * n + j]);
+    }
+    centroids[n].x = (boxes[n].min.x + boxes[n].max.x) * 0.5f;
+    centroids[n].y = (boxes[n].min.y + boxes[n].max.y) * 0.5f;
+    centroids[n].z = (boxes[n].min.z + boxes[n].max.z) * 0.5f;
+    source[n]      = (uint32_t)i;
+    refs[n]        = (uint32_t)n;
+    n++;
+  }
+  if (n == 0) {
+    result = WF_SUCCESS;
+    goto done;
+  }
+
+  wf_bvh_builder_t builder = { .boxes     = boxes,
+                               .centroids = centroids,
+                               .refs      = refs,
+                               .nodes     = slots,
+                               .max_leaf  = opts.max_leaf_size,
+                               .bins      = opts.bin_count };
+  if (opts.num_threads > 1 && n >= 2 * WF_BVH_TASK_MIN)
+    builder.pool = wf_thread_pool_create(opts.num_threads);
+  wf_bvh_build_node(&builder, 0, 1, 0, (uint32_t)n, 0);
+  if (builder.pool) {
+    wf_thread_pool_wait(builder.pool);
+    wf_thread_pool_destroy(builder.pool);
+  }
+
+  bvh->nodes     = malloc((2 * n - 1) * sizeof(wf_bvh_node_t));
+  bvh->positions = malloc(3 * n * sizeof(wf_vec3));
+  bvh->indices   = malloc(n * sizeof(uint32_t));
+  if (!bvh->nodes || !bvh->positions || !bvh->indices)
+    goto done;
+  bvh->node_count     = wf_bvh_compact(slots, bvh->nodes);
+  bvh->triangle_count = n;
+  for (size_t i = 0; i < n; i++) {
+    memcpy(&bvh->positions[3 * i], &corners[3 * refs[i]], 3 * sizeof(wf_vec3));
+    bvh->indices[i] = source[refs[i]];
+  }
+
+  wf_bvh_node_t* shrunk =
+      realloc(bvh->nodes, bvh->node_count * sizeof(wf_bvh_node_t));
+  if (shrunk)
+    bvh->nodes = shrunk;
+  LOG_DEBUG("BVH over %zu triangles: %zu nodes", n, bvh->node_count);
+  result = WF_SUCCESS;
+
+done:
+  free(corners);
+  free(boxes);
+  free(centroids);
+  free(source);
+  free(refs);
+  free(slots);
+  if (result != WF_SUCCESS)
+    wf_free_bvh(bvh);
+  return result;
+}
+
+// Entry distance of the ray into a node, 0 if it starts inside
+static int wf_bvh_slab(const wf_bvh_node_t* node, const float* o,
+                       const float* inv, float t_max, float* t_near) {
+  float t0 = 0.0f, t1 = t_max;
+  for (int a = 0; a < 3; a++) {
+    float ta = (node->min[a] - o[a]) * inv[a];
+    float tb = (node->max[a] - o[a]) * inv[a];
+    if (ta > tb) {
+      float t = ta;
+      ta      = tb;
+      tb      = t;
+    }
+    t0 = ta > t0 ? ta : t0;
+    t1 = tb < t1 ? tb : t1;
+  }
+  *t_near = t0;
+  return t0 <= t1;
+}
+
+// Moller-Trumbore ray/triangle test
+static int wf_bvh_triangle(const wf_vec3* p, wf_vec3 o, wf_vec3 d, float* t,
+                           float* u, float* v) {
+  wf_vec3 e1  = { p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z };
+  wf_vec3 e2  = { p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z };
+  wf_vec3 q   = { d.y * e2.z - d.z * e2.y, d.z * e2.x - d.x * e2.z,
+                  d.x * e2.y - d.y * e2.x };
+  float   det = e1.x * q.x + e1.y * q.y + e1.z * q.z;
+  if (det == 0.0f)
+    return 0;
+  float   inv = 1.0f / det;
+  wf_vec3 s   = { o.x - p[0].x, o.y - p[0].y, o.z - p[0].z };
+  *u          = (s.x * q.x + s.y * q.y + s.z * q.z) * inv;
+  if (*u < 0.0f || *u > 1.0f)
+    return 0;
+  wf_vec3 r = { s.y * e1.z - s.z * e1.y, s.z * e1.x - s.x * e1.z,
+                s.x * e1.y - s.y * e1.x };
+  *v        = (d.x * r.x + d.y * r.y + d.z * r.z) * inv;
+  if (*v < 0.0f || *u + *v > 1.0f)
+    return 0;
+  *t = (e2.x * r.x + e2.y * r.y + e2.z * r.z) * inv;
+  return 1;
+}
+
+int wf_bvh_intersect(const wf_bvh_t* bvh, wf_vec3 origin, wf_vec3 direction,
+                     float t_max, wf_bvh_hit_t* hit) {
+  if (!bvh || bvh->node_count == 0)
+    return 0;
+
+  float    o[3]   = { origin.x, origin.y, origin.z };
+  float    inv[3] = { 1.0f / direction.x, 1.0f / direction.y,
+                      1.0f / direction.z };
+  float    best   = t_max;
+  size_t   found  = SIZE_MAX;
+  float    best_u = 0.0f, best_v = 0.0f;
+  uint32_t stack[WF_BVH_MAX_DEPTH];
+  size_t   top  = 0;
+  uint32_t node = 0;
+  float    t_near;
+
+  if (!wf_bvh_slab(&bvh->nodes[0], o, inv, best, &t_near))
+    return 0;
+  for (;;) {
+    const wf_bvh_node_t* n = &bvh->nodes[node];
+    if (n->count) {
+      for (uint32_t i = n->first; i < n->first + n->count; i++) {
+        float t, u, v;
+        if (wf_bvh_triangle(&bvh->positions[3 * i], origin, direction, &t, &u,
+                            &v)
+            && t > 0.0f && t < best) {
+          best   = t;
+          best_u = u;
+          best_v = v;
+          found  = i;
+        }
+      }
+    } else {
+      // Visit the nearer child first, keep the other for later
+      uint32_t left = n->first, right = n->first + 1;
+      float    tl, tr;
+      int      hl = wf_bvh_slab(&bvh->nodes[left], o, inv, best, &tl);
+      int      hr = wf_bvh_slab(&bvh->nodes[right], o, inv, best, &tr);
+      if (hl && hr) {
+        node         = tl <= tr ? left : right;
+        stack[top++] = tl <= tr ? right : left;
+        continue;
+      }
+      if (hl || hr) {
+        node = hl ? left : right;
+        continue;
+      }
+    }
+    if (top == 0)
+      break;
+    node = stack[--top];
+  }
+
+  if (found == SIZE_MAX)
+    return 0;
+  hit->t        = best;
+  hit->u        = best_u;
+  hit->v        = best_v;
+  hit->triangle = bvh->indices[found];
+  return 1;
+}
+
+void wf_free_bvh(wf_bvh_t* bvh) {
+  if (!bvh)
+    return;
+  free(bvh->nodes);
+  free(bvh->positions);
+  free(bvh->indices);
+  memset(bvh, 0, sizeof(wf_bvh_t));
+}
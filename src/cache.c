@@ -0,0 +1,909 @@
+// src/cache.c
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "arena.h"
+#include "bounds.h"
+#include "file_io.h"
+#include "index_codec.h"
+#include "lib.h"
+#include "log.h"
+#include "material_run.h"
+#include "name_index.h"
+#include "wavefront.h"
+
+// Binary scene file: a header followed by sections, each starting on a
+// 64-byte boundary. Objects and materials are stored as the structs
+// themselves with every pointer replaced by a file offset (0 for NULL), so
+// loading only has to add the base address of the mapping. With
+// WF_CACHE_PACKED_FACES the faces section is empty and every object's faces
+// are encoded in the packed faces section instead.
+#define WF_CACHE_VERSION      4
+#define WF_CACHE_ALIGN        64
+#define WF_CACHE_BYTE_ORDER   0x01020304u
+#define WF_CACHE_PACKED_FACES 1u
+#define WF_CACHE_ROUND(n)                                                      \
+  (((n) + WF_CACHE_ALIGN - 1) & ~(uint64_t)(WF_CACHE_ALIGN - 1))
+
+static const char WF_CACHE_MAGIC[8] = { 'W', 'F', 'S', 'C', 'E', 'N', 'E', 0 };
+
+typedef enum {
+  WF_CACHE_VERTICES = 0,
+  WF_CACHE_TEXCOORDS,
+  WF_CACHE_NORMALS,
+  WF_CACHE_PARAMETERS,
+  WF_CACHE_MATERIALS,
+  WF_CACHE_OBJECTS,
+  WF_CACHE_FACES,
+  WF_CACHE_RUNS,
+  WF_CACHE_PACKED,
+  WF_CACHE_STRINGS,
+  WF_CACHE_SECTION_COUNT
+} wf_cache_section_id_t;
+
+static const size_t WF_CACHE_ELEMENT_SIZE[WF_CACHE_SECTION_COUNT] = {
+  [WF_CACHE_VERTICES]   = sizeof(wf_vec3),
+  [WF_CACHE_TEXCOORDS]  = sizeof(wf_vec3),
+  [WF_CACHE_NORMALS]    = sizeof(wf_vec3),
+  [WF_CACHE_PARAMETERS] = sizeof(wf_vec4),
+  [WF_CACHE_MATERIALS]  = sizeof(wf_material_t),
+  [WF_CACHE_OBJECTS]    = sizeof(wf_object_t),
+  [WF_CACHE_FACES]      = sizeof(wf_face),
+  [WF_CACHE_RUNS]       = sizeof(wf_material_run_t),
+  [WF_CACHE_PACKED]     = 1,
+  [WF_CACHE_STRINGS]    = 1,
+};
+
+typedef struct {
+  uint64_t offset;
+  uint64_t count; /**< Elements, bytes for strings */
+} wf_cache_section_t;
+
+// Source file a sidecar cache was built from, all zero for plain saves
+typedef struct {
+  uint64_t size;
+  int64_t  mtime;
+  uint64_t hash;
+  uint32_t parse_flags; /**< Options that change the parsed scene */
+  uint32_t reserved;
+} wf_cache_key_t;
+
+typedef struct {
+  char               magic[8];
+  uint32_t           version;
+  uint32_t           byte_order; /**< WF_CACHE_BYTE_ORDER as written */
+  uint16_t           pointer_size;
+  uint16_t           face_size;
+  uint16_t           object_size;
+  uint16_t           material_size;
+  uint16_t           run_size;
+  uint16_t           flags;
+  uint16_t           reserved[2];
+  uint64_t           file_size;
+  wf_cache_key_t     key;
+  uint64_t           source_path; /**< String offset, 0 for plain saves */
+  wf_cache_section_t sections[WF_CACHE_SECTION_COUNT];
+} wf_cache_header_t;
+
+static const wf_binary_options_t DEFAULT_BINARY_OPTIONS = { .use_mmap = 1 };
+
+void wf_binary_options_init(wf_binary_options_t* options) {
+  if (options) {
+    *options = DEFAULT_BINARY_OPTIONS;
+  }
+}
+
+static int wf_cache_little_endian(void) {
+  const uint32_t one = 1;
+  return *(const unsigned char*)&one == 1;
+}
+
+static void wf_cache_header_init(wf_cache_header_t* header) {
+  memset(header, 0, sizeof(wf_cache_header_t));
+  memcpy(header->magic, WF_CACHE_MAGIC, sizeof(WF_CACHE_MAGIC));
+  header->version       = WF_CACHE_VERSION;
+  header->byte_order    = WF_CACHE_BYTE_ORDER;
+  header->pointer_size  = sizeof(void*);
+  header->face_size     = sizeof(wf_face);
+  header->object_size   = sizeof(wf_object_t);
+  header->material_size = sizeof(wf_material_t);
+  header->run_size      = sizeof(wf_material_run_t);
+}
+
+// Strings section being built; offsets are relative to the file start
+typedef struct {
+  char*    data;
+  size_t   size;
+  size_t   cap;
+  uint64_t base;
+  int      failed;
+} wf_cache_strings_t;
+
+static uint64_t wf_cache_add_string(wf_cache_strings_t* strings,
+                                    const char*         str) {
+  if (!str)
+    return 0;
+  size_t len = strlen(str) + 1;
+  char*  data =
+      wf_realloc_array(strings->data, &strings->cap, strings->size + len, 1);
+  if (!data) {
+    strings->failed = 1;
+    return 0;
+  }
+  memcpy(data + strings->size, str, len);
+  strings->data = data;
+  strings->size += len;
+  return strings->base + strings->size - len;
+}
+
+#define WF_CACHE_STORE(type, offset) ((type)(uintptr_t)(offset))
+#define WF_CACHE_STORE_STRING(strings, str)                                    \
+  WF_CACHE_STORE(char*, wf_cache_add_string(strings, str))
+
+static void wf_cache_store_material(wf_material_t*       out,
+                                    const wf_material_t* m,
+                                    wf_cache_strings_t*  strings) {
+  *out                  = *m;
+  out->name             = WF_CACHE_STORE_STRING(strings, m->name);
+  out->map_Ka           = WF_CACHE_STORE_STRING(strings, m->map_Ka);
+  out->map_Kd           = WF_CACHE_STORE_STRING(strings, m->map_Kd);
+  out->map_Ks           = WF_CACHE_STORE_STRING(strings, m->map_Ks);
+  out->map_Ns           = WF_CACHE_STORE_STRING(strings, m->map_Ns);
+  out->map_d            = WF_CACHE_STORE_STRING(strings, m->map_d);
+  out->map_Tr           = WF_CACHE_STORE_STRING(strings, m->map_Tr);
+  out->bump             = WF_CACHE_STORE_STRING(strings, m->bump);
+  out->disp             = WF_CACHE_STORE_STRING(strings, m->disp);
+  out->decal            = WF_CACHE_STORE_STRING(strings, m->decal);
+  out->map_options.type = WF_CACHE_STORE_STRING(strings, m->map_options.type);
+}
+
+// Zero-fill the file up to offset
+static int wf_cache_pad(FILE* file, uint64_t* pos, uint64_t offset) {
+  static const char zeros[WF_CACHE_ALIGN] = { 0 };
+  while (*pos < offset) {
+    size_t n = offset - *pos < WF_CACHE_ALIGN ? (size_t)(offset - *pos)
+                                              : WF_CACHE_ALIGN;
+    if (fwrite(zeros, 1, n, file) != n)
+      return -1;
+    *pos += n;
+  }
+  return 0;
+}
+
+static int wf_cache_put(FILE* file, uint64_t* pos, const void* data,
+                        size_t size) {
+  if (size && fwrite(data, 1, size, file) != size)
+    return -1;
+  *pos += size;
+  return 0;
+}
+
+// vec3 attribute from either layout of the scene
+static int wf_cache_put_vec3(FILE* file, uint64_t* pos, const wf_vec3* aos,
+                             const wf_soa3_t* soa, size_t count) {
+  if (aos || !count)
+    return wf_cache_put(file, pos, aos, count * sizeof(wf_vec3));
+
+  wf_vec3 block[1024];
+  for (size_t i = 0; i < count;) {
+    size_t n = 0;
+    for (; n < 1024 && i < count; n++, i++)
+      block[n] = (wf_vec3){ soa->xs[i], soa->ys[i], soa->zs[i] };
+    if (wf_cache_put(file, pos, block, n * sizeof(wf_vec3)) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Packed faces of one object: the vertex, texture coordinate and normal
+// index streams, then smoothing groups as (length, value) runs. The texture
+// coordinate and normal streams start with a mode byte: every index -1 (0),
+// equal to the vertex stream (1) or encoded (2). Face materials are not
+// stored; they come back from the object's material runs.
+static size_t wf_cache_packed_bound(size_t face_count) {
+  return 3 * WF_INDEX_CODEC_BOUND(3 * face_count) + 2 + 10 + 20 * face_count;
+}
+
+static int wf_cache_face_index(const wf_vertex_index* vi, int stream) {
+  return stream == 0 ? vi->v_idx : stream == 1 ? vi->vt_idx : vi->vn_idx;
+}
+
+static unsigned char* wf_cache_pack_smoothing(unsigned char* out,
+                                              const wf_face* faces,
+                                              size_t         count) {
+  size_t runs = 0;
+  for (size_t f = 0; f < count; f++) {
+    if (f == 0 || faces[f].smoothing_group != faces[f - 1].smoothing_group)
+      runs++;
+  }
+  out = wf_put_varint(out, runs);
+  for (size_t f = 0; f < count;) {
+    unsigned value = faces[f].smoothing_group;
+    size_t   end   = f + 1;
+    while (end < count && faces[end].smoothing_group == value)
+      end++;
+    out = wf_put_varint(out, end - f);
+    out = wf_put_varint(out, value);
+    f   = end;
+  }
+  return out;
+}
+
+static unsigned char* wf_cache_pack_object(unsigned char*     out,
+                                           const wf_object_t* obj,
+                                           uint32_t*          scratch) {
+  const wf_face* faces = obj->faces;
+  size_t         count = obj->face_count;
+  for (int stream = 0; stream < 3; stream++) {
+    int absent = 1, same = 1;
+    for (size_t f = 0; f < count; f++) {
+      for (int k = 0; k < 3; k++) {
+        const wf_vertex_index* vi  = &faces[f].vertices[k];
+        int                    idx = wf_cache_face_index(vi, stream);
+        absent &= idx == -1;
+        same &= idx == vi->v_idx;
+        scratch[3 * f + k] = (uint32_t)idx;
+      }
+    }
+    if (stream > 0) {
+      *out++ = absent ? 0 : same ? 1 : 2;
+      if (absent || same)
+        continue;
+    }
+    out = wf_index_encode(out, scratch, 3 * count);
+  }
+  return wf_cache_pack_smoothing(out, faces, count);
+}
+
+// Pack every object's faces into one buffer, recording the size of each
+static wf_error_t wf_cache_pack_faces(const wf_scene_t* scene,
+                                      unsigned char** packed, size_t* size,
+                                      size_t* sizes) {
+  size_t bound = 0, max_faces = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    bound += wf_cache_packed_bound(obj->face_count);
+    if (obj->face_count > max_faces)
+      max_faces = obj->face_count;
+  }
+  uint32_t* scratch = malloc((3 * max_faces + 1) * sizeof(uint32_t));
+  *packed           = malloc(bound + 1);
+  if (!scratch || !*packed) {
+    free(scratch);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+
+  unsigned char* out = *packed;
+  size_t         n   = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next, n++) {
+    unsigned char* end = wf_cache_pack_object(out, obj, scratch);
+    sizes[n]           = (size_t)(end - out);
+    out                = end;
+  }
+  *size = (size_t)(out - *packed);
+  free(scratch);
+  return WF_SUCCESS;
+}
+
+static wf_error_t wf_cache_write(const wf_scene_t* scene, const char* filename,
+                                 const wf_cache_key_t* key,
+                                 const char* source_path, int compress) {
+  if (!wf_cache_little_endian())
+    return WF_ERROR_UNSUPPORTED_FEATURE;
+
+  wf_cache_header_t header;
+  wf_cache_header_init(&header);
+  if (key)
+    header.key = *key;
+
+  size_t object_count = 0, face_count = 0, run_count = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    object_count++;
+    face_count += obj->face_count;
+    run_count += obj->material_run_count;
+  }
+
+  // Packed sizes go before the layout, as they decide the offsets
+  unsigned char* packed       = NULL;
+  size_t*        packed_sizes = NULL;
+  size_t         packed_size  = 0;
+  if (compress) {
+    wf_error_t error = WF_ERROR_OUT_OF_MEMORY;
+    packed_sizes     = malloc((object_count + 1) * sizeof(size_t));
+    if (packed_sizes)
+      error = wf_cache_pack_faces(scene, &packed, &packed_size, packed_sizes);
+    if (error != WF_SUCCESS) {
+      free(packed);
+      free(packed_sizes);
+      return error;
+    }
+    header.flags = WF_CACHE_PACKED_FACES;
+    LOG_DEBUG("Packed %zu faces into %zu bytes", face_count, packed_size);
+  }
+
+  wf_cache_section_t* sec = header.sections;
+  sec[WF_CACHE_VERTICES].count   = scene->vertex_count;
+  sec[WF_CACHE_TEXCOORDS].count  = scene->texcoord_count;
+  sec[WF_CACHE_NORMALS].count    = scene->normal_count;
+  sec[WF_CACHE_PARAMETERS].count = scene->parameter_count;
+  sec[WF_CACHE_MATERIALS].count  = scene->material_count;
+  sec[WF_CACHE_OBJECTS].count    = object_count;
+  sec[WF_CACHE_FACES].count      = compress ? 0 : face_count;
+  sec[WF_CACHE_RUNS].count       = run_count;
+  sec[WF_CACHE_PACKED].count     = packed_size;
+
+  // Every section size but the strings is known, so lay them out first
+  uint64_t offset = WF_CACHE_ROUND(sizeof(wf_cache_header_t));
+  for (int i = 0; i < WF_CACHE_STRINGS; i++) {
+    sec[i].offset = offset;
+    offset = WF_CACHE_ROUND(offset + sec[i].count * WF_CACHE_ELEMENT_SIZE[i]);
+  }
+  sec[WF_CACHE_STRINGS].offset = offset;
+
+  wf_cache_strings_t strings   = { .base = offset };
+  wf_material_t*     materials = NULL;
+  wf_object_t*       objects   = NULL;
+  FILE*              file      = NULL;
+  char*              temp      = NULL;
+  wf_error_t         result    = WF_ERROR_OUT_OF_MEMORY;
+
+  materials = malloc((scene->material_count + 1) * sizeof(wf_material_t));
+  objects   = malloc((object_count + 1) * sizeof(wf_object_t));
+  temp      = malloc(strlen(filename) + 5);
+  if (!materials || !objects || !temp)
+    goto done;
+
+  header.source_path = wf_cache_add_string(&strings, source_path);
+  for (size_t i = 0; i < scene->material_count; i++)
+    wf_cache_store_material(&materials[i], &scene->materials[i], &strings);
+
+  // Packed objects keep the size of their encoding in face_cap
+  uint64_t faces = sec[WF_CACHE_FACES].offset;
+  uint64_t runs  = sec[WF_CACHE_RUNS].offset;
+  uint64_t pack  = sec[WF_CACHE_PACKED].offset;
+  size_t   n     = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next, n++) {
+    uint64_t     faces_at = obj->face_count ? faces : 0;
+    uint64_t     runs_at  = obj->material_run_count ? runs : 0;
+    wf_object_t* out      = &objects[n];
+    *out                  = *obj;
+    out->name             = WF_CACHE_STORE_STRING(&strings, obj->name);
+    out->faces            = WF_CACHE_STORE(wf_face*, faces_at);
+    out->material_runs    = WF_CACHE_STORE(wf_material_run_t*, runs_at);
+    out->face_cap         = obj->face_count;
+    out->material_run_cap = obj->material_run_count;
+    out->next             = NULL;
+    if (compress) {
+      out->faces    = WF_CACHE_STORE(wf_face*, pack);
+      out->face_cap = packed_sizes[n];
+      pack += packed_sizes[n];
+    } else {
+      faces += obj->face_count * sizeof(wf_face);
+    }
+    runs += obj->material_run_count * sizeof(wf_material_run_t);
+  }
+  if (strings.failed)
+    goto done;
+  sec[WF_CACHE_STRINGS].count = strings.size;
+  header.file_size            = offset + strings.size;
+
+  // Write next to the destination and rename, so readers never see a
+  // partial file
+  strcpy(temp, filename);
+  strcat(temp, ".tmp");
+  file = fopen(temp, "wb");
+  if (!file) {
+    LOG_ERROR("Cannot create %s", temp);
+    result = WF_ERROR_FILE_NOT_FOUND;
+    goto done;
+  }
+
+  result       = WF_ERROR_INTERNAL;
+  uint64_t pos = 0;
+  if (wf_cache_put(file, &pos, &header, sizeof(header)) != 0)
+    goto done;
+  const wf_vec3* aos[3] = { scene->vertices, scene->texcoords, scene->normals };
+  const wf_soa3_t* soa[3] = { &scene->soa.vertices, &scene->soa.texcoords,
+                              &scene->soa.normals };
+  for (int i = 0; i < 3; i++) {
+    if (wf_cache_pad(file, &pos, sec[i].offset) != 0
+        || wf_cache_put_vec3(file, &pos, aos[i], soa[i], sec[i].count) != 0)
+      goto done;
+  }
+  if (wf_cache_pad(file, &pos, sec[WF_CACHE_PARAMETERS].offset) != 0
+      || wf_cache_put(file, &pos, scene->parameters,
+                      scene->parameter_count * sizeof(wf_vec4)) != 0
+      || wf_cache_pad(file, &pos, sec[WF_CACHE_MATERIALS].offset) != 0
+      || wf_cache_put(file, &pos, materials,
+                      scene->material_count * sizeof(wf_material_t)) != 0
+      || wf_cache_pad(file, &pos, sec[WF_CACHE_OBJECTS].offset) != 0
+      || wf_cache_put(file, &pos, objects, object_count * sizeof(wf_object_t))
+             != 0
+      || wf_cache_pad(file, &pos, sec[WF_CACHE_FACES].offset) != 0)
+    goto done;
+  for (const wf_object_t* obj = scene->objects; obj && !compress;
+       obj = obj->next) {
+    if (wf_cache_put(file, &pos, obj->faces, obj->face_count * sizeof(wf_face))
+        != 0)
+      goto done;
+  }
+  if (wf_cache_pad(file, &pos, sec[WF_CACHE_RUNS].offset) != 0)
+    goto done;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    if (wf_cache_put(file, &pos, obj->material_runs,
+                     obj->material_run_count * sizeof(wf_material_run_t))
+        != 0)
+      goto done;
+  }
+  if (wf_cache_pad(file, &pos, sec[WF_CACHE_PACKED].offset) != 0
+      || wf_cache_put(file, &pos, packed, packed_size) != 0
+      || wf_cache_pad(file, &pos, sec[WF_CACHE_STRINGS].offset) != 0
+      || wf_cache_put(file, &pos, strings.data, strings.size) != 0)
+    goto done;
+
+  int closed = fclose(file);
+  file       = NULL;
+  if (closed != 0)
+    goto done;
+#ifdef _WIN32
+  remove(filename);
+#endif
+  if (rename(temp, filename) != 0)
+    goto done;
+  result = WF_SUCCESS;
+
+done:
+  if (file)
+    fclose(file);
+  if (result != WF_SUCCESS && temp)
+    remove(temp);
+  free(temp);
+  free(strings.data);
+  free(materials);
+  free(objects);
+  free(packed);
+  free(packed_sizes);
+  return result;
+}
+
+wf_error_t wf_save_scene_binary(const wf_scene_t* scene, const char* filename,
+                                const wf_binary_options_t* options) {
+  if (!scene || !filename) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  return wf_cache_write(scene, filename, NULL, NULL,
+                        options && options->compress_faces);
+}
+
+static void wf_cache_unmap(void* data, size_t size) {
+  wf_unmap_file(data, size);
+}
+
+static void wf_cache_free(void* data, size_t size) {
+  (void)size;
+  wf_aligned_free(data);
+}
+
+static wf_error_t wf_cache_fail(wf_scene_t* scene, wf_error_t error,
+                                const char* message) {
+  free(scene->error_message);
+  scene->error_message = wf_strdup(message);
+  return error;
+}
+
+// Turn a stored string offset into a pointer, NULL if it does not name a
+// NUL-terminated string inside the strings section
+static int wf_cache_string(char* base, const wf_cache_section_t* strings,
+                           char** str) {
+  uint64_t offset = (uint64_t)(uintptr_t)*str;
+  if (!offset)
+    return 0;
+  if (offset < strings->offset || offset >= strings->offset + strings->count)
+    return -1;
+  size_t left = strings->offset + strings->count - offset;
+  if (!memchr(base + offset, '\0', left))
+    return -1;
+  *str = base + offset;
+  return 0;
+}
+
+// Turn a stored array offset into a pointer to count elements of section
+static int wf_cache_array(char* base, const wf_cache_section_t* section,
+                          size_t element_size, size_t count, void** ptr) {
+  uint64_t offset = (uint64_t)(uintptr_t)*ptr;
+  if (!count) {
+    *ptr = NULL;
+    return 0;
+  }
+  uint64_t end = section->offset + section->count * element_size;
+  if (offset < section->offset || offset > end
+      || count > (end - offset) / element_size
+      || (offset - section->offset) % element_size != 0)
+    return -1;
+  *ptr = base + offset;
+  return 0;
+}
+
+static int wf_cache_fix_material(char* base, const wf_cache_section_t* str,
+                                 wf_material_t* m) {
+  return wf_cache_string(base, str, &m->name)
+       | wf_cache_string(base, str, &m->map_Ka)
+       | wf_cache_string(base, str, &m->map_Kd)
+       | wf_cache_string(base, str, &m->map_Ks)
+       | wf_cache_string(base, str, &m->map_Ns)
+       | wf_cache_string(base, str, &m->map_d)
+       | wf_cache_string(base, str, &m->map_Tr)
+       | wf_cache_string(base, str, &m->bump)
+       | wf_cache_string(base, str, &m->disp)
+       | wf_cache_string(base, str, &m->decal)
+       | wf_cache_string(base, str, &m->map_options.type);
+}
+
+// Packed objects are left pointing at their encoding, face_cap bytes long
+static int wf_cache_fix_object(char* base, const wf_cache_section_t* sec,
+                               int packed, wf_object_t* obj) {
+  void* faces = obj->faces;
+  void* runs  = obj->material_runs;
+  int   id    = packed ? WF_CACHE_PACKED : WF_CACHE_FACES;
+  if (wf_cache_string(base, &sec[WF_CACHE_STRINGS], &obj->name) != 0
+      || wf_cache_array(base, &sec[id], WF_CACHE_ELEMENT_SIZE[id],
+                        packed ? obj->face_cap : obj->face_count, &faces)
+             != 0
+      || wf_cache_array(base, &sec[WF_CACHE_RUNS], sizeof(wf_material_run_t),
+                        obj->material_run_count, &runs) != 0)
+    return -1;
+  obj->faces         = faces;
+  obj->material_runs = runs;
+  for (size_t r = 0; r < obj->material_run_count; r++) {
+    const wf_material_run_t* run = &obj->material_runs[r];
+    if (run->start > obj->face_count
+        || run->count > obj->face_count - run->start)
+      return -1;
+  }
+  return 0;
+}
+
+// Check the header against this build and the file, and optionally against
+// the source key
+static const char* wf_cache_check(const wf_cache_header_t* header,
+                                  size_t size, const wf_cache_key_t* key) {
+  wf_cache_header_t expected;
+  wf_cache_header_init(&expected);
+  if (memcmp(header->magic, WF_CACHE_MAGIC, sizeof(WF_CACHE_MAGIC)) != 0)
+    return "Not a binary scene file";
+  if (header->version != WF_CACHE_VERSION)
+    return "Unsupported binary scene version";
+  if (header->flags & ~WF_CACHE_PACKED_FACES)
+    return "Unsupported binary scene version";
+  if (header->byte_order != WF_CACHE_BYTE_ORDER
+      || header->pointer_size != expected.pointer_size
+      || header->face_size != expected.face_size
+      || header->object_size != expected.object_size
+      || header->material_size != expected.material_size
+      || header->run_size != expected.run_size)
+    return "Binary scene was written by an incompatible build";
+  if (header->file_size != size)
+    return "Truncated binary scene";
+  for (int i = 0; i < WF_CACHE_SECTION_COUNT; i++) {
+    const wf_cache_section_t* s = &header->sections[i];
+    if (s->offset % WF_CACHE_ALIGN != 0 || s->offset > size
+        || s->count > (size - s->offset) / WF_CACHE_ELEMENT_SIZE[i])
+      return "Corrupt binary scene section table";
+  }
+  if (key && memcmp(&header->key, key, sizeof(wf_cache_key_t)) != 0)
+    return "Binary scene cache is stale";
+  return NULL;
+}
+
+// Validate a file read to base and fix its pointers up in place. Returns
+// NULL on success, otherwise why the file cannot be used.
+static const char* wf_cache_fixup(char* base, size_t size,
+                                  const wf_cache_key_t* key,
+                                  const char*           source_path) {
+  if (size < sizeof(wf_cache_header_t))
+    return "Not a binary scene file";
+  wf_cache_header_t*  header = (wf_cache_header_t*)base;
+  wf_cache_section_t* sec    = header->sections;
+  const char*         error  = wf_cache_check(header, size, key);
+  if (error)
+    return error;
+
+  if (source_path) {
+    char* stored = WF_CACHE_STORE(char*, header->source_path);
+    if (wf_cache_string(base, &sec[WF_CACHE_STRINGS], &stored) != 0 || !stored
+        || strcmp(stored, source_path) != 0)
+      return "Binary scene cache belongs to another file";
+  }
+
+  wf_material_t* materials =
+      (wf_material_t*)(base + sec[WF_CACHE_MATERIALS].offset);
+  for (size_t i = 0; i < sec[WF_CACHE_MATERIALS].count; i++) {
+    if (wf_cache_fix_material(base, &sec[WF_CACHE_STRINGS], &materials[i])
+        != 0)
+      return "Corrupt material in binary scene";
+  }
+
+  wf_object_t* objects = (wf_object_t*)(base + sec[WF_CACHE_OBJECTS].offset);
+  size_t       count   = sec[WF_CACHE_OBJECTS].count;
+  for (size_t i = 0; i < count; i++) {
+    if (wf_cache_fix_object(base, sec,
+                            header->flags & WF_CACHE_PACKED_FACES, &objects[i])
+        != 0)
+      return "Corrupt object in binary scene";
+    objects[i].next = i + 1 < count ? &objects[i + 1] : NULL;
+  }
+  return NULL;
+}
+
+static const unsigned char* wf_cache_unpack_smoothing(
+    wf_face* faces, size_t count, const unsigned char* p,
+    const unsigned char* end) {
+  uint64_t runs, length, value;
+  size_t   f = 0;
+  if (!(p = wf_get_varint(p, end, &runs)))
+    return NULL;
+  for (uint64_t r = 0; r < runs; r++) {
+    if (!(p = wf_get_varint(p, end, &length))
+        || !(p = wf_get_varint(p, end, &value)) || length > count - f)
+      return NULL;
+    for (size_t i = 0; i < length; i++, f++)
+      faces[f].smoothing_group = (unsigned)value;
+  }
+  return f == count ? p : NULL;
+}
+
+static int wf_cache_unpack_object(const wf_object_t* obj, wf_face* faces,
+                                  const unsigned char* p,
+                                  const unsigned char* end,
+                                  uint32_t*            scratch) {
+  size_t count = obj->face_count;
+  for (int stream = 0; stream < 3; stream++) {
+    int mode = 2;
+    if (stream > 0) {
+      if (p >= end || *p > 2)
+        return -1;
+      mode = *p++;
+    }
+    if (mode == 2 && !(p = wf_index_decode(scratch, 3 * count, p, end)))
+      return -1;
+    for (size_t f = 0; f < count; f++) {
+      for (int k = 0; k < 3; k++) {
+        wf_vertex_index* vi  = &faces[f].vertices[k];
+        int              idx = (int)scratch[3 * f + k];
+        if (mode < 2)
+          idx = mode == 0 ? -1 : vi->v_idx;
+        if (stream == 0)
+          vi->v_idx = idx;
+        else if (stream == 1)
+          vi->vt_idx = idx;
+        else
+          vi->vn_idx = idx;
+      }
+    }
+  }
+  if (!(p = wf_cache_unpack_smoothing(faces, count, p, end)) || p != end)
+    return -1;
+
+  wf_material_run_t        whole;
+  size_t                   run_count;
+  const wf_material_run_t* runs = wf_object_runs(obj, &whole, &run_count);
+  for (size_t r = 0; r < run_count; r++) {
+    for (size_t i = 0; i < runs[r].count; i++)
+      faces[runs[r].start + i].material_idx = runs[r].material_idx;
+  }
+  return 0;
+}
+
+// Decode the faces of packed objects into the arena
+static int wf_cache_unpack_faces(wf_arena_t* arena, wf_object_t* objects) {
+  size_t max_faces = 0;
+  for (const wf_object_t* obj = objects; obj; obj = obj->next) {
+    if (obj->face_count > max_faces)
+      max_faces = obj->face_count;
+  }
+  uint32_t* scratch = malloc((3 * max_faces + 1) * sizeof(uint32_t));
+  if (!scratch)
+    return -1;
+
+  int result = 0;
+  for (wf_object_t* obj = objects; obj && result == 0; obj = obj->next) {
+    const unsigned char* data  = (const unsigned char*)obj->faces;
+    size_t               size  = obj->face_cap;
+    wf_face*             faces = NULL;
+    if (obj->face_count) {
+      faces = wf_arena_calloc(arena, obj->face_count, sizeof(wf_face));
+      if (!faces) {
+        result = -1;
+        break;
+      }
+    }
+    result        = wf_cache_unpack_object(obj, faces, data, data + size,
+                                           scratch);
+    obj->faces    = faces;
+    obj->face_cap = obj->face_count;
+  }
+  free(scratch);
+  return result;
+}
+
+// Map the file copy-on-write so pointers can be fixed up in place, or read
+// it into a buffer aligned like the sections
+static char* wf_cache_read(const char* filename, int use_mmap, size_t* size,
+                           void (**release)(void*, size_t)) {
+  FILE* file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+
+  char* base = NULL;
+  if (use_mmap && wf_map_file_private(file, &base, size) == 0) {
+    *release = wf_cache_unmap;
+  } else if (fseek(file, 0, SEEK_END) == 0) {
+    long end = ftell(file);
+    *size    = end > 0 ? (size_t)end : 0;
+    *release = wf_cache_free;
+    base     = wf_aligned_alloc(WF_CACHE_ALIGN, *size);
+    rewind(file);
+    if (base && fread(base, 1, *size, file) != *size) {
+      wf_aligned_free(base);
+      base = NULL;
+    }
+  }
+  fclose(file);
+  return base;
+}
+
+static wf_error_t wf_cache_load(const char*                filename,
+                                const wf_binary_options_t* options,
+                                const wf_cache_key_t*      key,
+                                const char* source_path, wf_scene_t* scene) {
+  memset(scene, 0, sizeof(wf_scene_t));
+  if (!wf_cache_little_endian())
+    return wf_cache_fail(scene, WF_ERROR_UNSUPPORTED_FEATURE,
+                         "Binary scenes need a little-endian host");
+
+  size_t size = 0;
+  void (*release)(void*, size_t) = NULL;
+  char* base = wf_cache_read(filename, options->use_mmap, &size, &release);
+  if (!base)
+    return wf_cache_fail(scene, WF_ERROR_FILE_NOT_FOUND,
+                         "Cannot read binary scene");
+
+  const char* error = wf_cache_fixup(base, size, key, source_path);
+  if (error) {
+    release(base, size);
+    return wf_cache_fail(scene, WF_ERROR_INVALID_FORMAT, error);
+  }
+
+  // The arena owns the buffer, so the scene can be modified and freed like
+  // any arena scene
+  scene->arena = wf_arena_create(0);
+  if (!scene->arena
+      || wf_arena_attach(scene->arena, base, size, release) != 0) {
+    wf_arena_destroy(scene->arena);
+    scene->arena = NULL;
+    release(base, size);
+    return wf_cache_fail(scene, WF_ERROR_OUT_OF_MEMORY,
+                         "Out of memory while loading binary scene");
+  }
+
+  const wf_cache_header_t*  header = (const wf_cache_header_t*)base;
+  const wf_cache_section_t* sec    = header->sections;
+#define WF_CACHE_SECTION(id, type)                                             \
+  (sec[id].count ? (type*)(base + sec[id].offset) : NULL)
+  scene->vertices        = WF_CACHE_SECTION(WF_CACHE_VERTICES, wf_vec3);
+  scene->texcoords       = WF_CACHE_SECTION(WF_CACHE_TEXCOORDS, wf_vec3);
+  scene->normals         = WF_CACHE_SECTION(WF_CACHE_NORMALS, wf_vec3);
+  scene->parameters      = WF_CACHE_SECTION(WF_CACHE_PARAMETERS, wf_vec4);
+  scene->materials       = WF_CACHE_SECTION(WF_CACHE_MATERIALS, wf_material_t);
+  scene->objects         = WF_CACHE_SECTION(WF_CACHE_OBJECTS, wf_object_t);
+#undef WF_CACHE_SECTION
+  scene->vertex_count    = sec[WF_CACHE_VERTICES].count;
+  scene->texcoord_count  = sec[WF_CACHE_TEXCOORDS].count;
+  scene->normal_count    = sec[WF_CACHE_NORMALS].count;
+  scene->parameter_count = sec[WF_CACHE_PARAMETERS].count;
+  scene->material_count  = sec[WF_CACHE_MATERIALS].count;
+  scene->vertex_cap      = scene->vertex_count;
+  scene->texcoord_cap    = scene->texcoord_count;
+  scene->normal_cap      = scene->normal_count;
+  scene->parameter_cap   = scene->parameter_count;
+  scene->material_cap    = scene->material_count;
+  if ((header->flags & WF_CACHE_PACKED_FACES)
+      && wf_cache_unpack_faces(scene->arena, scene->objects) != 0) {
+    wf_arena_destroy(scene->arena);
+    memset(scene, 0, sizeof(wf_scene_t));
+    return wf_cache_fail(scene, WF_ERROR_INVALID_FORMAT,
+                         "Corrupt packed faces in binary scene");
+  }
+  if (wf_scene_index_objects(scene) != WF_SUCCESS
+      || wf_scene_index_materials(scene) != WF_SUCCESS)
+    return wf_cache_fail(scene, WF_ERROR_OUT_OF_MEMORY,
+                         "Out of memory while indexing objects");
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_load_scene_binary(const char* filename, wf_scene_t* scene,
+                                const wf_binary_options_t* options) {
+  if (!filename || !scene) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  return wf_cache_load(filename, options ? options : &DEFAULT_BINARY_OPTIONS,
+                       NULL, NULL, scene);
+}
+
+// Key of the OBJ file as it is now
+static wf_error_t wf_cache_source_key(const char*               filename,
+                                      const wf_parse_options_t* options,
+                                      wf_cache_key_t*           key) {
+  struct stat st;
+  if (stat(filename, &st) != 0)
+    return WF_ERROR_FILE_NOT_FOUND;
+
+  wf_io_buffer_t buffer;
+  wf_error_t     result = wf_io_load(NULL, filename, &buffer);
+  if (result != WF_SUCCESS)
+    return result;
+
+  memset(key, 0, sizeof(wf_cache_key_t));
+  key->size        = (uint64_t)st.st_size;
+  key->mtime       = (int64_t)st.st_mtime;
+  key->hash        = wf_hash_bytes(buffer.data, buffer.size);
+  key->parse_flags = (options->triangulate ? 1u : 0u)
+                   | (options->merge_objects ? 2u : 0u)
+                   | (options->preserve_indices ? 4u : 0u);
+  wf_io_release(&buffer);
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_load_obj_cached(const char* filename, const char* cache_filename,
+                              wf_scene_t*               scene,
+                              const wf_parse_options_t* options) {
+  if (!filename || !scene) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+
+  wf_parse_options_t opts;
+  wf_parse_options_init(&opts);
+  if (options)
+    opts = *options;
+
+  // Providers and streaming sources have no mtime to key the cache on
+  wf_cache_key_t key;
+  if (opts.io || wf_cache_source_key(filename, &opts, &key) != WF_SUCCESS)
+    return wf_load_obj(filename, scene, options);
+
+  char* default_path = NULL;
+  if (!cache_filename) {
+    default_path = malloc(strlen(filename) + sizeof(".wfcache"));
+    if (!default_path)
+      return WF_ERROR_OUT_OF_MEMORY;
+    strcpy(default_path, filename);
+    strcat(default_path, ".wfcache");
+    cache_filename = default_path;
+  }
+
+  wf_binary_options_t binary = DEFAULT_BINARY_OPTIONS;
+  binary.use_mmap            = opts.use_mmap;
+  wf_error_t result =
+      wf_cache_load(cache_filename, &binary, &key, filename, scene);
+  if (result == WF_SUCCESS) {
+    LOG_DEBUG("Loaded %s from cache %s", filename, cache_filename);
+    if (opts.compute_bounds) {
+      scene->bounds     = wf_bounds_vertices(scene, 0, scene->vertex_count);
+      scene->has_bounds = 1;
+    }
+    if (opts.soa_alignment)
+      result = wf_scene_convert_to_soa(scene, opts.soa_alignment);
+  } else {
+    LOG_DEBUG("Cache %s not used (%s), parsing %s", cache_filename,
+              wf_get_error(scene), filename);
+    wf_free_scene(scene);
+    result = wf_load_obj(filename, scene, options);
+    if (result == WF_SUCCESS
+        && wf_cache_write(scene, cache_filename, &key, filename,
+                          opts.compress_cache)
+               != WF_SUCCESS)
+      LOG_WARN("Cannot write scene cache %s", cache_filename);
+  }
+
+  free(default_path);
+  return result;
+}
@@ -0,0 +1,89 @@
+// src/file_io.c
+#include "file_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+
+#define WF_IO_READ_CHUNK 65536
+
+// Read everything handle has left into a heap buffer
+static wf_error_t wf_io_read_all(size_t (*read)(void*, void*, char*, size_t),
+                                 void* user, void* handle, size_t hint,
+                                 wf_io_buffer_t* buffer) {
+  size_t cap  = hint ? hint + 1 : WF_IO_READ_CHUNK;
+  size_t size = 0;
+  char*  data = malloc(cap);
+  if (!data)
+    return WF_ERROR_OUT_OF_MEMORY;
+
+  for (;;) {
+    if (size == cap) {
+      char* grown = realloc(data, cap * 2);
+      if (!grown) {
+        free(data);
+        return WF_ERROR_OUT_OF_MEMORY;
+      }
+      data = grown;
+      cap *= 2;
+    }
+    size_t n = read(user, handle, data + size, cap - size);
+    if (n == 0)
+      break;
+    size += n;
+  }
+
+  buffer->data  = data;
+  buffer->size  = size;
+  buffer->owned = data;
+  return WF_SUCCESS;
+}
+
+static size_t wf_io_fread(void* user, void* handle, char* data, size_t size) {
+  (void)user;
+  return fread(data, 1, size, (FILE*)handle);
+}
+
+static wf_error_t wf_io_load_file(const char* path, wf_io_buffer_t* buffer) {
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return WF_ERROR_FILE_NOT_FOUND;
+
+  wf_error_t result = WF_SUCCESS;
+  if (wf_map_file(file, &buffer->data, &buffer->size) == 0)
+    buffer->mapped = 1;
+  else
+    result = wf_io_read_all(wf_io_fread, NULL, file, 0, buffer);
+  fclose(file);
+  return result;
+}
+
+wf_error_t wf_io_load(const wf_io_t* io, const char* path,
+                      wf_io_buffer_t* buffer) {
+  memset(buffer, 0, sizeof(wf_io_buffer_t));
+  if (!io)
+    return wf_io_load_file(path, buffer);
+
+  if (io->lookup
+      && io->lookup(io->user, path, &buffer->data, &buffer->size) == 0) {
+    return WF_SUCCESS;
+  }
+  if (!io->open || !io->read)
+    return WF_ERROR_FILE_NOT_FOUND;
+
+  void* handle = io->open(io->user, path);
+  if (!handle)
+    return WF_ERROR_FILE_NOT_FOUND;
+  size_t     hint   = io->size ? io->size(io->user, handle) : 0;
+  wf_error_t result = wf_io_read_all(io->read, io->user, handle, hint, buffer);
+  if (io->close)
+    io->close(io->user, handle);
+  return result;
+}
+
+void wf_io_release(wf_io_buffer_t* buffer) {
+  if (buffer->mapped)
+    wf_unmap_file(buffer->data, buffer->size);
+  free(buffer->owned);
+  memset(buffer, 0, sizeof(wf_io_buffer_t));
+}
@@ -0,0 +1,30 @@
+// src/file_io.h
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stddef.h>
+#include "wavefront.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Whole contents of a file, borrowed from a provider, mapped or read
+typedef struct {
+  const char* data;
+  size_t      size;
+  char*       owned;  /**< Heap copy to free, NULL when borrowed or mapped */
+  int         mapped; /**< data is a mapping of a file system file */
+} wf_io_buffer_t;
+
+// Load path through io, or from the file system when io is NULL. Returns
+// WF_ERROR_FILE_NOT_FOUND when the file does not exist.
+wf_error_t wf_io_load(const wf_io_t* io, const char* path,
+                      wf_io_buffer_t* buffer);
+void       wf_io_release(wf_io_buffer_t* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILE_IO_H
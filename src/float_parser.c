@@ -0,0 +1,611 @@
+// src/float_parser.c
+#include "float_parser.h"
+#include <ctype.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// binary32 layout
+#define WF_FLT_MANTISSA_BITS 23
+#define WF_FLT_MIN_EXPONENT  (-127)
+#define WF_FLT_INF_POWER     0xFF
+
+// Decimal exponents outside this range always round to zero or infinity
+#define WF_FLT_SMALLEST_POW10 (-64)
+#define WF_FLT_LARGEST_POW10  38
+
+// Round-to-even can only be ambiguous for these exponents
+#define WF_FLT_MIN_ROUND_TO_EVEN (-17)
+#define WF_FLT_MAX_ROUND_TO_EVEN 10
+
+#define WF_MAX_FAST_DIGITS 19
+
+// 128-bit truncated approximations of 5^q for q in [-64, 38], high word first
+static const uint64_t WF_POW5_128[] = {
+  0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+  0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+  0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+  0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+  0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+  0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+  0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+  0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+  0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+  0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+  0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+  0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+  0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+  0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+  0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+  0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+  0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+  0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+  0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+  0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+  0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+  0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+  0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+  0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+  0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+  0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+  0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+  0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+  0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+  0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+  0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+  0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+  0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+  0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+  0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+  0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+  0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+  0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+  0xc612062576589ddaULL, 0x95364afe032a819eULL,
+  0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+  0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+  0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+  0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+  0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+  0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+  0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+  0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+  0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+  0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+  0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+  0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+  0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+  0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+  0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+  0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+  0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+  0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+  0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+  0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+  0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+  0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+  0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+  0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+  0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+  0x8000000000000000ULL, 0x0000000000000000ULL,
+  0xa000000000000000ULL, 0x0000000000000000ULL,
+  0xc800000000000000ULL, 0x0000000000000000ULL,
+  0xfa00000000000000ULL, 0x0000000000000000ULL,
+  0x9c40000000000000ULL, 0x0000000000000000ULL,
+  0xc350000000000000ULL, 0x0000000000000000ULL,
+  0xf424000000000000ULL, 0x0000000000000000ULL,
+  0x9896800000000000ULL, 0x0000000000000000ULL,
+  0xbebc200000000000ULL, 0x0000000000000000ULL,
+  0xee6b280000000000ULL, 0x0000000000000000ULL,
+  0x9502f90000000000ULL, 0x0000000000000000ULL,
+  0xba43b74000000000ULL, 0x0000000000000000ULL,
+  0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+  0x9184e72a00000000ULL, 0x0000000000000000ULL,
+  0xb5e620f480000000ULL, 0x0000000000000000ULL,
+  0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+  0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+  0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+  0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+  0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+  0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+  0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+  0x878678326eac9000ULL, 0x0000000000000000ULL,
+  0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+  0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+  0x84595161401484a0ULL, 0x0000000000000000ULL,
+  0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+  0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+  0x813f3978f8940984ULL, 0x4000000000000000ULL,
+  0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+  0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+  0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+  0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+  0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+  0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+  0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+  0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+  0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+  0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+};
+
+// Exactly representable powers of ten for the Clinger fast path
+static const float WF_POW10_FLOAT[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                        1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+typedef struct {
+  uint64_t high;
+  uint64_t low;
+} wf_u128_t;
+
+static wf_u128_t wf_mul_64x64(uint64_t a, uint64_t b) {
+  wf_u128_t r;
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 p = (unsigned __int128)a * b;
+  r.high              = (uint64_t)(p >> 64);
+  r.low               = (uint64_t)p;
+#else
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi;
+  uint64_t hl = a_hi * b_lo, hh = a_hi * b_hi;
+  uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+  r.low        = (mid << 32) | (uint32_t)ll;
+  r.high       = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+  return r;
+}
+
+static int wf_leading_zeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  while (!(x & 0x8000000000000000ULL)) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// Eisel-Lemire: biased binary exponent and mantissa of the float nearest to
+// w * 10^q, for w < 10^19 + 1.
+static void wf_eisel_lemire(int64_t q, uint64_t w, int32_t* power2,
+                            uint64_t* mantissa) {
+  if (w == 0 || q < WF_FLT_SMALLEST_POW10) {
+    *power2   = 0;
+    *mantissa = 0;
+    return;
+  }
+  if (q > WF_FLT_LARGEST_POW10) {
+    *power2   = WF_FLT_INF_POWER;
+    *mantissa = 0;
+    return;
+  }
+
+  int lz = wf_leading_zeros(w);
+  w <<= lz;
+
+  // Product with the truncated 5^q, refined with the low word only when the
+  // bits below the ones we keep are all set
+  size_t         index   = 2 * (size_t)(q - WF_FLT_SMALLEST_POW10);
+  const uint64_t mask    = 0xFFFFFFFFFFFFFFFFULL >> (WF_FLT_MANTISSA_BITS + 3);
+  wf_u128_t      product = wf_mul_64x64(w, WF_POW5_128[index]);
+  if ((product.high & mask) == mask) {
+    wf_u128_t second = wf_mul_64x64(w, WF_POW5_128[index + 1]);
+    product.low += second.high;
+    if (second.high > product.low)
+      product.high++;
+  }
+
+  int      upperbit = (int)(product.high >> 63);
+  int      shift    = upperbit + 64 - WF_FLT_MANTISSA_BITS - 3;
+  uint64_t m        = product.high >> shift;
+  // floor(log2(10^q)) + 63
+  int32_t p2 = (int32_t)(((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz
+                         - WF_FLT_MIN_EXPONENT);
+
+  if (p2 <= 0) {
+    // Subnormal
+    if (-p2 + 1 >= 64) {
+      *power2   = 0;
+      *mantissa = 0;
+      return;
+    }
+    m >>= -p2 + 1;
+    m += (m & 1);
+    m >>= 1;
+    *power2   = (m < (1ULL << WF_FLT_MANTISSA_BITS)) ? 0 : 1;
+    *mantissa = m;
+    return;
+  }
+
+  // Exactly halfway between two floats: round to even
+  if (product.low <= 1 && q >= WF_FLT_MIN_ROUND_TO_EVEN
+      && q <= WF_FLT_MAX_ROUND_TO_EVEN && (m & 3) == 1) {
+    if ((m << shift) == product.high)
+      m &= ~1ULL;
+  }
+
+  m += (m & 1);
+  m >>= 1;
+  if (m >= (2ULL << WF_FLT_MANTISSA_BITS)) {
+    m = 1ULL << WF_FLT_MANTISSA_BITS;
+    p2++;
+  }
+  m &= ~(1ULL << WF_FLT_MANTISSA_BITS);
+  if (p2 >= WF_FLT_INF_POWER) {
+    p2 = WF_FLT_INF_POWER;
+    m  = 0;
+  }
+  *power2   = p2;
+  *mantissa = m;
+}
+
+static float wf_float_from_bits(int negative, int32_t power2,
+                                uint64_t mantissa) {
+  uint32_t bits = (uint32_t)mantissa
+                | ((uint32_t)power2 << WF_FLT_MANTISSA_BITS);
+  if (negative)
+    bits |= 0x80000000u;
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+/*
+ * Slow path: exact conversion through a big decimal that is shifted by
+ * powers of two until the mantissa bits can be read off. Only used when more
+ * than 19 significant digits leave the fast path undecided.
+ */
+#define WF_DECIMAL_DIGITS 800
+#define WF_DECIMAL_SHIFT  60
+
+typedef struct {
+  unsigned char d[WF_DECIMAL_DIGITS];
+  int           nd;    /**< Number of digits used */
+  int           dp;    /**< Decimal point position */
+  int           trunc; /**< Non-zero digits were discarded */
+} wf_decimal_t;
+
+static void wf_decimal_trim(wf_decimal_t* a) {
+  while (a->nd > 0 && a->d[a->nd - 1] == 0)
+    a->nd--;
+  if (a->nd == 0)
+    a->dp = 0;
+}
+
+static void wf_decimal_right_shift(wf_decimal_t* a, unsigned k) {
+  int      r = 0, w = 0;
+  uint64_t n = 0;
+
+  for (; (n >> k) == 0; r++) {
+    if (r >= a->nd) {
+      if (n == 0) {
+        a->nd = 0;
+        return;
+      }
+      while ((n >> k) == 0) {
+        n *= 10;
+        r++;
+      }
+      break;
+    }
+    n = n * 10 + a->d[r];
+  }
+  a->dp -= r - 1;
+
+  uint64_t mask = (1ULL << k) - 1;
+  for (; r < a->nd; r++) {
+    uint64_t c = a->d[r];
+    a->d[w++]  = (unsigned char)(n >> k);
+    n          = ((n & mask) * 10) + c;
+  }
+  while (n > 0) {
+    uint64_t dig = n >> k;
+    n &= mask;
+    if (w < WF_DECIMAL_DIGITS)
+      a->d[w++] = (unsigned char)dig;
+    else if (dig > 0)
+      a->trunc = 1;
+    n *= 10;
+  }
+  a->nd = w;
+  wf_decimal_trim(a);
+}
+
+static void wf_decimal_left_shift(wf_decimal_t* a, unsigned k) {
+  // A shift by k adds at most k / 3 + 1 digits; write right-aligned into a
+  // scratch buffer, then move the result back
+  unsigned char tmp[WF_DECIMAL_DIGITS + WF_DECIMAL_SHIFT];
+  int           w = a->nd + (int)(k / 3) + 1;
+  int           top;
+  uint64_t      n = 0;
+
+  top = w;
+  for (int r = a->nd - 1; r >= 0; r--) {
+    n += (uint64_t)a->d[r] << k;
+    uint64_t quo = n / 10;
+    tmp[--w]     = (unsigned char)(n - 10 * quo);
+    n            = quo;
+  }
+  while (n > 0) {
+    uint64_t quo = n / 10;
+    tmp[--w]     = (unsigned char)(n - 10 * quo);
+    n            = quo;
+  }
+
+  int nd = top - w;
+  a->dp += nd - a->nd;
+  if (nd > WF_DECIMAL_DIGITS) {
+    for (int i = WF_DECIMAL_DIGITS; i < nd; i++) {
+      if (tmp[w + i])
+        a->trunc = 1;
+    }
+    nd = WF_DECIMAL_DIGITS;
+  }
+  memcpy(a->d, tmp + w, (size_t)nd);
+  a->nd = nd;
+  wf_decimal_trim(a);
+}
+
+static void wf_decimal_shift(wf_decimal_t* a, int k) {
+  if (a->nd == 0)
+    return;
+  if (k > 0) {
+    for (; k > WF_DECIMAL_SHIFT; k -= WF_DECIMAL_SHIFT)
+      wf_decimal_left_shift(a, WF_DECIMAL_SHIFT);
+    wf_decimal_left_shift(a, (unsigned)k);
+  } else if (k < 0) {
+    for (; k < -WF_DECIMAL_SHIFT; k += WF_DECIMAL_SHIFT)
+      wf_decimal_right_shift(a, WF_DECIMAL_SHIFT);
+    wf_decimal_right_shift(a, (unsigned)-k);
+  }
+}
+
+static int wf_decimal_round_up(const wf_decimal_t* a, int nd) {
+  if (nd < 0 || nd >= a->nd)
+    return 0;
+  if (a->d[nd] == 5 && nd + 1 == a->nd) {
+    // Exactly halfway, unless digits were dropped
+    if (a->trunc)
+      return 1;
+    return nd > 0 && (a->d[nd - 1] % 2) != 0;
+  }
+  return a->d[nd] >= 5;
+}
+
+static uint64_t wf_decimal_rounded_integer(const wf_decimal_t* a) {
+  if (a->dp > 20)
+    return 0xFFFFFFFFFFFFFFFFULL;
+  uint64_t n = 0;
+  int      i = 0;
+  for (; i < a->dp && i < a->nd; i++)
+    n = n * 10 + a->d[i];
+  for (; i < a->dp; i++)
+    n *= 10;
+  if (wf_decimal_round_up(a, a->dp))
+    n++;
+  return n;
+}
+
+static float wf_decimal_to_float(wf_decimal_t* d, int negative) {
+  // Powers of two that move the decimal point by 0..8 digits
+  static const int powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+  const int        n_pow    = (int)(sizeof(powtab) / sizeof(powtab[0]));
+  int              exp      = 0;
+  uint64_t         mant;
+
+  if (d->nd == 0)
+    return wf_float_from_bits(negative, 0, 0);
+  if (d->dp > 40)
+    return wf_float_from_bits(negative, WF_FLT_INF_POWER, 0);
+  if (d->dp < -50)
+    return wf_float_from_bits(negative, 0, 0);
+
+  // Scale into [0.5, 1)
+  while (d->dp > 0) {
+    int n = d->dp >= n_pow ? 27 : powtab[d->dp];
+    wf_decimal_shift(d, -n);
+    exp += n;
+  }
+  while (d->dp < 0 || (d->dp == 0 && d->d[0] < 5)) {
+    int n = -d->dp >= n_pow ? 27 : powtab[-d->dp];
+    wf_decimal_shift(d, n);
+    exp -= n;
+  }
+  exp--; // [1, 2)
+
+  if (exp < WF_FLT_MIN_EXPONENT + 1) {
+    int n = WF_FLT_MIN_EXPONENT + 1 - exp;
+    wf_decimal_shift(d, -n);
+    exp += n;
+  }
+  if (exp - WF_FLT_MIN_EXPONENT >= WF_FLT_INF_POWER)
+    return wf_float_from_bits(negative, WF_FLT_INF_POWER, 0);
+
+  wf_decimal_shift(d, 1 + WF_FLT_MANTISSA_BITS);
+  mant = wf_decimal_rounded_integer(d);
+  if (mant == (2ULL << WF_FLT_MANTISSA_BITS)) {
+    mant >>= 1;
+    exp++;
+    if (exp - WF_FLT_MIN_EXPONENT >= WF_FLT_INF_POWER)
+      return wf_float_from_bits(negative, WF_FLT_INF_POWER, 0);
+  }
+  if (!(mant & (1ULL << WF_FLT_MANTISSA_BITS)))
+    exp = WF_FLT_MIN_EXPONENT; // subnormal
+
+  return wf_float_from_bits(negative, exp - WF_FLT_MIN_EXPONENT,
+                            mant & ((1ULL << WF_FLT_MANTISSA_BITS) - 1));
+}
+
+// Fill a big decimal from digits already validated by wf_strtof
+static void wf_decimal_set(wf_decimal_t* d, const char* p, int64_t exp10) {
+  int64_t dp      = 0;
+  int     saw_dot = 0;
+
+  d->nd    = 0;
+  d->trunc = 0;
+  for (;; p++) {
+    if (*p == '.' && !saw_dot) {
+      saw_dot = 1;
+    } else if (*p >= '0' && *p <= '9') {
+      if (*p == '0' && d->nd == 0) {
+        if (saw_dot)
+          dp--; // leading fractional zero
+        continue;
+      }
+      if (d->nd < WF_DECIMAL_DIGITS)
+        d->d[d->nd++] = (unsigned char)(*p - '0');
+      else if (*p != '0')
+        d->trunc = 1;
+      if (!saw_dot)
+        dp++;
+    } else {
+      break;
+    }
+  }
+  dp += exp10;
+  if (dp > 100000)
+    dp = 100000;
+  else if (dp < -100000)
+    dp = -100000;
+  d->dp = (int)dp;
+}
+
+static int wf_match_ci(const char* s, const char* word) {
+  for (; *word; s++, word++) {
+    if ((*s | 0x20) != *word)
+      return 0;
+  }
+  return 1;
+}
+
+static float wf_parse_inf_nan(const char* p, int negative, const char** end,
+                              const char* start) {
+  if (wf_match_ci(p, "inf")) {
+    p += wf_match_ci(p, "infinity") ? 8 : 3;
+    *end = p;
+    return negative ? -INFINITY : INFINITY;
+  }
+  if (wf_match_ci(p, "nan")) {
+    p += 3;
+    if (*p == '(') {
+      const char* q = p + 1;
+      while (isalnum((unsigned char)*q) || *q == '_')
+        q++;
+      if (*q == ')')
+        p = q + 1;
+    }
+    *end = p;
+    return negative ? -NAN : NAN;
+  }
+  *end = start;
+  return 0.0f;
+}
+
+float wf_strtof(const char* s, const char** end) {
+  const char* p        = s;
+  int         negative = 0;
+
+  if (*p == '-' || *p == '+') {
+    negative = (*p == '-');
+    p++;
+  }
+
+  const char* digits      = p;
+  uint64_t    w           = 0;
+  int64_t     exp10       = 0;
+  int         n_digits    = 0; // significant digits kept in w
+  int         saw_digit   = 0;
+  int         truncated   = 0;
+  int64_t     written_exp = 0; // exponent as written, for the slow path
+
+  for (; *p >= '0' && *p <= '9'; p++) {
+    unsigned dig = (unsigned)(*p - '0');
+    saw_digit    = 1;
+    if (w == 0 && dig == 0)
+      continue;
+    if (n_digits < WF_MAX_FAST_DIGITS) {
+      w = w * 10 + dig;
+      n_digits++;
+    } else {
+      exp10++;
+      truncated |= (dig != 0);
+    }
+  }
+  if (*p == '.') {
+    const char* frac = ++p;
+    for (; *p >= '0' && *p <= '9'; p++) {
+      unsigned dig = (unsigned)(*p - '0');
+      if (w == 0 && dig == 0) {
+        exp10--;
+        continue;
+      }
+      if (n_digits < WF_MAX_FAST_DIGITS) {
+        w = w * 10 + dig;
+        n_digits++;
+        exp10--;
+      } else {
+        truncated |= (dig != 0);
+      }
+    }
+    saw_digit |= (p > frac);
+  }
+
+  if (!saw_digit) {
+    if (p == digits)
+      return wf_parse_inf_nan(p, negative, end, s);
+    *end = s;
+    return 0.0f;
+  }
+
+  if (*p == 'e' || *p == 'E') {
+    const char* e       = p + 1;
+    int         e_neg   = 0;
+    int64_t     e_value = 0;
+    if (*e == '-' || *e == '+') {
+      e_neg = (*e == '-');
+      e++;
+    }
+    if (*e >= '0' && *e <= '9') {
+      for (; *e >= '0' && *e <= '9'; e++) {
+        if (e_value < 100000)
+          e_value = e_value * 10 + (*e - '0');
+      }
+      written_exp = e_neg ? -e_value : e_value;
+      exp10 += written_exp;
+      p = e;
+    }
+  }
+  *end = p;
+
+  if (w == 0)
+    return negative ? -0.0f : 0.0f;
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  // Clinger: both operands are exact, so one IEEE operation rounds correctly
+  if (!truncated && w <= (1u << 24) && exp10 >= -10 && exp10 <= 10) {
+    float f = (float)w;
+    f = exp10 < 0 ? f / WF_POW10_FLOAT[-exp10] : f * WF_POW10_FLOAT[exp10];
+    return negative ? -f : f;
+  }
+#endif
+
+  int32_t  power2;
+  uint64_t mantissa;
+  wf_eisel_lemire(exp10, w, &power2, &mantissa);
+  if (truncated) {
+    // The true value lies between w and w + 1 scaled; only trust the result
+    // when both ends round to the same float
+    int32_t  power2_up;
+    uint64_t mantissa_up;
+    wf_eisel_lemire(exp10, w + 1, &power2_up, &mantissa_up);
+    if (power2 != power2_up || mantissa != mantissa_up) {
+      wf_decimal_t d;
+      wf_decimal_set(&d, digits, written_exp);
+      return wf_decimal_to_float(&d, negative);
+    }
+  }
+  return wf_float_from_bits(negative, power2, mantissa);
+}
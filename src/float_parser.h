@@ -0,0 +1,20 @@
+// src/float_parser.h
+#ifndef FLOAT_PARSER_H
+#define FLOAT_PARSER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Locale-independent decimal to float conversion. Accepts an optional sign,
+// digits with an optional '.', an optional exponent, and inf/infinity/nan.
+// The result is the correctly rounded float, bit-identical to strtof in the
+// "C" locale. Leading whitespace is not skipped. *end is set past the last
+// consumed character, or to s when nothing could be converted.
+float wf_strtof(const char* s, const char** end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLOAT_PARSER_H
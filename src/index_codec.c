@@ -0,0 +1,246 @@
+// src/index_codec.c
+#include <string.h>
+#include "index_codec.h"
+#include "wavefront.h"
+
+// Triangle index codec. Encoder and decoder keep the same state: the last
+// 16 edges (reversed, as a neighbouring triangle walks them), the last 16
+// vertices that were not fetched from the FIFO, the next vertex never seen
+// and the last vertex coded. Each triangle is one code byte:
+//   (r << 4) | e        edge e of the FIFO, rotation r, third vertex new
+//   ((3 + r) << 4) | e  same, third vertex in the vertex FIFO (index byte)
+//   ((6 + r) << 4) | e  same, third vertex as a zigzag varint delta
+//   0xF0                no shared edge, then one tag per vertex: 0 new,
+//                       1 + i vertex FIFO entry i, 17 varint delta
+// With indices in first-use order (see wf_indexed_mesh_optimize) most
+// triangles take one or two bytes.
+#define WF_CODEC_FIFO     16
+#define WF_CODEC_NO_EDGE  0xF0
+#define WF_CODEC_EXPLICIT 17
+
+typedef struct {
+  uint32_t edges[WF_CODEC_FIFO][2];
+  uint32_t vertices[WF_CODEC_FIFO];
+  unsigned edge_head;
+  unsigned vertex_head;
+  uint32_t next;
+  uint32_t last;
+} wf_codec_state_t;
+
+static const int WF_NEXT[3] = { 1, 2, 0 };
+static const int WF_PREV[3] = { 2, 0, 1 };
+
+static void wf_codec_push_edge(wf_codec_state_t* s, uint32_t a, uint32_t b) {
+  s->edges[s->edge_head][0] = a;
+  s->edges[s->edge_head][1] = b;
+  s->edge_head              = (s->edge_head + 1) & (WF_CODEC_FIFO - 1);
+}
+
+static void wf_codec_push_vertex(wf_codec_state_t* s, uint32_t v) {
+  s->vertices[s->vertex_head] = v;
+  s->vertex_head = (s->vertex_head + 1) & (WF_CODEC_FIFO - 1);
+  s->last        = v;
+}
+
+static const uint32_t* wf_codec_edge(const wf_codec_state_t* s, unsigned i) {
+  return s->edges[(s->edge_head - 1 - i) & (WF_CODEC_FIFO - 1)];
+}
+
+static uint32_t wf_codec_vertex(const wf_codec_state_t* s, unsigned i) {
+  return s->vertices[(s->vertex_head - 1 - i) & (WF_CODEC_FIFO - 1)];
+}
+
+static int wf_codec_find_vertex(const wf_codec_state_t* s, uint32_t v) {
+  for (unsigned i = 0; i < WF_CODEC_FIFO; i++) {
+    if (wf_codec_vertex(s, i) == v)
+      return (int)i;
+  }
+  return -1;
+}
+
+static uint32_t wf_zigzag(uint32_t delta) {
+  return (delta << 1) ^ (uint32_t)-(int32_t)(delta >> 31);
+}
+
+static uint32_t wf_unzigzag(uint32_t z) {
+  return (z >> 1) ^ (uint32_t)-(int32_t)(z & 1);
+}
+
+static unsigned char* wf_codec_put_delta(wf_codec_state_t* s,
+                                         unsigned char* out, uint32_t v) {
+  out = wf_put_varint(out, wf_zigzag(v - s->last));
+  wf_codec_push_vertex(s, v);
+  return out;
+}
+
+static const unsigned char* wf_codec_get_delta(wf_codec_state_t*    s,
+                                               const unsigned char* p,
+                                               const unsigned char* end,
+                                               uint32_t*            v) {
+  uint64_t z;
+  p = wf_get_varint(p, end, &z);
+  if (!p || z > UINT32_MAX)
+    return NULL;
+  *v = s->last + wf_unzigzag((uint32_t)z);
+  wf_codec_push_vertex(s, *v);
+  return p;
+}
+
+// Tagged vertex of a triangle without a shared edge
+static unsigned char* wf_codec_put_vertex(wf_codec_state_t* s,
+                                          unsigned char* out, uint32_t v) {
+  int i = wf_codec_find_vertex(s, v);
+  if (v == s->next) {
+    *out++ = 0;
+    s->next++;
+    wf_codec_push_vertex(s, v);
+  } else if (i >= 0) {
+    *out++ = (unsigned char)(1 + i);
+  } else {
+    *out++ = WF_CODEC_EXPLICIT;
+    out    = wf_codec_put_delta(s, out, v);
+  }
+  return out;
+}
+
+static const unsigned char* wf_codec_get_vertex(wf_codec_state_t*    s,
+                                                const unsigned char* p,
+                                                const unsigned char* end,
+                                                uint32_t*            v) {
+  if (p >= end)
+    return NULL;
+  unsigned tag = *p++;
+  if (tag == 0) {
+    *v = s->next++;
+    wf_codec_push_vertex(s, *v);
+  } else if (tag <= WF_CODEC_FIFO) {
+    *v = wf_codec_vertex(s, tag - 1);
+  } else if (tag == WF_CODEC_EXPLICIT) {
+    p = wf_codec_get_delta(s, p, end, v);
+  } else {
+    p = NULL;
+  }
+  return p;
+}
+
+unsigned char* wf_index_encode(unsigned char* out, const uint32_t* indices,
+                               size_t index_count) {
+  wf_codec_state_t s;
+  memset(&s, 0, sizeof(s));
+  for (size_t t = 0; t + 3 <= index_count; t += 3) {
+    const uint32_t* tri  = &indices[t];
+    int             edge = -1, r = 0;
+    for (unsigned i = 0; i < WF_CODEC_FIFO && edge < 0; i++) {
+      const uint32_t* e = wf_codec_edge(&s, i);
+      for (r = 0; r < 3; r++) {
+        if (e[0] == tri[r] && e[1] == tri[WF_NEXT[r]]) {
+          edge = (int)i;
+          break;
+        }
+      }
+    }
+
+    if (edge < 0) {
+      *out++ = WF_CODEC_NO_EDGE;
+      for (int k = 0; k < 3; k++)
+        out = wf_codec_put_vertex(&s, out, tri[k]);
+      wf_codec_push_edge(&s, tri[1], tri[0]);
+      wf_codec_push_edge(&s, tri[2], tri[1]);
+      wf_codec_push_edge(&s, tri[0], tri[2]);
+      continue;
+    }
+
+    uint32_t a = tri[r], b = tri[WF_NEXT[r]], c = tri[WF_PREV[r]];
+    int      i = wf_codec_find_vertex(&s, c);
+    if (c == s.next) {
+      *out++ = (unsigned char)(r << 4 | edge);
+      s.next++;
+      wf_codec_push_vertex(&s, c);
+    } else if (i >= 0) {
+      *out++ = (unsigned char)((3 + r) << 4 | edge);
+      *out++ = (unsigned char)i;
+    } else {
+      *out++ = (unsigned char)((6 + r) << 4 | edge);
+      out    = wf_codec_put_delta(&s, out, c);
+    }
+    wf_codec_push_edge(&s, c, b);
+    wf_codec_push_edge(&s, a, c);
+  }
+  return out;
+}
+
+const unsigned char* wf_index_decode(uint32_t* indices, size_t index_count,
+                                     const unsigned char* p,
+                                     const unsigned char* end) {
+  wf_codec_state_t s;
+  memset(&s, 0, sizeof(s));
+  for (size_t t = 0; t + 3 <= index_count; t += 3) {
+    uint32_t* tri = &indices[t];
+    if (p >= end)
+      return NULL;
+    unsigned code = *p++;
+
+    if (code == WF_CODEC_NO_EDGE) {
+      for (int k = 0; k < 3 && p; k++)
+        p = wf_codec_get_vertex(&s, p, end, &tri[k]);
+      if (!p)
+        return NULL;
+      wf_codec_push_edge(&s, tri[1], tri[0]);
+      wf_codec_push_edge(&s, tri[2], tri[1]);
+      wf_codec_push_edge(&s, tri[0], tri[2]);
+      continue;
+    }
+
+    unsigned kind = code >> 4;
+    if (kind >= 9)
+      return NULL;
+    int             r = (int)(kind % 3);
+    const uint32_t* e = wf_codec_edge(&s, code & 15);
+    uint32_t        a = e[0], b = e[1], c;
+    if (kind < 3) {
+      c = s.next++;
+      wf_codec_push_vertex(&s, c);
+    } else if (kind < 6) {
+      if (p >= end || *p >= WF_CODEC_FIFO)
+        return NULL;
+      c = wf_codec_vertex(&s, *p++);
+    } else if (!(p = wf_codec_get_delta(&s, p, end, &c))) {
+      return NULL;
+    }
+    tri[r]          = a;
+    tri[WF_NEXT[r]] = b;
+    tri[WF_PREV[r]] = c;
+    wf_codec_push_edge(&s, c, b);
+    wf_codec_push_edge(&s, a, c);
+  }
+  return p;
+}
+
+size_t wf_index_buffer_bound(size_t index_count) {
+  return WF_INDEX_CODEC_BOUND(index_count);
+}
+
+wf_error_t wf_encode_index_buffer(const uint32_t* indices, size_t index_count,
+                                  unsigned char* out, size_t out_size,
+                                  size_t* size) {
+  if ((!indices && index_count) || !out || !size || index_count % 3 != 0) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  if (out_size < WF_INDEX_CODEC_BOUND(index_count))
+    return WF_ERROR_OUT_OF_MEMORY;
+  *size = (size_t)(wf_index_encode(out, indices, index_count) - out);
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_decode_index_buffer(const unsigned char* data, size_t size,
+                                  uint32_t* indices, size_t index_count) {
+  if ((!data && size) || (!indices && index_count) || index_count % 3 != 0) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  if (index_count == 0)
+    return size == 0 ? WF_SUCCESS : WF_ERROR_INVALID_FORMAT;
+  const unsigned char* end = data + size;
+  if (wf_index_decode(indices, index_count, data, end) != end)
+    return WF_ERROR_INVALID_FORMAT;
+  return WF_SUCCESS;
+}
@@ -0,0 +1,56 @@
+// src/index_codec.h
+#ifndef INDEX_CODEC_H
+#define INDEX_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Largest encoding of n indices, n a multiple of 3
+#define WF_INDEX_CODEC_BOUND(n) ((n) / 3 * 19)
+
+// Encode index_count indices (a multiple of 3) to out, which must hold
+// WF_INDEX_CODEC_BOUND(index_count) bytes. Returns the end of the encoding.
+unsigned char* wf_index_encode(unsigned char* out, const uint32_t* indices,
+                               size_t index_count);
+
+// Decode index_count indices from [data, end). Returns the first byte not
+// consumed, or NULL if the data is corrupt.
+const unsigned char* wf_index_decode(uint32_t* indices, size_t index_count,
+                                     const unsigned char* data,
+                                     const unsigned char* end);
+
+// LEB128, at most 10 bytes
+static inline unsigned char* wf_put_varint(unsigned char* out,
+                                           uint64_t       value) {
+  while (value >= 0x80) {
+    *out++ = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (unsigned char)value;
+  return out;
+}
+
+static inline const unsigned char* wf_get_varint(const unsigned char* p,
+                                                 const unsigned char* end,
+                                                 uint64_t*            value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    unsigned char byte = *p++;
+    result |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INDEX_CODEC_H
@@ -1,13 +1,18 @@
 // src/lib.c
 #include <ctype.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "float_parser.h"
 
 #ifdef _WIN32
 #  include <io.h>
+#  include <malloc.h>
 #else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
 #endif
 
 char* wf_strdup(const char* str) {
@@ -54,8 +59,9 @@ float wf_parse_float(const char** s) {
   while (*sPtr == ' ' || *sPtr == '\t') {
     sPtr++;
   }
-  char* end;
-  float val = strtof(sPtr, &end);
+  // Not strtof: that honours LC_NUMERIC and rounds through the C library
+  const char* end;
+  float       val = wf_strtof(sPtr, &end);
   if (end != sPtr)
     *s = end;
   else
@@ -76,11 +82,14 @@ void* wf_realloc_array(void* ptr, size_t* capacity, size_t count,
                        size_t element_size) {
   if (!capacity)
     return NULL;
-  if (count < *capacity)
+  if (count <= *capacity)
     return ptr;
 
-  size_t new_capacity = *capacity + 16;
-  void*  new_ptr      = realloc(ptr, new_capacity * element_size);
+  // Geometric growth keeps appends amortized O(1)
+  size_t new_capacity = *capacity ? *capacity * 2 : 16;
+  if (new_capacity < count)
+    new_capacity = count;
+  void* new_ptr = realloc(ptr, new_capacity * element_size);
   if (new_ptr) {
     *capacity = new_capacity;
   }
@@ -117,3 +126,101 @@ int wf_strcasecmp(const char* s1, const char* s2) {
 size_t wf_strlen(const char* s) {
   return s ? strlen(s) : 0;
 }
+
+static int wf_map_file_prot(FILE* file, int writable, void** data,
+                            size_t* size) {
+#ifdef _WIN32
+  return -1;
+#else
+  struct stat st;
+  int         fd = fileno(file);
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)
+      || st.st_size <= 0) {
+    return -1;
+  }
+
+  int   prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* addr = mmap(NULL, (size_t)st.st_size, prot, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED)
+    return -1;
+
+  *data = addr;
+  *size = (size_t)st.st_size;
+  return 0;
+#endif
+}
+
+int wf_map_file(FILE* file, const char** data, size_t* size) {
+  void* addr;
+  if (wf_map_file_prot(file, 0, &addr, size) != 0)
+    return -1;
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+  madvise(addr, *size, MADV_SEQUENTIAL);
+#endif
+  *data = addr;
+  return 0;
+}
+
+int wf_map_file_private(FILE* file, char** data, size_t* size) {
+  void* addr;
+  if (wf_map_file_prot(file, 1, &addr, size) != 0)
+    return -1;
+  *data = addr;
+  return 0;
+}
+
+void wf_unmap_file(const char* data, size_t size) {
+#ifndef _WIN32
+  if (data)
+    munmap((void*)data, size);
+#endif
+}
+
+void* wf_aligned_alloc(size_t alignment, size_t size) {
+#ifdef _WIN32
+  return _aligned_malloc(size ? size : 1, alignment);
+#else
+  void* ptr = NULL;
+  if (posix_memalign(&ptr, alignment, size ? size : 1) != 0)
+    return NULL;
+  return ptr;
+#endif
+}
+
+void wf_aligned_free(void* ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+static uint64_t wf_rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+uint64_t wf_hash_bytes(const void* data, size_t size) {
+  const uint64_t       p1 = 0x9E3779B185EBCA87ull;
+  const uint64_t       p2 = 0xC2B2AE3D27D4EB4Full;
+  const unsigned char* p  = data;
+  uint64_t             h  = (uint64_t)size * p1;
+
+  // Eight bytes per step, the tail zero-padded
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    h = wf_rotl64(h ^ (w * p2), 31) * p1;
+  }
+  if (size) {
+    uint64_t w = 0;
+    memcpy(&w, p, size);
+    h = wf_rotl64(h ^ (w * p2), 31) * p1;
+  }
+
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
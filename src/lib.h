@@ -3,6 +3,8 @@
 #define LIB_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 char*  wf_strdup(const char* str);
 char*  wf_trim(char* s);
@@ -14,4 +16,32 @@ char*  wf_strndup(const char* str, size_t n);
 int    wf_strcasecmp(const char* s1, const char* s2);
 size_t wf_strlen(const char* s);
 
+// Map a regular file read-only; returns 0 on success, -1 when the file
+// cannot be mapped (pipes, empty files, unsupported platform)
+int  wf_map_file(FILE* file, const char** data, size_t* size);
+void wf_unmap_file(const char* data, size_t size);
+
+// Map a regular file copy-on-write: writes change the mapping, never the
+// file. Same return values as wf_map_file; release with wf_unmap_file.
+int wf_map_file_private(FILE* file, char** data, size_t* size);
+
+// Allocation aligned to a power of two that is a multiple of sizeof(void*);
+// release with wf_aligned_free
+void* wf_aligned_alloc(size_t alignment, size_t size);
+void  wf_aligned_free(void* ptr);
+
+// 64-bit hash of size bytes, not cryptographic
+uint64_t wf_hash_bytes(const void* data, size_t size);
+
+// Relaxed load and store of an int flag shared between threads
+#ifdef _MSC_VER
+#include <intrin.h>
+#define WF_ATOMIC_LOAD(p) ((int)_InterlockedOr((volatile long*)(p), 0))
+#define WF_ATOMIC_STORE(p, v) \
+  ((void)_InterlockedExchange((volatile long*)(p), (v)))
+#else
+#define WF_ATOMIC_LOAD(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define WF_ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#endif
+
 #endif // LIB_H
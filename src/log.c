@@ -0,0 +1,33 @@
+// src/log.c
+#include "log.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+static void wf_log_stderr(wf_log_level_t level, const char* message,
+                          void* user) {
+  static const char* names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+  (void)user;
+  if (level >= WF_LOG_WARN)
+    fprintf(stderr, "[wavefront] %s: %s\n", names[level], message);
+}
+
+static wf_log_callback_t log_callback = wf_log_stderr;
+static void*             log_user     = NULL;
+
+void wf_set_log_callback(wf_log_callback_t callback, void* user) {
+  log_callback = callback;
+  log_user     = user;
+}
+
+void wf_log(wf_log_level_t level, const char* format, ...) {
+  wf_log_callback_t callback = log_callback;
+  if (!callback)
+    return;
+
+  char    message[1024];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  callback(level, message, log_user);
+}
@@ -0,0 +1,57 @@
+// src/log.h
+#ifndef LOG_H
+#define LOG_H
+
+#include "wavefront.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compile-time levels, matching wf_log_level_t
+#define WF_LOG_LEVEL_DEBUG 0
+#define WF_LOG_LEVEL_INFO  1
+#define WF_LOG_LEVEL_WARN  2
+#define WF_LOG_LEVEL_ERROR 3
+#define WF_LOG_LEVEL_NONE  4
+
+// Calls below WF_LOG_LEVEL are removed by the preprocessor, arguments
+// included, so hot paths pay nothing for disabled levels
+#ifndef WF_LOG_LEVEL
+#  define WF_LOG_LEVEL WF_LOG_LEVEL_INFO
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void wf_log(wf_log_level_t level, const char* format, ...);
+
+#if WF_LOG_LEVEL <= WF_LOG_LEVEL_DEBUG
+#  define LOG_DEBUG(...) wf_log(WF_LOG_DEBUG, __VA_ARGS__)
+#else
+#  define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if WF_LOG_LEVEL <= WF_LOG_LEVEL_INFO
+#  define LOG_INFO(...) wf_log(WF_LOG_INFO, __VA_ARGS__)
+#else
+#  define LOG_INFO(...) ((void)0)
+#endif
+
+#if WF_LOG_LEVEL <= WF_LOG_LEVEL_WARN
+#  define LOG_WARN(...) wf_log(WF_LOG_WARN, __VA_ARGS__)
+#else
+#  define LOG_WARN(...) ((void)0)
+#endif
+
+#if WF_LOG_LEVEL <= WF_LOG_LEVEL_ERROR
+#  define LOG_ERROR(...) wf_log(WF_LOG_ERROR, __VA_ARGS__)
+#else
+#  define LOG_ERROR(...) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_H
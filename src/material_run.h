@@ -0,0 +1,31 @@
+// src/material_run.h
+#ifndef MATERIAL_RUN_H
+#define MATERIAL_RUN_H
+
+#include "wavefront.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Material runs of obj. An object of a scene assembled by hand may have
+// faces but no runs; its faces then form one run of obj->material_idx,
+// stored in *whole.
+static inline const wf_material_run_t* wf_object_runs(
+    const wf_object_t* obj, wf_material_run_t* whole, size_t* count) {
+  if (obj->material_run_count > 0 || obj->face_count == 0) {
+    *count = obj->material_run_count;
+    return obj->material_runs;
+  }
+  whole->start        = 0;
+  whole->count        = obj->face_count;
+  whole->material_idx = obj->material_idx;
+  *count              = 1;
+  return whole;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MATERIAL_RUN_H
@@ -0,0 +1,333 @@
+// src/mesh.c
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+#include "log.h"
+#include "material_run.h"
+#include "wavefront.h"
+
+#define WF_MESH_EMPTY     UINT32_MAX
+#define WF_MESH_MIN_SLOTS 1024
+
+// Unique corners in order of first use, plus an open-addressing table
+// (linear probing, load factor at most 1/2) holding indices into them
+typedef struct {
+  wf_vertex_index* keys;
+  size_t           count;
+  size_t           cap;
+  uint32_t*        slots;
+  size_t           mask;
+} wf_corner_table_t;
+
+static uint32_t wf_corner_hash(wf_vertex_index c) {
+  uint32_t h = (uint32_t)c.v_idx;
+  h          = h * 0x9E3779B1u + (uint32_t)c.vt_idx;
+  h          = h * 0x9E3779B1u + (uint32_t)c.vn_idx;
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+// Allocate an empty table of slot_count slots, a power of two
+static int wf_corner_table_resize(wf_corner_table_t* table,
+                                  size_t             slot_count) {
+  uint32_t* slots = malloc(slot_count * sizeof(uint32_t));
+  if (!slots)
+    return -1;
+  memset(slots, 0xFF, slot_count * sizeof(uint32_t));
+
+  size_t mask = slot_count - 1;
+  for (size_t i = 0; i < table->count; i++) {
+    size_t s = wf_corner_hash(table->keys[i]) & mask;
+    while (slots[s] != WF_MESH_EMPTY)
+      s = (s + 1) & mask;
+    slots[s] = (uint32_t)i;
+  }
+  free(table->slots);
+  table->slots = slots;
+  table->mask  = mask;
+  return 0;
+}
+
+// Index of corner c, adding it if it was not seen before
+static wf_error_t wf_corner_table_insert(wf_corner_table_t* table,
+                                         wf_vertex_index c, uint32_t* index) {
+  size_t s = wf_corner_hash(c) & table->mask;
+  for (;;) {
+    uint32_t i = table->slots[s];
+    if (i == WF_MESH_EMPTY)
+      break;
+    const wf_vertex_index* k = &table->keys[i];
+    if (k->v_idx == c.v_idx && k->vt_idx == c.vt_idx
+        && k->vn_idx == c.vn_idx) {
+      *index = i;
+      return WF_SUCCESS;
+    }
+    s = (s + 1) & table->mask;
+  }
+
+  if (table->count >= WF_MESH_EMPTY - 1)
+    return WF_ERROR_UNSUPPORTED_FEATURE;
+  if (table->count == table->cap) {
+    wf_vertex_index* keys =
+        wf_realloc_array(table->keys, &table->cap, table->count + 1,
+                         sizeof(wf_vertex_index));
+    if (!keys)
+      return WF_ERROR_OUT_OF_MEMORY;
+    table->keys = keys;
+  }
+  *index                      = (uint32_t)table->count;
+  table->keys[table->count++] = c;
+  table->slots[s]             = *index;
+
+  if (table->count * 2 > table->mask + 1) {
+    if (wf_corner_table_resize(table, (table->mask + 1) * 2) != 0)
+      return WF_ERROR_OUT_OF_MEMORY;
+  }
+  return WF_SUCCESS;
+}
+
+// Texture coordinate and normal indices outside the scene count as absent
+static wf_vertex_index wf_mesh_corner(const wf_scene_t* scene,
+                                      wf_vertex_index   c) {
+  if (c.vt_idx < 0 || (size_t)c.vt_idx >= scene->texcoord_count)
+    c.vt_idx = -1;
+  if (c.vn_idx < 0 || (size_t)c.vn_idx >= scene->normal_count)
+    c.vn_idx = -1;
+  return c;
+}
+
+static int wf_mesh_face_valid(const wf_scene_t* scene, const wf_face* face) {
+  for (int j = 0; j < 3; j++) {
+    int v = face->vertices[j].v_idx;
+    if (v < 0 || (size_t)v >= scene->vertex_count)
+      return 0;
+  }
+  return 1;
+}
+
+// Group a run of triangles lands in
+static size_t wf_mesh_bucket(const wf_scene_t* scene, size_t material,
+                             size_t ordinal, int by_material) {
+  if (!by_material)
+    return ordinal;
+  return material < scene->material_count ? material : scene->material_count;
+}
+
+// Material shared by all of an object's faces, (size_t)-1 if they differ
+static size_t wf_object_material(const wf_scene_t*  scene,
+                                 const wf_object_t* obj) {
+  wf_material_run_t        whole;
+  size_t                   run_count;
+  const wf_material_run_t* runs = wf_object_runs(obj, &whole, &run_count);
+  if (run_count == 0)
+    return (size_t)-1;
+  size_t material = runs[0].material_idx;
+  for (size_t r = 1; r < run_count; r++) {
+    if (runs[r].material_idx != material)
+      return (size_t)-1;
+  }
+  return material < scene->material_count ? material : (size_t)-1;
+}
+
+// Copy the attributes of every unique corner into the output streams
+static wf_error_t wf_mesh_fill_vertices(const wf_scene_t*        scene,
+                                        const wf_corner_table_t* table,
+                                        int                separate_streams,
+                                        wf_indexed_mesh_t* mesh) {
+  size_t count       = table->count;
+  int    has_texture = 0;
+  int    has_normal  = 0;
+  for (size_t i = 0; i < count; i++) {
+    has_texture |= table->keys[i].vt_idx >= 0;
+    has_normal |= table->keys[i].vn_idx >= 0;
+  }
+  mesh->vertex_count = count;
+  if (count == 0)
+    return WF_SUCCESS;
+
+  if (!separate_streams) {
+    mesh->vertices = calloc(count, sizeof(wf_mesh_vertex_t));
+    if (!mesh->vertices)
+      return WF_ERROR_OUT_OF_MEMORY;
+    for (size_t i = 0; i < count; i++) {
+      wf_vertex_index   k = table->keys[i];
+      wf_mesh_vertex_t* v = &mesh->vertices[i];
+      v->position         = wf_scene_vertex(scene, k.v_idx);
+      if (k.vn_idx >= 0)
+        v->normal = wf_scene_normal(scene, k.vn_idx);
+      if (k.vt_idx >= 0) {
+        wf_vec3 t = wf_scene_texcoord(scene, k.vt_idx);
+        v->u      = t.x;
+        v->v      = t.y;
+      }
+    }
+    return WF_SUCCESS;
+  }
+
+  mesh->positions = malloc(count * sizeof(wf_vec3));
+  if (has_texture)
+    mesh->texcoords = calloc(count, sizeof(wf_vec3));
+  if (has_normal)
+    mesh->normals = calloc(count, sizeof(wf_vec3));
+  if (!mesh->positions || (has_texture && !mesh->texcoords)
+      || (has_normal && !mesh->normals)) {
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  for (size_t i = 0; i < count; i++) {
+    wf_vertex_index k  = table->keys[i];
+    mesh->positions[i] = wf_scene_vertex(scene, k.v_idx);
+    if (k.vt_idx >= 0)
+      mesh->texcoords[i] = wf_scene_texcoord(scene, k.vt_idx);
+    if (k.vn_idx >= 0)
+      mesh->normals[i] = wf_scene_normal(scene, k.vn_idx);
+  }
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_scene_build_indexed_mesh(const wf_scene_t*        scene,
+                                       const wf_mesh_options_t* options,
+                                       wf_indexed_mesh_t*       mesh) {
+  if (!scene || !mesh) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  memset(mesh, 0, sizeof(wf_indexed_mesh_t));
+
+  wf_mesh_options_t opts = { 0 };
+  if (options)
+    opts = *options;
+
+  // Pass 1: triangles per group, so indices can be written in group order
+  size_t object_count = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next)
+    object_count++;
+  size_t bucket_count =
+      opts.by_material ? scene->material_count + 1 : object_count;
+
+  wf_corner_table_t table   = { 0 };
+  size_t*           cursor  = calloc(bucket_count + 1, sizeof(size_t));
+  size_t            corners = 0;
+  size_t            ordinal = 0;
+  wf_error_t        result  = WF_SUCCESS;
+  if (!cursor)
+    return WF_ERROR_OUT_OF_MEMORY;
+
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    wf_material_run_t        whole;
+    size_t                   run_count;
+    const wf_material_run_t* runs = wf_object_runs(obj, &whole, &run_count);
+    for (size_t r = 0; r < run_count; r++) {
+      const wf_material_run_t* run    = &runs[r];
+      size_t                   bucket = wf_mesh_bucket(
+          scene, run->material_idx, ordinal, opts.by_material);
+      for (size_t i = run->start; i < run->start + run->count; i++) {
+        if (wf_mesh_face_valid(scene, &obj->faces[i]))
+          cursor[bucket] += 3;
+      }
+    }
+    ordinal++;
+  }
+
+  size_t group_count = 0;
+  for (size_t b = 0; b < bucket_count; b++) {
+    corners += cursor[b];
+    group_count += cursor[b] > 0;
+  }
+
+  mesh->groups =
+      calloc(group_count ? group_count : 1, sizeof(wf_mesh_group_t));
+  mesh->indices = malloc((corners ? corners : 1) * sizeof(uint32_t));
+  if (!mesh->groups || !mesh->indices) {
+    result = WF_ERROR_OUT_OF_MEMORY;
+    goto done;
+  }
+
+  // Turn counts into start offsets and describe the non-empty groups
+  const wf_object_t* obj    = scene->objects;
+  size_t             offset = 0;
+  for (size_t b = 0; b < bucket_count; b++) {
+    size_t count = cursor[b];
+    cursor[b]    = offset;
+    if (count > 0) {
+      wf_mesh_group_t* group = &mesh->groups[mesh->group_count++];
+      group->first_index     = offset;
+      group->index_count     = count;
+      if (opts.by_material) {
+        group->material_idx = b < scene->material_count ? b : (size_t)-1;
+      } else {
+        group->material_idx = wf_object_material(scene, obj);
+        group->name         = obj->name;
+      }
+    }
+    offset += count;
+    if (!opts.by_material)
+      obj = obj->next;
+  }
+  mesh->index_count = corners;
+
+  // Pass 2: deduplicate corners. The table starts sized for every position
+  // being used once, the common case for smooth meshes.
+  size_t expected = scene->vertex_count < corners ? scene->vertex_count
+                                                  : corners;
+  size_t slots    = WF_MESH_MIN_SLOTS;
+  while (slots < expected * 2)
+    slots *= 2;
+  table.cap  = expected;
+  table.keys = malloc((expected ? expected : 1) * sizeof(wf_vertex_index));
+  if (!table.keys || wf_corner_table_resize(&table, slots) != 0) {
+    result = WF_ERROR_OUT_OF_MEMORY;
+    goto done;
+  }
+
+  ordinal = 0;
+  for (obj = scene->objects; obj; obj = obj->next, ordinal++) {
+    wf_material_run_t        whole;
+    size_t                   run_count;
+    const wf_material_run_t* runs = wf_object_runs(obj, &whole, &run_count);
+    for (size_t r = 0; r < run_count; r++) {
+      const wf_material_run_t* run    = &runs[r];
+      size_t                   bucket = wf_mesh_bucket(
+          scene, run->material_idx, ordinal, opts.by_material);
+      uint32_t* out = mesh->indices + cursor[bucket];
+      for (size_t i = run->start; i < run->start + run->count; i++) {
+        const wf_face* face = &obj->faces[i];
+        if (!wf_mesh_face_valid(scene, face))
+          continue;
+        for (int j = 0; j < 3; j++) {
+          wf_vertex_index c = wf_mesh_corner(scene, face->vertices[j]);
+          result            = wf_corner_table_insert(&table, c, out++);
+          if (result != WF_SUCCESS)
+            goto done;
+        }
+      }
+      cursor[bucket] = out - mesh->indices;
+    }
+  }
+
+  result = wf_mesh_fill_vertices(scene, &table, opts.separate_streams, mesh);
+  LOG_DEBUG("Indexed mesh: %zu corners, %zu unique vertices, %zu groups",
+            corners, table.count, mesh->group_count);
+
+done:
+  free(cursor);
+  free(table.keys);
+  free(table.slots);
+  if (result != WF_SUCCESS)
+    wf_free_indexed_mesh(mesh);
+  return result;
+}
+
+void wf_free_indexed_mesh(wf_indexed_mesh_t* mesh) {
+  if (!mesh)
+    return;
+  free(mesh->vertices);
+  free(mesh->positions);
+  free(mesh->texcoords);
+  free(mesh->normals);
+  free(mesh->indices);
+  free(mesh->groups);
+  memset(mesh, 0, sizeof(wf_indexed_mesh_t));
+}
@@ -0,0 +1,264 @@
+// src/mesh_optimize.c
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "wavefront.h"
+
+#define WF_CACHE_DEFAULT_SIZE 16
+
+// Simulate a FIFO cache of cache_size entries over the index buffer. stamp
+// is per-vertex scratch space.
+static wf_mesh_cache_stats_t wf_measure_cache(const uint32_t* indices,
+                                              size_t          index_count,
+                                              size_t          vertex_count,
+                                              size_t          cache_size,
+                                              size_t*         stamp) {
+  wf_mesh_cache_stats_t stats  = { 0 };
+  size_t                misses = 0, unique = 0;
+  memset(stamp, 0, vertex_count * sizeof(size_t));
+  for (size_t i = 0; i < index_count; i++) {
+    uint32_t v = indices[i];
+    if (stamp[v] == 0)
+      unique++;
+    if (stamp[v] == 0 || misses - stamp[v] >= cache_size)
+      stamp[v] = ++misses;
+  }
+  if (index_count)
+    stats.acmr = (float)misses / (float)(index_count / 3);
+  if (unique)
+    stats.atvr = (float)misses / (float)unique;
+  return stats;
+}
+
+wf_error_t wf_indexed_mesh_cache_stats(const wf_indexed_mesh_t* mesh,
+                                       size_t                   cache_size,
+                                       wf_mesh_cache_stats_t*   stats) {
+  if (!mesh || !stats) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  size_t* stamp = malloc((mesh->vertex_count + 1) * sizeof(size_t));
+  if (!stamp)
+    return WF_ERROR_OUT_OF_MEMORY;
+  *stats = wf_measure_cache(mesh->indices, mesh->index_count,
+                            mesh->vertex_count,
+                            cache_size ? cache_size : WF_CACHE_DEFAULT_SIZE,
+                            stamp);
+  free(stamp);
+  return WF_SUCCESS;
+}
+
+// Tipsify (Sander, Nehab and Barczak, 2007) state. Triangle lists of each
+// vertex are in index buffer order, so the triangles of one group form a
+// contiguous part of every list.
+typedef struct {
+  const uint32_t* indices;
+  size_t*         offsets;   /**< Triangles of vertex v are
+                                  adjacency[offsets[v]..offsets[v + 1]) */
+  uint32_t*       adjacency;
+  size_t*         cursor;    /**< Per vertex: first entry not yet emitted */
+  uint32_t*       live;      /**< Per vertex: triangles left in the group */
+  size_t*         cache_time;
+  unsigned char*  emitted;
+  uint32_t*       dead_end;  /**< Stack of recently used vertices */
+  size_t          dead_top;
+  size_t          time;
+  size_t          cache_size;
+} wf_tipsify_t;
+
+// Best next fanning vertex among the ones the last fan touched: the
+// oldest still in cache, or none if all would be evicted before use
+static int64_t wf_tipsify_next(wf_tipsify_t* ts, size_t first) {
+  int64_t best     = -1;
+  int64_t priority = -1;
+  for (size_t i = first; i < ts->dead_top; i++) {
+    uint32_t v = ts->dead_end[i];
+    if (ts->live[v] == 0)
+      continue;
+    int64_t p   = 0;
+    size_t  age = ts->time - ts->cache_time[v];
+    if (age + 2 * ts->live[v] <= ts->cache_size)
+      p = (int64_t)age;
+    if (p > priority) {
+      priority = p;
+      best     = v;
+    }
+  }
+  return best;
+}
+
+// Reorder triangles [begin, end) into out
+static void wf_tipsify_group(wf_tipsify_t* ts, size_t begin, size_t end,
+                             uint32_t* out) {
+  for (size_t t = begin; t < end; t++) {
+    for (int j = 0; j < 3; j++)
+      ts->live[ts->indices[3 * t + j]]++;
+  }
+
+  size_t  scan = begin;
+  int64_t f    = begin < end ? (int64_t)ts->indices[3 * begin] : -1;
+  ts->dead_top = 0;
+  while (f >= 0) {
+    size_t first = ts->dead_top;
+    size_t j     = ts->cursor[f];
+    for (; j < ts->offsets[f + 1]; j++) {
+      uint32_t t = ts->adjacency[j];
+      if (t >= end)
+        break;
+      if (ts->emitted[t])
+        continue;
+      ts->emitted[t] = 1;
+      for (int k = 0; k < 3; k++) {
+        uint32_t v = ts->indices[3 * t + k];
+        *out++     = v;
+        ts->dead_end[ts->dead_top++] = v;
+        ts->live[v]--;
+        if (ts->time - ts->cache_time[v] > ts->cache_size)
+          ts->cache_time[v] = ts->time++;
+      }
+    }
+    ts->cursor[f] = j;
+
+    f = wf_tipsify_next(ts, first);
+    while (f < 0 && ts->dead_top > 0) {
+      uint32_t v = ts->dead_end[--ts->dead_top];
+      if (ts->live[v] > 0)
+        f = v;
+    }
+    if (f < 0) {
+      while (scan < end && ts->emitted[scan])
+        scan++;
+      f = scan < end ? (int64_t)ts->indices[3 * scan] : -1;
+    }
+  }
+}
+
+// Renumber vertices in order of first use and permute every stream
+static wf_error_t wf_reorder_vertices(wf_indexed_mesh_t* mesh) {
+  size_t    count      = mesh->vertex_count;
+  uint32_t* remap      = malloc((count + 1) * sizeof(uint32_t));
+  void*     streams[4] = { mesh->vertices, mesh->positions, mesh->texcoords,
+                           mesh->normals };
+  size_t    sizes[4]   = { sizeof(wf_mesh_vertex_t), sizeof(wf_vec3),
+                           sizeof(wf_vec3), sizeof(wf_vec3) };
+  void*     moved[4]   = { NULL };
+  int       ok         = remap != NULL;
+  for (int s = 0; s < 4 && ok; s++) {
+    if (streams[s])
+      ok = (moved[s] = malloc((count + 1) * sizes[s])) != NULL;
+  }
+  if (!ok) {
+    for (int s = 0; s < 4; s++)
+      free(moved[s]);
+    free(remap);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+
+  uint32_t next = 0;
+  memset(remap, 0xFF, count * sizeof(uint32_t));
+  for (size_t i = 0; i < mesh->index_count; i++) {
+    uint32_t v = mesh->indices[i];
+    if (remap[v] == UINT32_MAX)
+      remap[v] = next++;
+    mesh->indices[i] = remap[v];
+  }
+  for (size_t v = 0; v < count; v++) {
+    if (remap[v] == UINT32_MAX)
+      remap[v] = next++;
+  }
+
+  for (int s = 0; s < 4; s++) {
+    if (!streams[s])
+      continue;
+    for (size_t v = 0; v < count; v++) {
+      memcpy((char*)moved[s] + remap[v] * sizes[s],
+             (const char*)streams[s] + v * sizes[s], sizes[s]);
+    }
+    free(streams[s]);
+  }
+  mesh->vertices  = moved[0];
+  mesh->positions = moved[1];
+  mesh->texcoords = moved[2];
+  mesh->normals   = moved[3];
+  free(remap);
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_indexed_mesh_optimize(wf_indexed_mesh_t*                mesh,
+                                    const wf_mesh_optimize_options_t* options,
+                                    wf_mesh_cache_stats_t*            before,
+                                    wf_mesh_cache_stats_t*            after) {
+  if (!mesh) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  size_t cache_size = options ? options->cache_size : 0;
+  if (cache_size == 0)
+    cache_size = WF_CACHE_DEFAULT_SIZE;
+
+  size_t       vertex_count   = mesh->vertex_count;
+  size_t       triangle_count = mesh->index_count / 3;
+  wf_tipsify_t ts             = { .indices    = mesh->indices,
+                                  .time       = cache_size + 1,
+                                  .cache_size = cache_size };
+  ts.offsets    = calloc(vertex_count + 1, sizeof(size_t));
+  ts.adjacency  = malloc((3 * triangle_count + 1) * sizeof(uint32_t));
+  ts.cursor     = malloc((vertex_count + 1) * sizeof(size_t));
+  ts.live       = calloc(vertex_count + 1, sizeof(uint32_t));
+  ts.cache_time = calloc(vertex_count + 1, sizeof(size_t));
+  ts.emitted    = calloc(triangle_count + 1, 1);
+  ts.dead_end   = malloc((3 * triangle_count + 1) * sizeof(uint32_t));
+  uint32_t*  out    = malloc((mesh->index_count + 1) * sizeof(uint32_t));
+  wf_error_t result = WF_ERROR_OUT_OF_MEMORY;
+  if (!ts.offsets || !ts.adjacency || !ts.cursor || !ts.live
+      || !ts.cache_time || !ts.emitted || !ts.dead_end || !out)
+    goto done;
+
+  wf_mesh_cache_stats_t stats_before =
+      wf_measure_cache(mesh->indices, mesh->index_count, vertex_count,
+                       cache_size, ts.cursor);
+
+  // Vertex to triangle adjacency by counting sort
+  for (size_t i = 0; i < 3 * triangle_count; i++)
+    ts.offsets[mesh->indices[i] + 1]++;
+  for (size_t v = 0; v < vertex_count; v++)
+    ts.offsets[v + 1] += ts.offsets[v];
+  memcpy(ts.cursor, ts.offsets, vertex_count * sizeof(size_t));
+  for (size_t i = 0; i < 3 * triangle_count; i++)
+    ts.adjacency[ts.cursor[mesh->indices[i]]++] = (uint32_t)(i / 3);
+  memcpy(ts.cursor, ts.offsets, vertex_count * sizeof(size_t));
+
+  // Groups cover the index buffer without overlapping
+  memcpy(out, mesh->indices, mesh->index_count * sizeof(uint32_t));
+  for (size_t g = 0; g < mesh->group_count; g++) {
+    const wf_mesh_group_t* group = &mesh->groups[g];
+    size_t                 begin = group->first_index / 3;
+    wf_tipsify_group(&ts, begin, begin + group->index_count / 3,
+                     out + group->first_index);
+  }
+  memcpy(mesh->indices, out, 3 * triangle_count * sizeof(uint32_t));
+
+  result = wf_reorder_vertices(mesh);
+  if (result != WF_SUCCESS)
+    goto done;
+
+  wf_mesh_cache_stats_t stats_after =
+      wf_measure_cache(mesh->indices, mesh->index_count, vertex_count,
+                       cache_size, ts.cursor);
+  LOG_INFO("Vertex cache (%zu entries): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+           cache_size, stats_before.acmr, stats_after.acmr, stats_before.atvr,
+           stats_after.atvr);
+  if (before)
+    *before = stats_before;
+  if (after)
+    *after = stats_after;
+
+done:
+  free(ts.offsets);
+  free(ts.adjacency);
+  free(ts.cursor);
+  free(ts.live);
+  free(ts.cache_time);
+  free(ts.emitted);
+  free(ts.dead_end);
+  free(out);
+  return result;
+}
@@ -0,0 +1,235 @@
+// src/mtl_cache.c
+#include "mtl_cache.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "arena.h"
+#include "lib.h"
+#include "log.h"
+#include "name_index.h"
+
+// Parsed MTL files of every load with use_mtl_cache, keyed by canonical
+// path, size and mtime. Listed entries are never modified; a load holds a
+// reference while it copies one, so a clear or a newer version of the file
+// does not free materials still being copied.
+typedef struct wf_mtl_cache_entry_s {
+  char*                        path;
+  uint64_t                     size;
+  int64_t                      mtime;
+  wf_material_t*               materials; /**< Heap allocated */
+  size_t                       material_count;
+  size_t                       refs; /**< Guarded by wf_mtl_cache_lock, the
+                                          list holds one */
+  struct wf_mtl_cache_entry_s* next;
+} wf_mtl_cache_entry_t;
+
+static pthread_mutex_t       wf_mtl_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static wf_mtl_cache_entry_t* wf_mtl_cache_head;
+static size_t                wf_mtl_cache_hits;
+static size_t                wf_mtl_cache_misses;
+
+// String members of wf_material_t, each owned by its material
+static const size_t WF_MATERIAL_STRINGS[] = {
+  offsetof(wf_material_t, name),   offsetof(wf_material_t, map_Ka),
+  offsetof(wf_material_t, map_Kd), offsetof(wf_material_t, map_Ks),
+  offsetof(wf_material_t, map_Ns), offsetof(wf_material_t, map_d),
+  offsetof(wf_material_t, map_Tr), offsetof(wf_material_t, bump),
+  offsetof(wf_material_t, disp),   offsetof(wf_material_t, decal)
+};
+#define WF_MATERIAL_STRING_COUNT \
+  (sizeof(WF_MATERIAL_STRINGS) / sizeof(WF_MATERIAL_STRINGS[0]))
+
+static char** wf_material_string(wf_material_t* mat, size_t i) {
+  return (char**)((char*)mat + WF_MATERIAL_STRINGS[i]);
+}
+
+static char* wf_canonical_path(const char* filename) {
+#ifdef _WIN32
+  return _fullpath(NULL, filename, 0);
+#else
+  return realpath(filename, NULL);
+#endif
+}
+
+static void wf_mtl_cache_free_entry(wf_mtl_cache_entry_t* entry) {
+  for (size_t i = 0; i < entry->material_count; i++) {
+    for (size_t s = 0; s < WF_MATERIAL_STRING_COUNT; s++)
+      free(*wf_material_string(&entry->materials[i], s));
+  }
+  free(entry->materials);
+  free(entry->path);
+  free(entry);
+}
+
+// Drop a reference; the caller holds wf_mtl_cache_lock
+static void wf_mtl_cache_release(wf_mtl_cache_entry_t* entry) {
+  if (--entry->refs == 0)
+    wf_mtl_cache_free_entry(entry);
+}
+
+// Unlink every entry for path; the caller holds wf_mtl_cache_lock
+static void wf_mtl_cache_remove(const char* path) {
+  wf_mtl_cache_entry_t** link = &wf_mtl_cache_head;
+  while (*link) {
+    wf_mtl_cache_entry_t* entry = *link;
+    if (strcmp(entry->path, path) == 0) {
+      *link = entry->next;
+      wf_mtl_cache_release(entry);
+    } else {
+      link = &entry->next;
+    }
+  }
+}
+
+// Referenced entry for path as it is on disk, NULL if there is none
+static wf_mtl_cache_entry_t* wf_mtl_cache_acquire(const char* path,
+                                                  uint64_t    size,
+                                                  int64_t     mtime) {
+  wf_mtl_cache_entry_t* entry = NULL;
+  pthread_mutex_lock(&wf_mtl_cache_lock);
+  for (entry = wf_mtl_cache_head; entry; entry = entry->next) {
+    if (strcmp(entry->path, path) == 0)
+      break;
+  }
+  if (entry && (entry->size != size || entry->mtime != mtime)) {
+    wf_mtl_cache_remove(path);
+    entry = NULL;
+  }
+  if (entry) {
+    entry->refs++;
+    wf_mtl_cache_hits++;
+  } else {
+    wf_mtl_cache_misses++;
+  }
+  pthread_mutex_unlock(&wf_mtl_cache_lock);
+  return entry;
+}
+
+// Parse filename into a new entry and list it, replacing whatever another
+// thread listed for the same path meanwhile
+static wf_error_t wf_mtl_cache_insert(wf_mtl_parser_t* parser,
+                                      const char* filename, char* path,
+                                      uint64_t size, int64_t mtime,
+                                      wf_mtl_cache_entry_t** out) {
+  wf_mtl_cache_entry_t* entry = calloc(1, sizeof(wf_mtl_cache_entry_t));
+  if (!entry) {
+    free(path);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  entry->path  = path;
+  entry->size  = size;
+  entry->mtime = mtime;
+  entry->refs  = 2;
+
+  wf_mtl_parser_t private_parser = { 0 };
+  private_parser.mtl_dir         = parser->mtl_dir;
+  size_t     cap                 = 0;
+  wf_error_t result =
+      wf_mtl_parse_file(&private_parser, filename, &entry->materials,
+                        &entry->material_count, &cap);
+  if (result != WF_SUCCESS) {
+    wf_mtl_cache_free_entry(entry);
+    return result;
+  }
+
+  pthread_mutex_lock(&wf_mtl_cache_lock);
+  wf_mtl_cache_remove(path);
+  entry->next       = wf_mtl_cache_head;
+  wf_mtl_cache_head = entry;
+  pthread_mutex_unlock(&wf_mtl_cache_lock);
+  *out = entry;
+  return WF_SUCCESS;
+}
+
+// Append copies of the entry's materials, the way wf_mtl_parse_buffer
+// appends parsed ones
+static wf_error_t wf_mtl_cache_copy(const wf_mtl_cache_entry_t* entry,
+                                    wf_mtl_parser_t*            parser,
+                                    wf_material_t**             materials,
+                                    size_t*                     material_count,
+                                    size_t*                     material_cap) {
+  if (entry->material_count == 0)
+    return WF_SUCCESS;
+  wf_material_t* mats = wf_arena_realloc_array(
+      parser->arena, *materials, material_cap,
+      *material_count + entry->material_count, sizeof(wf_material_t));
+  if (!mats)
+    return WF_ERROR_OUT_OF_MEMORY;
+  *materials = mats;
+
+  for (size_t i = 0; i < entry->material_count; i++) {
+    size_t         index = (*material_count)++;
+    wf_material_t* mat   = &mats[index];
+    int            ok    = 1;
+    *mat                 = entry->materials[i];
+    for (size_t s = 0; s < WF_MATERIAL_STRING_COUNT; s++) {
+      char** str = wf_material_string(mat, s);
+      if (*str)
+        ok = (*str = wf_arena_strdup(parser->arena, *str)) != NULL && ok;
+    }
+    if (!ok
+        || (parser->index && mat->name
+            && wf_name_index_insert(parser->index, mat->name, index) != 0))
+      return WF_ERROR_OUT_OF_MEMORY;
+  }
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_mtl_cache_load(wf_mtl_parser_t* parser, const char* filename,
+                             wf_material_t** materials, size_t* material_count,
+                             size_t* material_cap) {
+  struct stat st;
+  char*       path = NULL;
+  if (parser->io || stat(filename, &st) != 0
+      || !(path = wf_canonical_path(filename)))
+    return wf_mtl_parse_file(parser, filename, materials, material_count,
+                             material_cap);
+
+  uint64_t              size  = (uint64_t)st.st_size;
+  int64_t               mtime = (int64_t)st.st_mtime;
+  wf_error_t            result;
+  wf_mtl_cache_entry_t* entry = wf_mtl_cache_acquire(path, size, mtime);
+  if (entry) {
+    LOG_DEBUG("MTL cache hit: %s", path);
+    free(path);
+  } else {
+    result = wf_mtl_cache_insert(parser, filename, path, size, mtime, &entry);
+    if (result != WF_SUCCESS)
+      return result;
+  }
+
+  result = wf_mtl_cache_copy(entry, parser, materials, material_count,
+                             material_cap);
+  pthread_mutex_lock(&wf_mtl_cache_lock);
+  wf_mtl_cache_release(entry);
+  pthread_mutex_unlock(&wf_mtl_cache_lock);
+  return result;
+}
+
+void wf_mtl_cache_clear(void) {
+  pthread_mutex_lock(&wf_mtl_cache_lock);
+  while (wf_mtl_cache_head) {
+    wf_mtl_cache_entry_t* entry = wf_mtl_cache_head;
+    wf_mtl_cache_head           = entry->next;
+    wf_mtl_cache_release(entry);
+  }
+  wf_mtl_cache_hits   = 0;
+  wf_mtl_cache_misses = 0;
+  pthread_mutex_unlock(&wf_mtl_cache_lock);
+}
+
+void wf_mtl_cache_get_stats(wf_mtl_cache_stats_t* stats) {
+  if (!stats)
+    return;
+  memset(stats, 0, sizeof(wf_mtl_cache_stats_t));
+  pthread_mutex_lock(&wf_mtl_cache_lock);
+  for (const wf_mtl_cache_entry_t* entry = wf_mtl_cache_head; entry;
+       entry = entry->next)
+    stats->entries++;
+  stats->hits   = wf_mtl_cache_hits;
+  stats->misses = wf_mtl_cache_misses;
+  pthread_mutex_unlock(&wf_mtl_cache_lock);
+}
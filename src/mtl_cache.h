@@ -0,0 +1,23 @@
+// src/mtl_cache.h
+#ifndef MTL_CACHE_H
+#define MTL_CACHE_H
+
+#include "mtl_parser.h"
+#include "wavefront.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// wf_mtl_parse_file through the process-wide cache: append copies of the
+// cached materials of filename, parsing it only when it is not cached or
+// changed on disk. Files from parser->io bypass the cache.
+wf_error_t wf_mtl_cache_load(wf_mtl_parser_t* parser, const char* filename,
+                             wf_material_t** materials, size_t* material_count,
+                             size_t* material_cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MTL_CACHE_H
@@ -2,18 +2,21 @@
 #include "mtl_parser.h"
 #include <stdlib.h>
 #include <string.h>
+#include "file_io.h"
 #include "lib.h"
-#include "log4c.h"
+#include "log.h"
+#include "name_index.h"
 
 // Helper: safely assign string (free old, strdup new)
 #define SET_MATERIAL_STRING(mat, member, value)                                \
   do {                                                                         \
-    free((mat)->member);                                                       \
-    (mat)->member = (value) ? wf_strdup(value) : NULL;                         \
+    wf_arena_free(arena, (mat)->member);                                       \
+    (mat)->member = (value) ? wf_arena_strdup(arena, value) : NULL;            \
   } while (0)
 
 // Parse a single material property (called after newmtl)
-static void parse_material_property(wf_material_t* mat, const char* line) {
+static void parse_material_property(wf_arena_t* arena, wf_material_t* mat,
+                                    const char* line) {
   char* s = wf_trim((char*)line);
 
   // Skip comments and empty lines
@@ -105,29 +108,36 @@ static void parse_material_property(wf_material_t* mat, const char* line) {
   // Note: Ke, sharpness, etc. are ignored (not in wf_material_t)
 }
 
-wf_error_t wf_mtl_parse_file(wf_mtl_parser_t* parser, const char* filename,
-                             wf_material_t** materials, size_t* material_count,
-                             size_t* material_cap) {
-  LOG_INFO("Starting MTL file parsing: %s", filename);
-
-  FILE* file = fopen(filename, "r");
-  if (!file) {
-    LOG_ERROR("Cannot open MTL file: [%s]", filename);
-    return WF_ERROR_FILE_NOT_FOUND;
-  }
-
+wf_error_t wf_mtl_parse_buffer(wf_mtl_parser_t* parser, const char* data,
+                               size_t size, wf_material_t** materials,
+                               size_t* material_count, size_t* material_cap) {
+  wf_arena_t*    arena = parser->arena;
   wf_material_t* mats  = *materials;
   size_t         count = *material_count;
   size_t         cap   = *material_cap;
+  size_t         first = count;
   // wf_material_t current_mat = {0};
   // current_mat.Kd = (wf_vec3){0.6f, 0.6f, 0.6f};
   // current_mat.illum = 2;
 
-  char   line[4096];
-  size_t line_num = 0;
+  // Lines are copied out because wf_trim and the property parser need a
+  // writable, NUL-terminated string; longer lines are truncated
+  char        line[4096];
+  const char* p   = data;
+  const char* end = data + size;
+
+  while (p < end) {
+    const char* eol = memchr(p, '\n', end - p);
+    if (!eol)
+      eol = end;
+    size_t len = eol - p;
+    if (len >= sizeof(line))
+      len = sizeof(line) - 1;
+    memcpy(line, p, len);
+    line[len] = '\0';
+    p         = eol + 1;
 
-  while (fgets(line, sizeof(line), file)) {
-    line_num++;
+    parser->line_number++;
     char* s = wf_trim(line);
     if (*s == '#' || *s == '\0')
       continue;
@@ -135,29 +145,65 @@ wf_error_t wf_mtl_parse_file(wf_mtl_parser_t* parser, const char* filename,
     // Handle newmtl: finalize previous material and start new one
     if (strncmp(s, "newmtl", 6) == 0
         && (s[6] == ' ' || s[6] == '\t' || !s[6])) {
-      mats = wf_realloc_array(mats, &cap, ++count, sizeof(wf_material_t));
-      if (!mats)
+      wf_material_t* grown = wf_arena_realloc_array(arena, mats, &cap,
+                                                    count + 1,
+                                                    sizeof(wf_material_t));
+      if (!grown)
         goto oom;
+      mats = grown;
+      count++;
       // Initialize new material
       memset(&mats[count - 1], 0, sizeof(wf_material_t));
       SET_MATERIAL_STRING(&mats[count - 1], name, wf_trim(s + 6));
       mats[count - 1].Kd    = (wf_vec3){ 0.6f, 0.6f, 0.6f };
       mats[count - 1].illum = 2;
+      if (parser->index && mats[count - 1].name
+          && wf_name_index_insert(parser->index, mats[count - 1].name,
+                                  count - 1) != 0)
+        goto oom;
       continue;
     }
 
     // Parse property into current material
-    parse_material_property(&mats[count - 1], s);
+    if (count > first)
+      parse_material_property(arena, &mats[count - 1], s);
   }
 
-  fclose(file);
   *materials      = mats;
   *material_count = count;
-  LOG_INFO("Successfully parsed MTL file: %s (%zu materials)", filename, count);
+  *material_cap   = cap;
   return WF_SUCCESS;
 
 oom:
-  fclose(file);
-  LOG_ERROR("MTL parsing failed at line %zu: Out of memory", line_num);
+  // Hand back what was parsed so the caller still owns every material
+  *materials      = mats;
+  *material_count = count;
+  *material_cap   = cap;
+  LOG_ERROR("MTL parsing failed at line %zu: Out of memory",
+            parser->line_number);
   return WF_ERROR_OUT_OF_MEMORY;
 }
+
+wf_error_t wf_mtl_parse_file(wf_mtl_parser_t* parser, const char* filename,
+                             wf_material_t** materials, size_t* material_count,
+                             size_t* material_cap) {
+  LOG_INFO("Starting MTL file parsing: %s", filename);
+
+  wf_io_buffer_t buffer;
+  wf_error_t     result = wf_io_load(parser->io, filename, &buffer);
+  if (result == WF_ERROR_FILE_NOT_FOUND) {
+    LOG_ERROR("Cannot open MTL file: [%s]", filename);
+    return result;
+  }
+  if (result != WF_SUCCESS)
+    return result;
+
+  result = wf_mtl_parse_buffer(parser, buffer.data, buffer.size, materials,
+                               material_count, material_cap);
+  wf_io_release(&buffer);
+  if (result == WF_SUCCESS) {
+    LOG_INFO("Successfully parsed MTL file: %s (%zu materials)", filename,
+             *material_count);
+  }
+  return result;
+}
@@ -3,6 +3,7 @@
 #define MTL_PARSER_H
 
 #include <stdio.h>
+#include "arena.h"
 #include "wavefront.h"
 
 #ifdef __cplusplus
@@ -10,10 +11,19 @@ extern "C" {
 #endif
 
 typedef struct {
-  FILE*  file;
-  size_t line_number;
-  char*  mtl_dir;
+  FILE*          file;
+  size_t         line_number;
+  char*          mtl_dir;
+  wf_arena_t*    arena; /**< Owner of the materials, NULL for the heap */
+  const wf_io_t* io;    /**< Source of MTL files, NULL for the file system */
+  struct wf_name_index_s* index; /**< Receives each newmtl name with its
+                                      material index, may be NULL */
 } wf_mtl_parser_t;
+
+// Parse MTL data already in memory; data need not be NUL-terminated
+wf_error_t wf_mtl_parse_buffer(wf_mtl_parser_t* parser, const char* data,
+                               size_t size, wf_material_t** materials,
+                               size_t* material_count, size_t* material_cap);
 wf_error_t wf_mtl_parse_file(wf_mtl_parser_t* parser, const char* filename,
                              wf_material_t** materials, size_t* material_count,
                              size_t* material_cap);
@@ -0,0 +1,190 @@
+// src/name_index.c
+#include "name_index.h"
+#include <string.h>
+#include "lib.h"
+
+#define WF_NAME_INDEX_MIN_SLOTS 16
+
+typedef struct {
+  const char* name; /**< NULL for an empty slot */
+  uint64_t    hash;
+  uintptr_t   value;
+} wf_name_slot_t;
+
+// Open addressing with linear probing, load factor at most 1/2
+struct wf_name_index_s {
+  wf_arena_t*     arena;
+  wf_name_slot_t* slots;
+  size_t          mask;
+  size_t          count;
+};
+
+static wf_name_slot_t* wf_name_index_alloc(wf_arena_t* arena, size_t slots) {
+  return wf_arena_calloc(arena, slots, sizeof(wf_name_slot_t));
+}
+
+wf_name_index_t* wf_name_index_create(wf_arena_t* arena, size_t count) {
+  size_t slots = WF_NAME_INDEX_MIN_SLOTS;
+  while (slots < count * 2)
+    slots *= 2;
+
+  wf_name_index_t* index = wf_arena_alloc(arena, sizeof(wf_name_index_t));
+  if (!index)
+    return NULL;
+  index->arena = arena;
+  index->slots = wf_name_index_alloc(arena, slots);
+  index->mask  = slots - 1;
+  index->count = 0;
+  if (!index->slots) {
+    wf_arena_free(arena, index);
+    return NULL;
+  }
+  return index;
+}
+
+void wf_name_index_destroy(wf_name_index_t* index) {
+  if (!index)
+    return;
+  wf_arena_free(index->arena, index->slots);
+  wf_arena_free(index->arena, index);
+}
+
+static int wf_name_index_grow(wf_name_index_t* index) {
+  size_t          count = (index->mask + 1) * 2;
+  wf_name_slot_t* slots = wf_name_index_alloc(index->arena, count);
+  if (!slots)
+    return -1;
+
+  for (size_t i = 0; i <= index->mask; i++) {
+    const wf_name_slot_t* old = &index->slots[i];
+    if (!old->name)
+      continue;
+    size_t s = old->hash & (count - 1);
+    while (slots[s].name)
+      s = (s + 1) & (count - 1);
+    slots[s] = *old;
+  }
+  wf_arena_free(index->arena, index->slots);
+  index->slots = slots;
+  index->mask  = count - 1;
+  return 0;
+}
+
+// Slot holding the length bytes at name, or the empty slot where they
+// would go
+static wf_name_slot_t* wf_name_index_probe(const wf_name_index_t* index,
+                                           const char* name, size_t length,
+                                           uint64_t hash) {
+  size_t s = hash & index->mask;
+  for (; index->slots[s].name; s = (s + 1) & index->mask) {
+    const wf_name_slot_t* slot = &index->slots[s];
+    if (slot->hash == hash && strncmp(slot->name, name, length) == 0
+        && slot->name[length] == '\0')
+      break;
+  }
+  return &index->slots[s];
+}
+
+int wf_name_index_insert(wf_name_index_t* index, const char* name,
+                         uintptr_t value) {
+  size_t          length = strlen(name);
+  uint64_t        hash   = wf_hash_bytes(name, length);
+  wf_name_slot_t* slot   = wf_name_index_probe(index, name, length, hash);
+  if (slot->name)
+    return 0;
+
+  if ((index->count + 1) * 2 > index->mask + 1) {
+    if (wf_name_index_grow(index) != 0)
+      return -1;
+    slot = wf_name_index_probe(index, name, length, hash);
+  }
+  slot->name  = name;
+  slot->hash  = hash;
+  slot->value = value;
+  index->count++;
+  return 0;
+}
+
+int wf_name_index_find(const wf_name_index_t* index, const char* name,
+                       size_t length, uintptr_t* value) {
+  uint64_t              hash = wf_hash_bytes(name, length);
+  const wf_name_slot_t* slot = wf_name_index_probe(index, name, length, hash);
+  if (!slot->name)
+    return -1;
+  *value = slot->value;
+  return 0;
+}
+
+wf_error_t wf_scene_index_objects(wf_scene_t* scene) {
+  size_t count = 0;
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next)
+    count++;
+
+  wf_name_index_destroy(scene->object_index);
+  scene->object_index = wf_name_index_create(scene->arena, count);
+  if (!scene->object_index)
+    return WF_ERROR_OUT_OF_MEMORY;
+  for (wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    if (obj->name
+        && wf_name_index_insert(scene->object_index, obj->name,
+                                (uintptr_t)obj) != 0) {
+      wf_name_index_destroy(scene->object_index);
+      scene->object_index = NULL;
+      return WF_ERROR_OUT_OF_MEMORY;
+    }
+  }
+  return WF_SUCCESS;
+}
+
+wf_object_t* wf_scene_find_object(const wf_scene_t* scene, const char* name) {
+  if (!scene || !name)
+    return NULL;
+
+  if (scene->object_index) {
+    uintptr_t value;
+    if (wf_name_index_find(scene->object_index, name, strlen(name), &value)
+        != 0)
+      return NULL;
+    return (wf_object_t*)value;
+  }
+  for (wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    if (obj->name && strcmp(obj->name, name) == 0)
+      return obj;
+  }
+  return NULL;
+}
+
+wf_error_t wf_scene_index_materials(wf_scene_t* scene) {
+  wf_name_index_destroy(scene->material_index);
+  scene->material_index =
+      wf_name_index_create(scene->arena, scene->material_count);
+  if (!scene->material_index)
+    return WF_ERROR_OUT_OF_MEMORY;
+  for (size_t i = 0; i < scene->material_count; i++) {
+    const char* name = scene->materials[i].name;
+    if (name && wf_name_index_insert(scene->material_index, name, i) != 0) {
+      wf_name_index_destroy(scene->material_index);
+      scene->material_index = NULL;
+      return WF_ERROR_OUT_OF_MEMORY;
+    }
+  }
+  return WF_SUCCESS;
+}
+
+size_t wf_scene_find_material(const wf_scene_t* scene, const char* name) {
+  if (!scene || !name)
+    return (size_t)-1;
+
+  if (scene->material_index) {
+    uintptr_t value;
+    if (wf_name_index_find(scene->material_index, name, strlen(name), &value)
+        != 0)
+      return (size_t)-1;
+    return (size_t)value;
+  }
+  for (size_t i = 0; i < scene->material_count; i++) {
+    if (scene->materials[i].name && strcmp(scene->materials[i].name, name) == 0)
+      return i;
+  }
+  return (size_t)-1;
+}
@@ -0,0 +1,43 @@
+// src/name_index.h
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "wavefront.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hash table from names to values (object pointers, material indices).
+// Names are not copied and must outlive the index. The first value inserted
+// for a name wins.
+typedef struct wf_name_index_s wf_name_index_t;
+
+// Create an index sized for count names; allocates from arena, which may be
+// NULL for the heap
+wf_name_index_t* wf_name_index_create(wf_arena_t* arena, size_t count);
+void             wf_name_index_destroy(wf_name_index_t* index);
+
+// Returns 0 on success, -1 when out of memory
+int wf_name_index_insert(wf_name_index_t* index, const char* name,
+                         uintptr_t value);
+
+// Look up the length bytes at name, which need not be NUL-terminated.
+// Returns 0 and sets *value when the name is present, -1 otherwise.
+int wf_name_index_find(const wf_name_index_t* index, const char* name,
+                       size_t length, uintptr_t* value);
+
+// Build scene->object_index over every named object and
+// scene->material_index over every material. Return WF_SUCCESS or
+// WF_ERROR_OUT_OF_MEMORY.
+wf_error_t wf_scene_index_objects(wf_scene_t* scene);
+wf_error_t wf_scene_index_materials(wf_scene_t* scene);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NAME_INDEX_H
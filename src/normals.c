@@ -0,0 +1,324 @@
+// src/normals.c
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "log.h"
+#include "thread_pool.h"
+#include "wavefront.h"
+
+// Faces or vertices per task; smaller scenes run on the calling thread
+#define WF_NORMALS_MIN_TASK (16 * 1024)
+
+// Corner c is corner c % 3 of face c / 3 in scene order
+typedef struct {
+  size_t   corner;
+  unsigned group;
+} wf_normals_corner_t;
+
+typedef struct {
+  wf_scene_t*          scene;
+  wf_face**            faces;
+  size_t               face_count;
+  wf_normal_weight_t   weighting;
+  wf_vec3*             weighted; /**< Contribution of each corner, zero
+                                      for corners of invalid faces */
+  size_t*              offsets;  /**< Smooth corners of vertex v are
+                                      corners[offsets[v]..offsets[v + 1]) */
+  wf_normals_corner_t* corners;
+  size_t*              first;    /**< Per vertex: normal count, then index
+                                      of its first normal */
+  wf_vec3*             normals;
+  wf_thread_pool_t*    pool;
+  size_t               threads;
+} wf_normals_job_t;
+
+typedef void (*wf_normals_pass_t)(wf_normals_job_t* job, size_t begin,
+                                  size_t end);
+
+typedef struct {
+  wf_normals_job_t* job;
+  wf_normals_pass_t pass;
+  size_t            begin;
+  size_t            end;
+} wf_normals_task_t;
+
+static wf_vec3 wf_vec3_sub(wf_vec3 a, wf_vec3 b) {
+  return (wf_vec3){ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static wf_vec3 wf_vec3_cross(wf_vec3 a, wf_vec3 b) {
+  return (wf_vec3){ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+                    a.x * b.y - a.y * b.x };
+}
+
+static float wf_vec3_length(wf_vec3 a) {
+  return sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+}
+
+static wf_vec3 wf_vec3_normalize(wf_vec3 a) {
+  float length = wf_vec3_length(a);
+  if (length > 0.0f) {
+    a.x /= length;
+    a.y /= length;
+    a.z /= length;
+  }
+  return a;
+}
+
+static int wf_normals_face_valid(const wf_scene_t* scene, const wf_face* face) {
+  for (int j = 0; j < 3; j++) {
+    int v = face->vertices[j].v_idx;
+    if (v < 0 || (size_t)v >= scene->vertex_count)
+      return 0;
+  }
+  return 1;
+}
+
+static int wf_normals_smooth(const wf_normals_job_t* job, size_t face) {
+  return job->faces[face]->smoothing_group != 0
+      && wf_normals_face_valid(job->scene, job->faces[face]);
+}
+
+static void wf_normals_task(void* arg) {
+  wf_normals_task_t* task = arg;
+  task->pass(task->job, task->begin, task->end);
+}
+
+// Run pass over [0, count) split across the pool, or on this thread when
+// the range is small or no task can be queued
+static void wf_normals_run(wf_normals_job_t* job, wf_normals_pass_t pass,
+                           size_t count) {
+  size_t             parts = job->pool ? job->threads * 4 : 1;
+  size_t             per   = (count + parts - 1) / parts;
+  wf_normals_task_t* tasks = NULL;
+  if (job->pool && per >= WF_NORMALS_MIN_TASK)
+    tasks = malloc(parts * sizeof(wf_normals_task_t));
+  if (!tasks) {
+    pass(job, 0, count);
+    return;
+  }
+
+  size_t n = 0;
+  for (size_t begin = 0; begin < count; begin += per, n++) {
+    size_t end = count - begin < per ? count : begin + per;
+    tasks[n]   = (wf_normals_task_t){ job, pass, begin, end };
+    if (wf_thread_pool_submit(job->pool, wf_normals_task, &tasks[n]) != 0)
+      pass(job, begin, end);
+  }
+  wf_thread_pool_wait(job->pool);
+  free(tasks);
+}
+
+// Weighted face normal at each corner
+static void wf_normals_weigh(wf_normals_job_t* job, size_t begin,
+                             size_t end) {
+  for (size_t f = begin; f < end; f++) {
+    const wf_face* face = job->faces[f];
+    wf_vec3*       out  = &job->weighted[3 * f];
+    if (!wf_normals_face_valid(job->scene, face)) {
+      memset(out, 0, 3 * sizeof(wf_vec3));
+      continue;
+    }
+
+    wf_vec3 p[3];
+    for (int j = 0; j < 3; j++)
+      p[j] = wf_scene_vertex(job->scene, face->vertices[j].v_idx);
+    // Twice the triangle area in length
+    wf_vec3 n = wf_vec3_cross(wf_vec3_sub(p[1], p[0]),
+                              wf_vec3_sub(p[2], p[0]));
+    if (job->weighting != WF_NORMAL_WEIGHT_ANGLE) {
+      out[0] = out[1] = out[2] = n;
+      continue;
+    }
+
+    n = wf_vec3_normalize(n);
+    for (int j = 0; j < 3; j++) {
+      wf_vec3 a   = wf_vec3_normalize(wf_vec3_sub(p[(j + 1) % 3], p[j]));
+      wf_vec3 b   = wf_vec3_normalize(wf_vec3_sub(p[(j + 2) % 3], p[j]));
+      float   cos = a.x * b.x + a.y * b.y + a.z * b.z;
+      float   w   = acosf(cos < -1.0f ? -1.0f : cos > 1.0f ? 1.0f : cos);
+      out[j]      = (wf_vec3){ n.x * w, n.y * w, n.z * w };
+    }
+  }
+}
+
+// Order corners by smoothing group, then by corner, so that every group of
+// a vertex is one run
+static int wf_normals_compare(const void* a, const void* b) {
+  const wf_normals_corner_t* ca = a;
+  const wf_normals_corner_t* cb = b;
+  if (ca->group != cb->group)
+    return ca->group < cb->group ? -1 : 1;
+  return ca->corner < cb->corner ? -1 : ca->corner > cb->corner;
+}
+
+// Number of smoothing groups meeting at each vertex. Most vertices have a
+// single group and need no sorting.
+static void wf_normals_count(wf_normals_job_t* job, size_t begin,
+                             size_t end) {
+  for (size_t v = begin; v < end; v++) {
+    wf_normals_corner_t* c     = job->corners + job->offsets[v];
+    size_t               n     = job->offsets[v + 1] - job->offsets[v];
+    size_t               count = n > 0;
+    for (size_t i = 1; i < n; i++) {
+      if (c[i].group != c[0].group) {
+        qsort(c, n, sizeof(wf_normals_corner_t), wf_normals_compare);
+        count = 1;
+        for (size_t k = 1; k < n; k++)
+          count += c[k].group != c[k - 1].group;
+        break;
+      }
+    }
+    job->first[v] = count;
+  }
+}
+
+// Average each group's corners into one normal
+static void wf_normals_smooth_vertices(wf_normals_job_t* job, size_t begin,
+                                       size_t end) {
+  for (size_t v = begin; v < end; v++) {
+    const wf_normals_corner_t* c     = job->corners + job->offsets[v];
+    size_t                     n     = job->offsets[v + 1] - job->offsets[v];
+    size_t                     index = job->first[v];
+    for (size_t i = 0; i < n;) {
+      wf_vec3 sum = { 0 };
+      size_t  run = i;
+      for (; run < n && c[run].group == c[i].group; run++) {
+        sum.x += job->weighted[c[run].corner].x;
+        sum.y += job->weighted[c[run].corner].y;
+        sum.z += job->weighted[c[run].corner].z;
+      }
+      job->normals[index] = wf_vec3_normalize(sum);
+      for (; i < run; i++) {
+        size_t corner = c[i].corner;
+        job->faces[corner / 3]->vertices[corner % 3].vn_idx = (int)index;
+      }
+      index++;
+    }
+  }
+}
+
+wf_error_t wf_scene_generate_normals(wf_scene_t*                scene,
+                                     const wf_normal_options_t* options) {
+  if (!scene) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  wf_normal_options_t opts = { 0 };
+  if (options)
+    opts = *options;
+
+  wf_normals_job_t job = { .scene = scene, .weighting = opts.weighting };
+  for (wf_object_t* obj = scene->objects; obj; obj = obj->next)
+    job.face_count += obj->face_count;
+  if (3 * job.face_count > INT_MAX)
+    return WF_ERROR_UNSUPPORTED_FEATURE;
+
+  size_t     corner_count = 3 * job.face_count;
+  size_t     alignment    = scene->soa.alignment;
+  wf_error_t result       = WF_ERROR_OUT_OF_MEMORY;
+  job.faces    = malloc((job.face_count + 1) * sizeof(wf_face*));
+  job.weighted = malloc((corner_count + 1) * sizeof(wf_vec3));
+  job.offsets  = calloc(scene->vertex_count + 1, sizeof(size_t));
+  job.corners  = malloc((corner_count + 1) * sizeof(wf_normals_corner_t));
+  job.first    = malloc((scene->vertex_count + 1) * sizeof(size_t));
+  if (!job.faces || !job.weighted || !job.offsets || !job.corners
+      || !job.first)
+    goto done;
+
+  size_t f = 0;
+  for (wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    for (size_t i = 0; i < obj->face_count; i++)
+      job.faces[f++] = &obj->faces[i];
+  }
+
+  job.threads = opts.num_threads ? opts.num_threads : wf_cpu_count();
+  if (job.threads > 1 && job.face_count >= 2 * WF_NORMALS_MIN_TASK)
+    job.pool = wf_thread_pool_create(job.threads);
+  wf_normals_run(&job, wf_normals_weigh, job.face_count);
+
+  // Counting sort of smooth corners by position
+  for (f = 0; f < job.face_count; f++) {
+    if (wf_normals_smooth(&job, f)) {
+      for (int j = 0; j < 3; j++)
+        job.offsets[job.faces[f]->vertices[j].v_idx + 1]++;
+    }
+  }
+  for (size_t v = 0; v < scene->vertex_count; v++)
+    job.offsets[v + 1] += job.offsets[v];
+  memcpy(job.first, job.offsets, scene->vertex_count * sizeof(size_t));
+  for (f = 0; f < job.face_count; f++) {
+    if (wf_normals_smooth(&job, f)) {
+      for (int j = 0; j < 3; j++) {
+        size_t slot       = job.first[job.faces[f]->vertices[j].v_idx]++;
+        job.corners[slot] = (wf_normals_corner_t){
+          3 * f + j, job.faces[f]->smoothing_group
+        };
+      }
+    }
+  }
+
+  wf_normals_run(&job, wf_normals_count, scene->vertex_count);
+
+  // Smooth normals by vertex, then one per flat face
+  size_t normal_count = 0;
+  for (size_t v = 0; v < scene->vertex_count; v++) {
+    size_t count = job.first[v];
+    job.first[v] = normal_count;
+    normal_count += count;
+  }
+  size_t smooth_count = normal_count;
+  for (f = 0; f < job.face_count; f++) {
+    const wf_face* face = job.faces[f];
+    normal_count += face->smoothing_group == 0
+                 && wf_normals_face_valid(scene, face);
+  }
+
+  job.normals = wf_arena_alloc(scene->arena, (normal_count ? normal_count : 1)
+                                                 * sizeof(wf_vec3));
+  if (!job.normals)
+    goto done;
+
+  // From here on the scene changes; its normals are swapped in as wf_vec3
+  result = wf_scene_convert_to_aos(scene);
+  if (result != WF_SUCCESS)
+    goto done;
+  wf_normals_run(&job, wf_normals_smooth_vertices, scene->vertex_count);
+
+  size_t index = smooth_count;
+  for (f = 0; f < job.face_count; f++) {
+    wf_face* face = job.faces[f];
+    if (!wf_normals_face_valid(scene, face)) {
+      for (int j = 0; j < 3; j++)
+        face->vertices[j].vn_idx = -1;
+    } else if (face->smoothing_group == 0) {
+      job.normals[index] = wf_vec3_normalize(job.weighted[3 * f]);
+      for (int j = 0; j < 3; j++)
+        face->vertices[j].vn_idx = (int)index;
+      index++;
+    }
+  }
+
+  wf_arena_free(scene->arena, scene->normals);
+  scene->normals      = job.normals;
+  scene->normal_count = normal_count;
+  scene->normal_cap   = normal_count;
+  job.normals         = NULL;
+  // Restore the layout the scene had
+  if (alignment)
+    result = wf_scene_convert_to_soa(scene, alignment);
+  LOG_DEBUG("Generated %zu normals (%zu smooth) for %zu faces", normal_count,
+            smooth_count, job.face_count);
+
+done:
+  if (job.pool)
+    wf_thread_pool_destroy(job.pool);
+  wf_arena_free(scene->arena, job.normals);
+  free(job.faces);
+  free(job.weighted);
+  free(job.offsets);
+  free(job.corners);
+  free(job.first);
+  return result;
+}
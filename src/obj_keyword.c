@@ -0,0 +1,133 @@
+// src/obj_keyword.c
+#include "obj_keyword.h"
+#include <string.h>
+
+const wf_obj_keyword_info_t WF_OBJ_KEYWORDS[WF_KW_COUNT] = {
+  [WF_KW_NONE]   = { "",       0 },
+  [WF_KW_V]      = { "v",      1 },
+  [WF_KW_VT]     = { "vt",     2 },
+  [WF_KW_VN]     = { "vn",     2 },
+  [WF_KW_VP]     = { "vp",     2 },
+  [WF_KW_F]      = { "f",      1 },
+  [WF_KW_O]      = { "o",      1 },
+  [WF_KW_G]      = { "g",      1 },
+  [WF_KW_S]      = { "s",      1 },
+  [WF_KW_L]      = { "l",      1 },
+  [WF_KW_USEMTL] = { "usemtl", 6 },
+  [WF_KW_MTLLIB] = { "mtllib", 6 },
+  [WF_KW_CSTYPE] = { "cstype", 6 },
+  [WF_KW_DEG]    = { "deg",    3 },
+  [WF_KW_BMAT]   = { "bmat",   4 },
+  [WF_KW_STEP]   = { "step",   4 },
+  [WF_KW_CURV]   = { "curv",   4 },
+  [WF_KW_CURV2]  = { "curv2",  5 },
+  [WF_KW_SURF]   = { "surf",   4 },
+  [WF_KW_PARM]   = { "parm",   4 },
+  [WF_KW_TRIM]   = { "trim",   4 },
+  [WF_KW_HOLE]   = { "hole",   4 },
+  [WF_KW_SCRV]   = { "scrv",   4 },
+  [WF_KW_SP]     = { "sp",     2 },
+  [WF_KW_END]    = { "end",    3 },
+  [WF_KW_TEX]    = { "tex",    3 },
+};
+
+// Accept the candidate picked from the leading bytes only if the line spells
+// it out and it ends at whitespace or the end of the line
+static wf_obj_keyword_t wf_obj_expect(const char* line, size_t line_len,
+                                      wf_obj_keyword_t kw) {
+  size_t len = WF_OBJ_KEYWORDS[kw].length;
+  if (len > line_len || memcmp(line, WF_OBJ_KEYWORDS[kw].name, len) != 0)
+    return WF_KW_NONE;
+  if (len < line_len && line[len] != ' ' && line[len] != '\t')
+    return WF_KW_NONE;
+  return kw;
+}
+
+wf_obj_keyword_t wf_obj_keyword(const char* line, size_t line_len) {
+  // The first two bytes identify every keyword, the rest is only verified
+  char             second = line_len > 1 ? line[1] : '\0';
+  wf_obj_keyword_t kw;
+
+  switch (line[0]) {
+  case 'v':
+    switch (second) {
+    case 't':
+      kw = WF_KW_VT;
+      break;
+    case 'n':
+      kw = WF_KW_VN;
+      break;
+    case 'p':
+      kw = WF_KW_VP;
+      break;
+    default:
+      kw = WF_KW_V;
+      break;
+    }
+    break;
+  case 'f':
+    kw = WF_KW_F;
+    break;
+  case 'o':
+    kw = WF_KW_O;
+    break;
+  case 'g':
+    kw = WF_KW_G;
+    break;
+  case 'l':
+    kw = WF_KW_L;
+    break;
+  case 's':
+    switch (second) {
+    case 'p':
+      kw = WF_KW_SP;
+      break;
+    case 'c':
+      kw = WF_KW_SCRV;
+      break;
+    case 'u':
+      kw = WF_KW_SURF;
+      break;
+    case 't':
+      kw = WF_KW_STEP;
+      break;
+    default:
+      kw = WF_KW_S;
+      break;
+    }
+    break;
+  case 'u':
+    kw = WF_KW_USEMTL;
+    break;
+  case 'm':
+    kw = WF_KW_MTLLIB;
+    break;
+  case 'c':
+    if (second == 's')
+      kw = WF_KW_CSTYPE;
+    else
+      kw = line_len > 4 && line[4] == '2' ? WF_KW_CURV2 : WF_KW_CURV;
+    break;
+  case 'd':
+    kw = WF_KW_DEG;
+    break;
+  case 'b':
+    kw = WF_KW_BMAT;
+    break;
+  case 'p':
+    kw = WF_KW_PARM;
+    break;
+  case 't':
+    kw = second == 'r' ? WF_KW_TRIM : WF_KW_TEX;
+    break;
+  case 'h':
+    kw = WF_KW_HOLE;
+    break;
+  case 'e':
+    kw = WF_KW_END;
+    break;
+  default:
+    return WF_KW_NONE;
+  }
+  return wf_obj_expect(line, line_len, kw);
+}
@@ -0,0 +1,58 @@
+// src/obj_keyword.h
+#ifndef OBJ_KEYWORD_H
+#define OBJ_KEYWORD_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// OBJ statements the parser recognizes
+typedef enum {
+  WF_KW_NONE = 0,
+  WF_KW_V,
+  WF_KW_VT,
+  WF_KW_VN,
+  WF_KW_VP,
+  WF_KW_F,
+  WF_KW_O,
+  WF_KW_G,
+  WF_KW_S,
+  WF_KW_L,
+  WF_KW_USEMTL,
+  WF_KW_MTLLIB,
+  WF_KW_CSTYPE,
+  WF_KW_DEG,
+  WF_KW_BMAT,
+  WF_KW_STEP,
+  WF_KW_CURV,
+  WF_KW_CURV2,
+  WF_KW_SURF,
+  WF_KW_PARM,
+  WF_KW_TRIM,
+  WF_KW_HOLE,
+  WF_KW_SCRV,
+  WF_KW_SP,
+  WF_KW_END,
+  WF_KW_TEX,
+  WF_KW_COUNT
+} wf_obj_keyword_t;
+
+typedef struct {
+  const char* name;
+  size_t      length;
+} wf_obj_keyword_info_t;
+
+// Spelling of every keyword, indexed by wf_obj_keyword_t
+extern const wf_obj_keyword_info_t WF_OBJ_KEYWORDS[WF_KW_COUNT];
+
+// Keyword a trimmed, non-empty line starts with. The keyword must be the
+// whole first token, so "vx 1 2 3" is WF_KW_NONE rather than a vertex.
+wf_obj_keyword_t wf_obj_keyword(const char* line, size_t line_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OBJ_KEYWORD_H
@@ -1,40 +1,58 @@
 // src/obj_parser.c
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE // asprintf, vasprintf
+#endif
 #include "obj_parser.h"
 #include <ctype.h>
+#include <limits.h>
 #include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
+#include "bounds.h"
+#include "file_io.h"
 #include "lib.h"
-#include "log4c.h"
+#include "log.h"
+#include "mtl_cache.h"
 #include "mtl_parser.h"
-
-static const wf_command_t WF_COMMANDS[] = {
-  // Longest commands first (to avoid prefix conflicts like "v" vs "vp")
-  { "usemtl", 6, wf_handle_usemtl    },
-  { "mtllib", 6, wf_handle_mtllib    },
-  { "cstype", 6, wf_handle_freeform  },
-  { "parm",   4, wf_handle_freeform  },
-  { "trim",   4, wf_handle_freeform  },
-  { "hole",   4, wf_handle_freeform  },
-  { "scrv",   4, wf_handle_freeform  },
-  { "surf",   4, wf_handle_freeform  },
-  { "curv",   4, wf_handle_freeform  },
-  { "bmat",   4, wf_handle_freeform  },
-  { "step",   4, wf_handle_freeform  },
-  { "deg",    3, wf_handle_freeform  },
-  { "end",    3, wf_handle_freeform  },
-  { "tex",    3, wf_handle_freeform  },
-  { "vp",     2, wf_handle_parameter },
-  { "vt",     2, wf_handle_texcoord  },
-  { "vn",     2, wf_handle_normal    },
-  { "sp",     2, wf_handle_freeform  },
-  { "f",      1, wf_handle_face      },
-  { "o",      1, wf_handle_object    },
-  { "g",      1, wf_handle_group     },
-  { "s",      1, wf_handle_smoothing },
-  { "l",      1, wf_handle_line_elem },
-  { "v",      1, wf_handle_vertex    },
-  { NULL,     0, NULL                }
+#include "name_index.h"
+#include "obj_keyword.h"
+#include "thread_pool.h"
+
+// Smallest chunk handed to a worker when parsing in parallel
+#ifndef WF_OBJ_MIN_CHUNK_SIZE
+#  define WF_OBJ_MIN_CHUNK_SIZE (64 * 1024)
+#endif
+
+// Handler of each keyword, see obj_keyword.c for the dispatch itself
+static const wf_line_handler_t WF_HANDLERS[WF_KW_COUNT] = {
+  [WF_KW_V]      = wf_handle_vertex,
+  [WF_KW_VT]     = wf_handle_texcoord,
+  [WF_KW_VN]     = wf_handle_normal,
+  [WF_KW_VP]     = wf_handle_parameter,
+  [WF_KW_F]      = wf_handle_face,
+  [WF_KW_O]      = wf_handle_object,
+  [WF_KW_G]      = wf_handle_group,
+  [WF_KW_S]      = wf_handle_smoothing,
+  [WF_KW_L]      = wf_handle_line_elem,
+  [WF_KW_USEMTL] = wf_handle_usemtl,
+  [WF_KW_MTLLIB] = wf_handle_mtllib,
+  [WF_KW_CSTYPE] = wf_handle_freeform,
+  [WF_KW_DEG]    = wf_handle_freeform,
+  [WF_KW_BMAT]   = wf_handle_freeform,
+  [WF_KW_STEP]   = wf_handle_freeform,
+  [WF_KW_CURV]   = wf_handle_freeform,
+  [WF_KW_CURV2]  = wf_handle_freeform,
+  [WF_KW_SURF]   = wf_handle_freeform,
+  [WF_KW_PARM]   = wf_handle_freeform,
+  [WF_KW_TRIM]   = wf_handle_freeform,
+  [WF_KW_HOLE]   = wf_handle_freeform,
+  [WF_KW_SCRV]   = wf_handle_freeform,
+  [WF_KW_SP]     = wf_handle_freeform,
+  [WF_KW_END]    = wf_handle_freeform,
+  [WF_KW_TEX]    = wf_handle_freeform,
 };
 
 // Error handling
@@ -73,146 +91,135 @@ static int resolve_index(int idx, size_t count, int preserve_1_based) {
   }
 }
 
-// Face index parsing helper
-static wf_error_t wf_parse_face_index_helper(const char*      token,
-                                             wf_vertex_index* idx,
-                                             size_t v_count, size_t vt_count,
-                                             size_t vn_count,
-                                             int    preserve_1_based) {
-  *idx = (wf_vertex_index){ -1, -1, -1 };
-
-  if (!token || !token[0]) {
-    return WF_SUCCESS;
+// Parse one index field [p, end) as a decimal integer. Returns 0 unless the
+// whole field is a number.
+static int wf_parse_index_field(const char* p, const char* end, int* value) {
+  int negative = 0;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
   }
-
-  char* token_copy = wf_strdup(token);
-  if (!token_copy) {
-    return WF_ERROR_OUT_OF_MEMORY;
+  if (p == end)
+    return 0;
+
+  long long v = 0;
+  for (; p < end; p++) {
+    unsigned digit = (unsigned)(*p - '0');
+    if (digit > 9)
+      return 0;
+    if (v <= INT_MAX)
+      v = v * 10 + digit;
   }
+  if (v > INT_MAX)
+    v = INT_MAX;
+  *value = (int)(negative ? -v : v);
+  return 1;
+}
 
-  char* v_str  = token_copy;
-  char* vt_str = NULL;
-  char* vn_str = NULL;
+// Parse a v, v/vt, v//vn or v/vt/vn token [token, end) in place
+static void wf_parse_face_index(const wf_obj_parser_t* parser,
+                                const char* token, const char* end,
+                                wf_vertex_index* idx) {
+  int preserve = parser->options->preserve_indices;
+  int value;
 
-  char* slash1 = strchr(v_str, '/');
-  if (slash1) {
-    *slash1      = '\0';
-    vt_str       = slash1 + 1;
-    char* slash2 = strchr(vt_str, '/');
-    if (slash2) {
-      *slash2 = '\0';
-      vn_str  = slash2 + 1;
-    } else {
-      vn_str = vt_str;
-      vt_str = NULL;
-    }
-  }
+  *idx = (wf_vertex_index){ -1, -1, -1 };
 
-  if (v_str[0]) {
-    char* endptr;
-    long  v_idx = strtol(v_str, &endptr, 10);
-    if (endptr != v_str && *endptr == '\0') {
-      idx->v_idx = resolve_index((int)v_idx, v_count, preserve_1_based);
-    }
+  const char* slash1 = memchr(token, '/', end - token);
+  const char* v_end  = slash1 ? slash1 : end;
+  if (wf_parse_index_field(token, v_end, &value)) {
+    idx->v_idx = resolve_index(
+        value, parser->vertex_base + parser->scene->vertex_count, preserve);
   }
-
-  if (vt_str && vt_str[0]) {
-    char* endptr;
-    long  vt_idx = strtol(vt_str, &endptr, 10);
-    if (endptr != vt_str && *endptr == '\0') {
-      idx->vt_idx = resolve_index((int)vt_idx, vt_count, preserve_1_based);
-    }
+  if (!slash1)
+    return;
+
+  const char* slash2 = memchr(slash1 + 1, '/', end - slash1 - 1);
+  const char* vt_end = slash2 ? slash2 : end;
+  if (wf_parse_index_field(slash1 + 1, vt_end, &value)) {
+    idx->vt_idx = resolve_index(
+        value, parser->texcoord_base + parser->scene->texcoord_count,
+        preserve);
   }
-
-  if (vn_str && vn_str[0]) {
-    char* endptr;
-    long  vn_idx = strtol(vn_str, &endptr, 10);
-    if (endptr != vn_str && *endptr == '\0') {
-      idx->vn_idx = resolve_index((int)vn_idx, vn_count, preserve_1_based);
-    }
+  if (slash2 && wf_parse_index_field(slash2 + 1, end, &value)) {
+    idx->vn_idx = resolve_index(
+        value, parser->normal_base + parser->scene->normal_count, preserve);
   }
-
-  free(token_copy);
-  return WF_SUCCESS;
-}
-
-// Polygon triangulation
-static wf_face* wf_triangulate_polygon(wf_vertex_index* poly, size_t poly_count,
-                                       size_t* tri_count) {
-  if (poly_count < 3) {
-    *tri_count = 0;
-    return NULL;
-  }
-  if (poly_count == 3) {
-    wf_face* face = malloc(sizeof(wf_face));
-    if (!face)
-      return NULL;
-    face->vertices[0] = poly[0];
-    face->vertices[1] = poly[1];
-    face->vertices[2] = poly[2];
-    *tri_count        = 1;
-    return face;
-  }
-
-  *tri_count    = poly_count - 2;
-  wf_face* tris = malloc(*tri_count * sizeof(wf_face));
-  if (!tris)
-    return NULL;
-
-  for (size_t i = 0; i < *tri_count; i++) {
-    tris[i].vertices[0] = poly[0];
-    tris[i].vertices[1] = poly[i + 1];
-    tris[i].vertices[2] = poly[i + 2];
-  }
-  return tris;
 }
 
 // Ensure current object exists
 static wf_error_t wf_ensure_current_object(wf_obj_parser_t* parser) {
   if (!parser->current_object) {
-    parser->current_object = calloc(1, sizeof(wf_object_t));
+    parser->current_object =
+        wf_arena_calloc(parser->scene->arena, 1, sizeof(wf_object_t));
     if (!parser->current_object) {
       wf_set_error_with_line(parser, "Out of memory while creating object");
       return WF_ERROR_OUT_OF_MEMORY;
     }
 
     if (parser->current_object_name) {
-      parser->current_object->name = wf_strdup(parser->current_object_name);
+      parser->current_object->name =
+          wf_arena_strdup(parser->scene->arena, parser->current_object_name);
+    } else {
+      parser->implicit_first_object = 1;
     }
 
+    wf_reserve_object_faces(parser, parser->current_object,
+                            parser->object_ordinal);
     wf_add_object_to_list(parser, parser->current_object);
+    if (parser->current_material != WF_MATERIAL_NONE) {
+      return wf_begin_material_run(parser, parser->current_object,
+                                   parser->current_material);
+    }
   }
   return WF_SUCCESS;
 }
 
+// Give a new object its counted face array up front. Failure is not fatal,
+// the array then grows on demand.
+static void wf_reserve_object_faces(wf_obj_parser_t* parser,
+                                    wf_object_t* obj, size_t ordinal) {
+  if (ordinal >= parser->object_faces_count
+      || !parser->object_faces[ordinal])
+    return;
+  obj->faces = wf_arena_alloc(parser->scene->arena,
+                              parser->object_faces[ordinal] * sizeof(wf_face));
+  if (obj->faces)
+    obj->face_cap = parser->object_faces[ordinal];
+}
+
 // Add object to scene list
 static wf_error_t wf_add_object_to_list(wf_obj_parser_t* parser,
                                         wf_object_t*     obj) {
-  if (!parser->scene->objects) {
+  if (!parser->scene->objects)
     parser->scene->objects = obj;
-  } else {
-    wf_object_t* last = parser->scene->objects;
-    while (last->next)
-      last = last->next;
-    last->next = obj;
-  }
+  else
+    parser->last_object->next = obj;
+  parser->last_object = obj;
   return WF_SUCCESS;
 }
 
 // Generic vertex data parser
 static wf_error_t wf_parse_vertex_data(wf_obj_parser_t* parser,
-                                       const char* line, wf_vec3* vertex,
-                                       size_t* count, wf_vec3** array,
-                                       size_t* cap, size_t elem_size) {
+                                       const char* line, const char* end,
+                                       wf_vec3* vertex, size_t* count,
+                                       wf_vec3** array, size_t* cap,
+                                       size_t           elem_size,
+                                       wf_stream_kind_t kind) {
   const char* s = line;
   vertex->x     = wf_parse_float(&s);
-  if (*s)
+  if (s < end)
     vertex->y = wf_parse_float(&s);
-  if (*s)
+  if (s < end)
     vertex->z = wf_parse_float(&s);
 
   (*count)++;
-  *array = wf_realloc_array(*array, cap, *count, elem_size);
+  if (parser->stream) {
+    wf_vec4 v = { vertex->x, vertex->y, vertex->z, 0.0f };
+    return wf_stream_push(parser, kind, v);
+  }
+  *array = wf_arena_realloc_array(parser->scene->arena, *array, cap, *count,
+                                  elem_size);
   if (!*array) {
     wf_set_error_with_line(parser, "Out of memory while parsing vertex data");
     return WF_ERROR_OUT_OF_MEMORY;
@@ -222,114 +229,270 @@ static wf_error_t wf_parse_vertex_data(wf_obj_parser_t* parser,
   return WF_SUCCESS;
 }
 
-// Parse face indices from line
-static wf_error_t wf_parse_face_indices(wf_obj_parser_t*  parser,
-                                        const char*       line,
-                                        wf_vertex_index** indices,
-                                        size_t*           idx_count) {
-  char* buf = wf_strdup(line);
-  if (!buf) {
-    wf_set_error_with_line(parser, "Out of memory while parsing face");
+// Parse the face token starting at p; returns the start of the next token
+static const char* wf_next_face_index(const wf_obj_parser_t* parser,
+                                     const char* p, const char* end,
+                                     wf_vertex_index* idx) {
+  const char* token = p;
+  while (p < end && *p != ' ' && *p != '\t')
+    p++;
+  wf_parse_face_index(parser, token, p, idx);
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  return p;
+}
+
+// Append one face to the current object, growing its array geometrically
+static wf_error_t wf_push_face(wf_obj_parser_t* parser, wf_vertex_index a,
+                               wf_vertex_index b, wf_vertex_index c) {
+  wf_object_t* obj = parser->current_object;
+  if (obj->face_count == obj->face_cap) {
+    wf_face* faces =
+        wf_arena_realloc_array(parser->scene->arena, obj->faces,
+                               &obj->face_cap, obj->face_count + 1,
+                               sizeof(wf_face));
+    if (!faces) {
+      wf_set_error_with_line(parser, "Out of memory while storing face");
+      return WF_ERROR_OUT_OF_MEMORY;
+    }
+    obj->faces = faces;
+  }
+  wf_face* face         = &obj->faces[obj->face_count++];
+  face->vertices[0]     = a;
+  face->vertices[1]     = b;
+  face->vertices[2]     = c;
+  face->smoothing_group = parser->current_smoothing;
+  return WF_SUCCESS;
+}
+
+// Start a material run at the object's next face, reusing a run that has
+// not received any face yet
+static wf_error_t wf_begin_material_run(wf_obj_parser_t* parser,
+                                        wf_object_t* obj, size_t material) {
+  size_t n = obj->material_run_count;
+  if (n && obj->material_runs[n - 1].start == obj->face_count) {
+    obj->material_runs[n - 1].material_idx = material;
+    return WF_SUCCESS;
+  }
+
+  wf_material_run_t* runs = wf_arena_realloc_array(
+      parser->scene->arena, obj->material_runs, &obj->material_run_cap, n + 1,
+      sizeof(wf_material_run_t));
+  if (!runs) {
+    wf_set_error_with_line(parser, "Out of memory while storing material");
     return WF_ERROR_OUT_OF_MEMORY;
   }
+  runs[n].start           = obj->face_count;
+  runs[n].count           = 0;
+  runs[n].material_idx    = material;
+  obj->material_runs      = runs;
+  obj->material_run_count = n + 1;
+  return WF_SUCCESS;
+}
 
-  *indices       = NULL;
-  size_t idx_cap = 0;
-  *idx_count     = 0;
-
-  char* token = strtok(buf, " \t");
-  while (token) {
-    if (*idx_count >= idx_cap) {
-      idx_cap = idx_cap ? idx_cap * 2 : 8;
-      wf_vertex_index* new_indices =
-          realloc(*indices, idx_cap * sizeof(wf_vertex_index));
-      if (!new_indices) {
-        free(*indices);
-        free(buf);
-        wf_set_error_with_line(parser,
-                               "Out of memory while parsing face indices");
+// Turn run starts into ranges covering every face: faces before the first
+// usemtl get no material, empty runs are dropped and neighbours that share
+// a material are merged
+static wf_error_t wf_finish_material_runs(wf_obj_parser_t* parser) {
+  for (wf_object_t* obj = parser->scene->objects; obj; obj = obj->next) {
+    size_t n = obj->material_run_count;
+    obj->material_idx =
+        n ? obj->material_runs[n - 1].material_idx : WF_MATERIAL_NONE;
+    if (obj->face_count && (!n || obj->material_runs[0].start > 0)) {
+      wf_material_run_t* runs = wf_arena_realloc_array(
+          parser->scene->arena, obj->material_runs, &obj->material_run_cap,
+          n + 1, sizeof(wf_material_run_t));
+      if (!runs) {
+        wf_set_error_with_line(parser, "Out of memory while storing material");
         return WF_ERROR_OUT_OF_MEMORY;
       }
-      *indices = new_indices;
+      memmove(runs + 1, runs, n * sizeof(wf_material_run_t));
+      runs[0].start        = 0;
+      runs[0].material_idx = WF_MATERIAL_NONE;
+      obj->material_runs   = runs;
+      n++;
     }
 
-    wf_parse_face_index_helper(token, &(*indices)[*idx_count],
-                               parser->scene->vertex_count,
-                               parser->scene->texcoord_count,
-                               parser->scene->normal_count,
-                               parser->options->preserve_indices);
-    (*idx_count)++;
-    token = strtok(NULL, " \t");
+    wf_material_run_t* runs = obj->material_runs;
+    size_t             kept = 0;
+    for (size_t i = 0; i < n; i++) {
+      size_t end   = i + 1 < n ? runs[i + 1].start : obj->face_count;
+      size_t count = end - runs[i].start;
+      if (count == 0)
+        continue;
+      if (kept && runs[kept - 1].material_idx == runs[i].material_idx) {
+        runs[kept - 1].count += count;
+        continue;
+      }
+      runs[kept]       = runs[i];
+      runs[kept].count = count;
+      kept++;
+    }
+    obj->material_run_count = kept;
+
+    // Faces carry their run's material as well, so no uninitialized bytes
+    // reach a binary scene
+    for (size_t r = 0; r < kept; r++) {
+      wf_face* face = obj->faces + runs[r].start;
+      for (size_t i = 0; i < runs[r].count; i++)
+        face[i].material_idx = runs[r].material_idx;
+    }
   }
-  free(buf);
   return WF_SUCCESS;
 }
 
-// Add faces to current object
-static wf_error_t wf_add_faces_to_object(wf_obj_parser_t* parser,
-                                         wf_vertex_index* indices,
-                                         size_t           idx_count) {
-  if (idx_count < 3) {
-    free(indices);
-    LOG_WARN("Ignoring invalid face with %zu vertices at line %zu", idx_count,
-             parser->line_number);
-    return WF_SUCCESS;
+// Final pass over the parsed objects: material runs and the name index
+static wf_error_t wf_finish_objects(wf_obj_parser_t* parser) {
+  wf_error_t result = wf_finish_material_runs(parser);
+  if (result != WF_SUCCESS)
+    return result;
+  result = wf_scene_index_objects(parser->scene);
+  if (result != WF_SUCCESS)
+    wf_set_error_with_line(parser, "Out of memory while indexing objects");
+  if (parser->options->compute_bounds) {
+    parser->scene->bounds     = parser->bounds;
+    parser->scene->has_bounds = 1;
   }
+  return result;
+}
 
-  if (parser->options->triangulate || idx_count > 4) {
-    size_t   tri_count = 0;
-    wf_face* tris      = wf_triangulate_polygon(indices, idx_count, &tri_count);
-    free(indices);
-    if (!tris) {
-      wf_set_error_with_line(parser, "Out of memory while triangulating face");
-      return WF_ERROR_OUT_OF_MEMORY;
-    }
+static wf_error_t wf_stream_cancelled(wf_obj_parser_t* parser) {
+  wf_set_error_with_line(parser, "Parsing stopped by callback");
+  return WF_ERROR_CANCELLED;
+}
 
-    size_t old_count = parser->current_object->face_count;
-    parser->current_object->face_count += tri_count;
-    parser->current_object->faces =
-        wf_realloc_array(parser->current_object->faces,
-                         &parser->current_object->face_cap,
-                         parser->current_object->face_count, sizeof(wf_face));
+// Deliver the pending vertex data batch, if any
+static wf_error_t wf_stream_flush(wf_obj_parser_t* parser) {
+  wf_obj_stream_t*      st   = parser->stream;
+  const wf_callbacks_t* cb   = st->callbacks;
+  int                   stop = 0;
 
-    if (!parser->current_object->faces) {
-      free(tris);
-      wf_set_error_with_line(parser,
-                             "Out of memory while storing triangulated faces");
-      return WF_ERROR_OUT_OF_MEMORY;
+  if (st->count) {
+    switch (st->kind) {
+    case WF_STREAM_VERTICES:
+      stop = cb->vertices && cb->vertices(st->user, st->vec3, st->count);
+      break;
+    case WF_STREAM_TEXCOORDS:
+      stop = cb->texcoords && cb->texcoords(st->user, st->vec3, st->count);
+      break;
+    case WF_STREAM_NORMALS:
+      stop = cb->normals && cb->normals(st->user, st->vec3, st->count);
+      break;
+    case WF_STREAM_PARAMETERS:
+      stop = cb->parameters && cb->parameters(st->user, st->vec4, st->count);
+      break;
+    default:
+      break;
     }
+  }
+  st->kind  = WF_STREAM_NONE;
+  st->count = 0;
+  return stop ? wf_stream_cancelled(parser) : WF_SUCCESS;
+}
 
-    for (size_t i = 0; i < tri_count; i++) {
-      parser->current_object->faces[old_count + i] = tris[i];
-    }
-    free(tris);
-    log_debug("idx count is %zu, after triangulate get %zu faces", idx_count,
-              tri_count);
-  } else {
-    wf_face face;
-    for (size_t i = 0; i < 3 && i < idx_count; i++) {
-      face.vertices[i] = indices[i];
-    }
-    for (size_t i = 3; i < idx_count; i++) {
-      face.vertices[i % 3] = indices[i];
+// Queue one element, flushing when the batch is full or changes kind
+static wf_error_t wf_stream_push(wf_obj_parser_t* parser,
+                                 wf_stream_kind_t kind, wf_vec4 v) {
+  wf_obj_stream_t* st = parser->stream;
+  if (st->kind != kind || st->count == WF_STREAM_BATCH) {
+    wf_error_t result = wf_stream_flush(parser);
+    if (result != WF_SUCCESS)
+      return result;
+    st->kind = kind;
+  }
+  if (kind == WF_STREAM_PARAMETERS)
+    st->vec4[st->count++] = v;
+  else
+    st->vec3[st->count++] = (wf_vec3){ v.x, v.y, v.z };
+  return WF_SUCCESS;
+}
+
+// NUL-terminated copy of [line, end) in the stream's scratch buffer
+static const char* wf_stream_copy_name(wf_obj_parser_t* parser,
+                                       const char* line, const char* end) {
+  wf_obj_stream_t* st  = parser->stream;
+  size_t           len = end - line;
+  if (len + 1 > st->name_cap) {
+    char* name = wf_realloc_array(st->name, &st->name_cap, len + 1, 1);
+    if (!name) {
+      wf_set_error_with_line(parser, "Out of memory while reading name");
+      return NULL;
     }
-    free(indices);
+    st->name = name;
+  }
+  memcpy(st->name, line, len);
+  st->name[len] = '\0';
+  return st->name;
+}
 
-    parser->current_object->faces =
-        wf_realloc_array(parser->current_object->faces,
-                         &parser->current_object->face_cap,
-                         parser->current_object->face_count, sizeof(wf_face));
+static wf_error_t wf_stream_name(wf_obj_parser_t* parser,
+                                 int (*callback)(void*, const char*),
+                                 const char* line, const char* end) {
+  wf_error_t result = wf_stream_flush(parser);
+  if (result != WF_SUCCESS || !callback)
+    return result;
+  const char* name = wf_stream_copy_name(parser, line, end);
+  if (!name)
+    return WF_ERROR_OUT_OF_MEMORY;
+  return callback(parser->stream->user, name) ? wf_stream_cancelled(parser)
+                                              : WF_SUCCESS;
+}
 
-    if (!parser->current_object->faces) {
-      wf_set_error_with_line(parser, "Out of memory while storing face");
-      return WF_ERROR_OUT_OF_MEMORY;
+static wf_error_t wf_stream_object(wf_obj_parser_t* parser, const char* line,
+                                   const char* end, int is_group) {
+  const wf_callbacks_t* cb     = parser->stream->callbacks;
+  wf_error_t            result = wf_stream_flush(parser);
+  if (result != WF_SUCCESS || !cb->object)
+    return result;
+  const char* name = wf_stream_copy_name(parser, line, end);
+  if (!name)
+    return WF_ERROR_OUT_OF_MEMORY;
+  return cb->object(parser->stream->user, name, is_group)
+             ? wf_stream_cancelled(parser)
+             : WF_SUCCESS;
+}
+
+// Resolve a face into the scratch corner array and report it, as a fan of
+// triangles when triangulating
+static wf_error_t wf_stream_face(wf_obj_parser_t* parser, const char* line,
+                                 const char* end) {
+  wf_obj_stream_t*      st     = parser->stream;
+  const wf_callbacks_t* cb     = st->callbacks;
+  wf_error_t            result = wf_stream_flush(parser);
+  if (result != WF_SUCCESS || !cb->face)
+    return result;
+
+  size_t n = 0;
+  for (const char* p = line; p < end; n++) {
+    if (n == st->corner_cap) {
+      wf_vertex_index* corners = wf_realloc_array(
+          st->corners, &st->corner_cap, n + 1, sizeof(wf_vertex_index));
+      if (!corners) {
+        wf_set_error_with_line(parser, "Out of memory while parsing face");
+        return WF_ERROR_OUT_OF_MEMORY;
+      }
+      st->corners = corners;
     }
-    parser->current_object->faces[parser->current_object->face_count - 1] =
-        face;
+    p = wf_next_face_index(parser, p, end, &st->corners[n]);
   }
 
-  LOG_DEBUG("Parsed face with %zu vertices", idx_count);
-  return WF_SUCCESS;
+  if (n < 3) {
+    LOG_WARN("Ignoring invalid face with %zu vertices at line %zu", n,
+             parser->line_number);
+    return WF_SUCCESS;
+  }
+
+  int stop = 0;
+  if (!parser->options->triangulate) {
+    stop = cb->face(st->user, st->corners, n);
+  } else {
+    for (size_t i = 1; i + 1 < n && !stop; i++) {
+      wf_vertex_index tri[3] = { st->corners[0], st->corners[i],
+                                 st->corners[i + 1] };
+      stop                   = cb->face(st->user, tri, 3);
+    }
+  }
+  return stop ? wf_stream_cancelled(parser) : WF_SUCCESS;
 }
 
 // Build full path helper
@@ -351,29 +514,131 @@ static void wf_cleanup_parser_state(wf_obj_parser_t* parser) {
   free(parser->line_buffer);
   free(parser->current_mtl_dir);
   free(parser->current_object_name);
+  for (size_t i = 0; i < parser->deferred_count; i++)
+    free(parser->deferred[i].name);
+  free(parser->deferred);
+  free(parser->object_faces);
+  parser->line_buffer         = NULL;
+  parser->current_mtl_dir     = NULL;
+  parser->current_object_name = NULL;
+  parser->deferred            = NULL;
+  parser->deferred_count      = 0;
+  parser->object_faces        = NULL;
+  parser->object_faces_count  = 0;
+}
+
+// Record a material statement for replay after a chunked parse
+static wf_error_t wf_defer_material(wf_obj_parser_t* parser, int is_mtllib,
+                                    const char* line, const char* end) {
+  wf_obj_deferred_t* deferred =
+      wf_realloc_array(parser->deferred, &parser->deferred_cap,
+                       parser->deferred_count + 1, sizeof(wf_obj_deferred_t));
+  if (!deferred) {
+    wf_set_error_with_line(parser, "Out of memory while parsing materials");
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  parser->deferred     = deferred;
+  wf_obj_deferred_t* d = &deferred[parser->deferred_count];
+  d->is_mtllib         = is_mtllib;
+  d->name              = wf_strndup(line, end - line);
+  d->line_number       = parser->line_number;
+  d->material_idx      = WF_MATERIAL_NONE;
+  if (!d->name) {
+    wf_set_error_with_line(parser, "Out of memory while parsing materials");
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  parser->deferred_count++;
+  return WF_SUCCESS;
+}
+
+static wf_error_t wf_load_mtllib(wf_obj_parser_t* parser, const char* line,
+                                 const char* end) {
+  char* mtl_path = wf_strndup(line, end - line);
+  if (!mtl_path) {
+    wf_set_error_with_line(parser, "Out of memory while parsing mtllib");
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+
+  char* full_path = wf_build_full_path(parser->current_mtl_dir, mtl_path);
+  if (!full_path)
+    full_path = mtl_path;
+
+  wf_scene_t* scene = parser->scene;
+  if (!scene->material_index) {
+    scene->material_index = wf_name_index_create(scene->arena, 0);
+    if (!scene->material_index) {
+      free(mtl_path);
+      wf_set_error_with_line(parser, "Out of memory while parsing mtllib");
+      return WF_ERROR_OUT_OF_MEMORY;
+    }
+  }
+
+  wf_mtl_parser_t mtl_parser = { 0 };
+  mtl_parser.mtl_dir         = parser->current_mtl_dir;
+  mtl_parser.arena           = scene->arena;
+  mtl_parser.io              = parser->options->io;
+  mtl_parser.index           = scene->material_index;
+
+  wf_error_t result =
+      parser->options->use_mtl_cache
+          ? wf_mtl_cache_load(&mtl_parser, full_path, &scene->materials,
+                              &scene->material_count, &scene->material_cap)
+          : wf_mtl_parse_file(&mtl_parser, full_path, &scene->materials,
+                              &scene->material_count, &scene->material_cap);
+
+  if (full_path != mtl_path)
+    free(full_path);
+
+  if (result != WF_SUCCESS) {
+    wf_set_error_with_line(parser, "Failed to load MTL file: %s", mtl_path);
+  } else {
+    LOG_DEBUG("Loaded MTL file: %s", mtl_path);
+  }
+  free(mtl_path);
+
+  return result;
+}
+
+// Index of the material a usemtl statement names, WF_MATERIAL_NONE if it is
+// not loaded
+static size_t wf_find_material(wf_obj_parser_t* parser, const char* line,
+                               const char* end) {
+  uintptr_t index;
+  LOG_DEBUG("Set material: %.*s", (int)(end - line), line);
+  if (!parser->scene->material_index
+      || wf_name_index_find(parser->scene->material_index, line, end - line,
+                            &index) != 0)
+    return WF_MATERIAL_NONE;
+  return (size_t)index;
 }
 
 // Handler implementations
-static wf_error_t wf_handle_vertex(void* parser_ptr, const char* line) {
+static wf_error_t wf_handle_vertex(void* parser_ptr, const char* line,
+                                   const char* end) {
   wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
   wf_vec3          v      = { 0 };
-  wf_error_t       result =
-      wf_parse_vertex_data(parser, line, &v, &parser->scene->vertex_count,
-                           &parser->scene->vertices, &parser->scene->vertex_cap,
-                           sizeof(wf_vec3));
+  wf_error_t       result = wf_parse_vertex_data(
+      parser, line, end, &v, &parser->scene->vertex_count,
+      &parser->scene->vertices, &parser->scene->vertex_cap, sizeof(wf_vec3),
+      WF_STREAM_VERTICES);
   if (result == WF_SUCCESS) {
     LOG_DEBUG("Parsed vertex: (%.3f, %.3f, %.3f)", v.x, v.y, v.z);
+    if (parser->options->compute_bounds)
+      wf_aabb_add(&parser->bounds, v);
   }
   return result;
 }
 
-static wf_error_t wf_handle_texcoord(void* parser_ptr, const char* line) {
+static wf_error_t wf_handle_texcoord(void* parser_ptr, const char* line,
+                                     const char* end) {
   wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
   wf_vec3          vt     = { 0, 0, 0 };
   wf_error_t       result =
-      wf_parse_vertex_data(parser, line, &vt, &parser->scene->texcoord_count,
+      wf_parse_vertex_data(parser, line, end, &vt,
+                           &parser->scene->texcoord_count,
                            &parser->scene->texcoords,
-                           &parser->scene->texcoord_cap, sizeof(wf_vec3));
+                           &parser->scene->texcoord_cap, sizeof(wf_vec3),
+                           WF_STREAM_TEXCOORDS);
   if (result == WF_SUCCESS) {
     LOG_DEBUG("Parsed texture coordinate: (%.3f, %.3f, %.3f)", vt.x, vt.y,
               vt.z);
@@ -381,34 +646,41 @@ static wf_error_t wf_handle_texcoord(void* parser_ptr, const char* line) {
   return result;
 }
 
-static wf_error_t wf_handle_normal(void* parser_ptr, const char* line) {
+static wf_error_t wf_handle_normal(void* parser_ptr, const char* line,
+                                   const char* end) {
   wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
   wf_vec3          vn     = { 0 };
-  wf_error_t       result =
-      wf_parse_vertex_data(parser, line, &vn, &parser->scene->normal_count,
-                           &parser->scene->normals, &parser->scene->normal_cap,
-                           sizeof(wf_vec3));
+  wf_error_t       result = wf_parse_vertex_data(
+      parser, line, end, &vn, &parser->scene->normal_count,
+      &parser->scene->normals, &parser->scene->normal_cap, sizeof(wf_vec3),
+      WF_STREAM_NORMALS);
   if (result == WF_SUCCESS) {
     LOG_DEBUG("Parsed normal: (%.3f, %.3f, %.3f)", vn.x, vn.y, vn.z);
   }
   return result;
 }
 
-static wf_error_t wf_handle_parameter(void* parser_ptr, const char* line) {
+static wf_error_t wf_handle_parameter(void* parser_ptr, const char* line,
+                                      const char* end) {
   wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
   const char*      s      = line;
   wf_vec4          vp     = { 0 };
   vp.x                    = wf_parse_float(&s);
-  if (*s)
+  if (s < end)
     vp.y = wf_parse_float(&s);
-  if (*s)
+  if (s < end)
     vp.z = wf_parse_float(&s);
-  if (*s)
+  if (s < end)
     vp.w = wf_parse_float(&s);
 
+  parser->scene->parameter_count++;
+  if (parser->stream)
+    return wf_stream_push(parser, WF_STREAM_PARAMETERS, vp);
+
   parser->scene->parameters =
-      wf_realloc_array(parser->scene->parameters, &parser->scene->parameter_cap,
-                       parser->scene->parameter_count, sizeof(wf_vec4));
+      wf_arena_realloc_array(parser->scene->arena, parser->scene->parameters,
+                             &parser->scene->parameter_cap,
+                             parser->scene->parameter_count, sizeof(wf_vec4));
 
   if (!parser->scene->parameters) {
     wf_set_error_with_line(parser, "Out of memory while parsing parameter");
@@ -420,124 +692,794 @@ static wf_error_t wf_handle_parameter(void* parser_ptr, const char* line) {
   return WF_SUCCESS;
 }
 
-static wf_error_t wf_handle_face(void* parser_ptr, const char* line) {
+static wf_error_t wf_handle_face(void* parser_ptr, const char* line,
+                                 const char* end) {
   wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
+  if (parser->stream)
+    return wf_stream_face(parser, line, end);
 
   wf_error_t result = wf_ensure_current_object(parser);
   if (result != WF_SUCCESS)
     return result;
 
-  wf_vertex_index* indices   = NULL;
-  size_t           idx_count = 0;
-  result = wf_parse_face_indices(parser, line, &indices, &idx_count);
-  if (result != WF_SUCCESS)
-    return result;
+  // Fan-triangulate while reading tokens, writing straight into the object.
+  // Without triangulation the second half of a quad is held back until a
+  // fifth vertex shows the polygon must be split after all.
+  wf_object_t*    obj        = parser->current_object;
+  size_t          first_face = obj->face_count;
+  int             keep_quads = !parser->options->triangulate;
+  wf_vertex_index quad[4];
+  wf_vertex_index prev       = { 0 };
+  size_t          idx_count  = 0;
+
+  const char* p = line;
+  while (p < end) {
+    wf_vertex_index idx;
+    p = wf_next_face_index(parser, p, end, &idx);
+    if (idx_count < 4)
+      quad[idx_count] = idx;
+    if (keep_quads && idx_count == 4) {
+      result = wf_push_face(parser, quad[0], quad[2], quad[3]);
+      if (result != WF_SUCCESS)
+        return result;
+    }
+    if (idx_count >= 2 && !(keep_quads && idx_count == 3)) {
+      result = wf_push_face(parser, quad[0], prev, idx);
+      if (result != WF_SUCCESS)
+        return result;
+    }
+    prev = idx;
+    idx_count++;
+  }
+
+  if (idx_count < 3) {
+    LOG_WARN("Ignoring invalid face with %zu vertices at line %zu", idx_count,
+             parser->line_number);
+    return WF_SUCCESS;
+  }
+
+  if (keep_quads && idx_count == 4) {
+    // Quads are kept as a single face when not triangulating
+    obj->faces[first_face].vertices[0] = quad[3];
+    obj->faces[first_face].vertices[1] = quad[1];
+    obj->faces[first_face].vertices[2] = quad[2];
+  }
 
-  return wf_add_faces_to_object(parser, indices, idx_count);
+  LOG_DEBUG("Parsed face with %zu vertices", idx_count);
+  return WF_SUCCESS;
 }
 
-static wf_error_t wf_handle_object(void* parser_ptr, const char* line) {
+static wf_error_t wf_handle_object(void* parser_ptr, const char* line,
+                                   const char* end) {
   wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
-  if (!parser->current_object_name)
-    free(parser->current_object_name);
-  parser->current_object_name = wf_strdup(line);
+  if (parser->stream)
+    return wf_stream_object(parser, line, end, 0);
+
+  free(parser->current_object_name);
+  parser->current_object_name = wf_strndup(line, end - line);
 
-  parser->current_object = calloc(1, sizeof(wf_object_t));
+  parser->current_object =
+      wf_arena_calloc(parser->scene->arena, 1, sizeof(wf_object_t));
   if (!parser->current_object) {
     wf_set_error_with_line(parser, "Out of memory while creating object");
     return WF_ERROR_OUT_OF_MEMORY;
   }
 
-  parser->current_object->name = wf_strdup(parser->current_object_name);
+  parser->current_object->name =
+      wf_arena_strdup(parser->scene->arena, parser->current_object_name);
+  wf_reserve_object_faces(parser, parser->current_object,
+                          ++parser->object_ordinal);
   wf_add_object_to_list(parser, parser->current_object);
 
   LOG_DEBUG("Parsed object: %s", parser->current_object_name);
+  // usemtl state carries over into the new object
+  if (parser->current_material != WF_MATERIAL_NONE) {
+    return wf_begin_material_run(parser, parser->current_object,
+                                 parser->current_material);
+  }
   return WF_SUCCESS;
 }
 
-static wf_error_t wf_handle_group(void* parser_ptr, const char* line) {
-  return wf_handle_object(parser_ptr, line);
+static wf_error_t wf_handle_group(void* parser_ptr, const char* line,
+                                  const char* end) {
+  wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
+  if (parser->stream)
+    return wf_stream_object(parser, line, end, 1);
+  return wf_handle_object(parser_ptr, line, end);
+}
+
+static wf_error_t wf_handle_mtllib(void* parser_ptr, const char* line,
+                                   const char* end) {
+  wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
+  if (parser->stream)
+    return wf_stream_name(parser, parser->stream->callbacks->mtllib, line, end);
+  if (parser->defer_materials)
+    return wf_defer_material(parser, 1, line, end);
+  return wf_load_mtllib(parser, line, end);
+}
+
+static wf_error_t wf_handle_usemtl(void* parser_ptr, const char* line,
+                                   const char* end) {
+  wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
+  if (parser->stream)
+    return wf_stream_name(parser, parser->stream->callbacks->usemtl, line, end);
+
+  wf_error_t result = wf_ensure_current_object(parser);
+  if (result != WF_SUCCESS)
+    return result;
+
+  size_t material;
+  if (parser->defer_materials) {
+    result = wf_defer_material(parser, 0, line, end);
+    if (result != WF_SUCCESS)
+      return result;
+    material = WF_MATERIAL_DEFERRED(parser->deferred_count - 1);
+  } else {
+    material = wf_find_material(parser, line, end);
+  }
+  parser->current_material = material;
+  return wf_begin_material_run(parser, parser->current_object, material);
 }
 
-static wf_error_t wf_handle_mtllib(void* parser_ptr, const char* line) {
+// s N selects smoothing group N for the faces that follow; s off and s 0
+// turn smoothing off
+static wf_error_t wf_handle_smoothing(void* parser_ptr, const char* line,
+                                      const char* end) {
   wf_obj_parser_t* parser   = (wf_obj_parser_t*)parser_ptr;
-  char*            mtl_path = wf_strdup(line);
-  if (!mtl_path) {
-    wf_set_error_with_line(parser, "Out of memory while parsing mtllib");
-    return WF_ERROR_OUT_OF_MEMORY;
+  unsigned long    group    = 0;
+  int              overflow = 0;
+  const char*      p        = line;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    if (!overflow)
+      group = group * 10 + (unsigned long)(*p - '0');
+    overflow = group >= WF_SMOOTHING_INHERIT;
   }
 
-  char* full_path = wf_build_full_path(parser->current_mtl_dir, mtl_path);
-  if (!full_path)
-    full_path = mtl_path;
+  if (p == line && (end - line < 3 || strncmp(line, "off", 3) != 0)) {
+    LOG_WARN("Ignoring invalid smoothing group at line %zu",
+             parser->line_number);
+    return WF_SUCCESS;
+  }
+  if (overflow) {
+    LOG_WARN("Smoothing group out of range at line %zu, using off",
+             parser->line_number);
+    group = 0;
+  }
+  parser->current_smoothing = (unsigned)group;
+  LOG_DEBUG("Smoothing group %u", parser->current_smoothing);
+  return WF_SUCCESS;
+}
 
-  wf_mtl_parser_t mtl_parser = { 0 };
-  mtl_parser.mtl_dir         = parser->current_mtl_dir;
+static wf_error_t wf_handle_line_elem(void* parser_ptr, const char* line,
+                                      const char* end) {
+  LOG_DEBUG("Ignoring line element: %.*s", (int)(end - line), line);
+  return WF_SUCCESS;
+}
 
-  wf_error_t result =
-      wf_mtl_parse_file(&mtl_parser, full_path, &parser->scene->materials,
-                        &parser->scene->material_count,
-                        &parser->scene->material_cap);
+static wf_error_t wf_handle_freeform(void* parser_ptr, const char* line,
+                                     const char* end) {
+  LOG_DEBUG("Ignoring free-form geometry command");
+  return WF_SUCCESS;
+}
 
-  if (full_path != mtl_path)
-    free(full_path);
-  free(mtl_path);
+// Strip surrounding whitespace from [*line, *end); returns 0 for blank lines
+// and comments
+static int wf_obj_trim_line(const char** line, const char** end) {
+  const char* b = *line;
+  const char* e = *end;
+  while (b < e && isspace((unsigned char)*b))
+    b++;
+  while (e > b && isspace((unsigned char)e[-1]))
+    e--;
+  *line = b;
+  *end  = e;
+  return b != e && *b != '#';
+}
 
-  if (result != WF_SUCCESS) {
-    wf_set_error_with_line(parser, "Failed to load MTL file: %s", line);
-  } else {
-    LOG_DEBUG("Loaded MTL file: %s", line);
+// Dispatch one line given as [line, end). The line does not need to be
+// NUL-terminated, handlers only look at bytes before end. Every 1024th line
+// also polls options->cancel.
+static wf_error_t wf_obj_parse_line(wf_obj_parser_t* parser, const char* line,
+                                    const char* end) {
+  const volatile int* cancel = parser->options->cancel;
+  if (cancel && (parser->line_number & 1023) == 0
+      && WF_ATOMIC_LOAD(cancel)) {
+    wf_set_error_with_line(parser, "Parsing cancelled");
+    return WF_ERROR_CANCELLED;
+  }
+
+  if (!wf_obj_trim_line(&line, &end))
+    return WF_SUCCESS;
+
+  size_t           line_len     = end - line;
+  wf_obj_keyword_t kw           = wf_obj_keyword(line, line_len);
+  const char*      handler_line = line + WF_OBJ_KEYWORDS[kw].length;
+
+  while (handler_line < end
+         && (*handler_line == ' ' || *handler_line == '\t')) {
+    handler_line++;
   }
 
+  wf_error_t result = WF_SUCCESS;
+  if (kw != WF_KW_NONE) {
+    LOG_DEBUG("handle command %s @%zu: [%.*s]", WF_OBJ_KEYWORDS[kw].name,
+              parser->line_number, (int)line_len, line);
+    result = WF_HANDLERS[kw](parser, handler_line, end);
+  } else if (parser->options->strict_mode) {
+    wf_set_error_with_line(parser, "Unsupported command: %.*s",
+                           (int)(line_len < 50 ? line_len : 50), line);
+    result = WF_ERROR_UNSUPPORTED_FEATURE;
+  } else {
+    LOG_ERROR("Ignoring unsupported command at line %zu: %.*s",
+              parser->line_number, (int)(line_len < 50 ? line_len : 50), line);
+  }
   return result;
 }
 
-static wf_error_t wf_handle_usemtl(void* parser_ptr, const char* line) {
-  wf_obj_parser_t* parser = (wf_obj_parser_t*)parser_ptr;
+// Parse an in-memory buffer line by line without copying. Only an
+// unterminated last line is copied, so handlers always see a line that is
+// followed by a terminator inside readable memory.
+static wf_error_t wf_obj_parse_buffer(wf_obj_parser_t* parser,
+                                      const char* data, size_t size) {
+  const char* p     = data;
+  const char* limit = data + size;
 
-  wf_error_t result = wf_ensure_current_object(parser);
-  if (result != WF_SUCCESS)
-    return result;
+  while (p < limit) {
+    const char* nl = memchr(p, '\n', limit - p);
+    parser->line_number++;
+    if (!nl) {
+      size_t len = limit - p;
+      if (len + 1 > parser->line_capacity || !parser->line_buffer) {
+        char* buf = realloc(parser->line_buffer, len + 1);
+        if (!buf) {
+          wf_set_error_with_line(parser, "Out of memory while reading line");
+          return WF_ERROR_OUT_OF_MEMORY;
+        }
+        parser->line_buffer   = buf;
+        parser->line_capacity = len + 1;
+      }
+      memcpy(parser->line_buffer, p, len);
+      parser->line_buffer[len] = '\0';
+      return wf_obj_parse_line(parser, parser->line_buffer,
+                               parser->line_buffer + len);
+    }
 
-  // free(parser->current_object->material_name);
+    wf_error_t result = wf_obj_parse_line(parser, p, nl);
+    if (result != WF_SUCCESS)
+      return result;
+    p = nl + 1;
+  }
+  return WF_SUCCESS;
+}
 
-  // parser->current_object->material_name = wf_strdup(line);
-  parser->current_object->material_idx = -1;
-  wf_material_t* materials_list        = parser->scene->materials;
-  for (size_t i = 0; i < parser->scene->material_count; i++) {
-    if (!strncmp(materials_list[i].name, line,
-                 strlen(materials_list[i].name))) {
-      parser->current_object->material_idx = i;
+// Count geometry statements in a buffer, classifying lines exactly like
+// wf_obj_parse_line does
+static void wf_obj_count_buffer(const char* data, size_t size,
+                                wf_obj_counts_t* counts) {
+  const char* p     = data;
+  const char* limit = data + size;
+
+  memset(counts, 0, sizeof(*counts));
+  while (p < limit) {
+    const char* nl   = memchr(p, '\n', limit - p);
+    const char* line = p;
+    const char* end  = nl ? nl : limit;
+    p                = nl ? nl + 1 : limit;
+    counts->lines++;
+
+    if (!wf_obj_trim_line(&line, &end) || *line != 'v')
+      continue;
+    switch (wf_obj_keyword(line, end - line)) {
+    case WF_KW_V:
+      counts->vertices++;
+      break;
+    case WF_KW_VT:
+      counts->texcoords++;
+      break;
+    case WF_KW_VN:
+      counts->normals++;
+      break;
+    case WF_KW_VP:
+      counts->parameters++;
+      break;
+    default:
       break;
     }
   }
-  LOG_DEBUG("Set material: %s", line);
-  return WF_SUCCESS;
 }
 
-static wf_error_t wf_handle_smoothing(void* parser_ptr, const char* line) {
-  LOG_DEBUG("Ignoring smoothing group: %s", line);
+// Allocate the geometry arrays for known element counts
+static wf_error_t wf_obj_reserve_geometry(wf_obj_parser_t*       parser,
+                                          const wf_size_hints_t* hints) {
+  wf_scene_t* scene = parser->scene;
+  struct {
+    void**  array;
+    size_t* cap;
+    size_t  count;
+    size_t  elem_size;
+  } arrays[] = {
+    { (void**)&scene->vertices, &scene->vertex_cap, hints->vertices,
+      sizeof(wf_vec3) },
+    { (void**)&scene->texcoords, &scene->texcoord_cap, hints->texcoords,
+      sizeof(wf_vec3) },
+    { (void**)&scene->normals, &scene->normal_cap, hints->normals,
+      sizeof(wf_vec3) },
+    { (void**)&scene->parameters, &scene->parameter_cap, hints->parameters,
+      sizeof(wf_vec4) },
+  };
+
+  for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+    if (!arrays[i].count || *arrays[i].cap >= arrays[i].count)
+      continue;
+    // Exact size: wf_realloc_array would round small counts up
+    void* p = wf_arena_realloc(scene->arena, *arrays[i].array,
+                               *arrays[i].cap * arrays[i].elem_size,
+                               arrays[i].count * arrays[i].elem_size);
+    if (!p) {
+      wf_set_error_with_line(parser,
+                             "Out of memory while allocating geometry");
+      return WF_ERROR_OUT_OF_MEMORY;
+    }
+    *arrays[i].array = p;
+    *arrays[i].cap   = arrays[i].count;
+  }
   return WF_SUCCESS;
 }
 
-static wf_error_t wf_handle_line_elem(void* parser_ptr, const char* line) {
-  LOG_DEBUG("Ignoring line element: %s", line);
-  return WF_SUCCESS;
+// Counting pass for pre-sizing: geometry statements and the number of faces
+// each object will receive, classified exactly like wf_obj_parse_line does
+static wf_error_t wf_obj_presize(wf_obj_parser_t* parser, const char* data,
+                                 size_t size) {
+  wf_size_hints_t counts = { 0 };
+  size_t          cap    = 0;
+  const char*     p      = data;
+  const char*     limit  = data + size;
+
+  parser->object_faces = wf_realloc_array(NULL, &cap, 1, sizeof(size_t));
+  if (!parser->object_faces) {
+    wf_set_error_with_line(parser, "Out of memory while counting objects");
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  parser->object_faces[0]    = 0;
+  parser->object_faces_count = 1;
+
+  while (p < limit) {
+    const char* nl   = memchr(p, '\n', limit - p);
+    const char* line = p;
+    const char* end  = nl ? nl : limit;
+    p                = nl ? nl + 1 : limit;
+
+    if (!wf_obj_trim_line(&line, &end))
+      continue;
+    wf_obj_keyword_t kw = wf_obj_keyword(line, end - line);
+
+    if (kw == WF_KW_V) {
+      counts.vertices++;
+    } else if (kw == WF_KW_VT) {
+      counts.texcoords++;
+    } else if (kw == WF_KW_VN) {
+      counts.normals++;
+    } else if (kw == WF_KW_VP) {
+      counts.parameters++;
+    } else if (kw == WF_KW_F) {
+      size_t corners = 0;
+      for (const char* c = line + 1; c < end;) {
+        while (c < end && (*c == ' ' || *c == '\t'))
+          c++;
+        if (c == end)
+          break;
+        corners++;
+        while (c < end && *c != ' ' && *c != '\t')
+          c++;
+      }
+      if (corners >= 3) {
+        parser->object_faces[parser->object_faces_count - 1] +=
+            (!parser->options->triangulate && corners == 4) ? 1 : corners - 2;
+      }
+    } else if (kw == WF_KW_O || kw == WF_KW_G) {
+      size_t* faces =
+          wf_realloc_array(parser->object_faces, &cap,
+                           parser->object_faces_count + 1, sizeof(size_t));
+      if (!faces) {
+        wf_set_error_with_line(parser, "Out of memory while counting objects");
+        return WF_ERROR_OUT_OF_MEMORY;
+      }
+      parser->object_faces                               = faces;
+      parser->object_faces[parser->object_faces_count++] = 0;
+    }
+  }
+
+  LOG_DEBUG("Pre-sized %zu vertices, %zu texcoords, %zu normals, %zu objects",
+            counts.vertices, counts.texcoords, counts.normals,
+            parser->object_faces_count);
+  return wf_obj_reserve_geometry(parser, &counts);
 }
 
-static wf_error_t wf_handle_freeform(void* parser_ptr, const char* line) {
-  LOG_DEBUG("Ignoring free-form geometry command");
+typedef struct {
+  const char*     data;
+  size_t          size;
+  wf_obj_counts_t counts;
+  wf_obj_parser_t parser;
+  wf_scene_t      shard; /**< Views into the scene arrays plus own objects */
+  wf_error_t      result;
+} wf_obj_chunk_t;
+
+static void wf_obj_count_task(void* arg) {
+  wf_obj_chunk_t* chunk = (wf_obj_chunk_t*)arg;
+  wf_obj_count_buffer(chunk->data, chunk->size, &chunk->counts);
+}
+
+static void wf_obj_parse_task(void* arg) {
+  wf_obj_chunk_t* chunk = (wf_obj_chunk_t*)arg;
+  chunk->result = wf_obj_parse_buffer(&chunk->parser, chunk->data, chunk->size);
+}
+
+static void wf_free_object_list(wf_arena_t* arena, wf_object_t* obj) {
+  while (obj) {
+    wf_object_t* next = obj->next;
+    wf_arena_free(arena, obj->name);
+    wf_arena_free(arena, obj->faces);
+    wf_arena_free(arena, obj->material_runs);
+    wf_arena_free(arena, obj);
+    obj = next;
+  }
+}
+
+// Material a chunk run refers to, once the chunk's usemtl statements have
+// been replayed
+static size_t wf_obj_resolve_material(const wf_obj_chunk_t* chunk,
+                                      size_t material, size_t inherited) {
+  if (material == WF_MATERIAL_NONE)
+    return material;
+  if (material == WF_MATERIAL_INHERIT)
+    return inherited;
+  return chunk->parser.deferred[WF_MATERIAL_DEFERRED_AT(material)]
+      .material_idx;
+}
+
+// Splice a parsed chunk onto the scene. Faces before the chunk's first o/g
+// belong to the object that was current at the end of the previous chunk,
+// and deferred material statements are replayed in file order.
+static wf_error_t wf_obj_merge_chunk(wf_obj_parser_t* parser,
+                                     wf_obj_chunk_t*  chunk,
+                                     wf_object_t**    tail) {
+  wf_scene_t*  shard     = &chunk->shard;
+  wf_arena_t*  arena     = parser->scene->arena;
+  wf_object_t* cur       = parser->current_object;
+  wf_object_t* leading   = NULL;
+  size_t       inherited = parser->current_material;
+  wf_error_t   result    = WF_ERROR_OUT_OF_MEMORY;
+
+  // Take the shard's memory over first, so a failure leaves the scene as it
+  // was
+  if (wf_arena_adopt(arena, shard->arena) != 0) {
+    wf_set_error_with_line(parser, "Out of memory while merging faces");
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  shard->arena = NULL;
+
+  for (size_t i = 0; i < chunk->parser.deferred_count; i++) {
+    wf_obj_deferred_t* d   = &chunk->parser.deferred[i];
+    const char*        end = d->name + strlen(d->name);
+    parser->line_number    = d->line_number;
+    if (d->is_mtllib) {
+      result = wf_load_mtllib(parser, d->name, end);
+      if (result != WF_SUCCESS)
+        goto fail;
+    } else {
+      d->material_idx = wf_find_material(parser, d->name, end);
+    }
+  }
+  parser->current_material =
+      wf_obj_resolve_material(chunk, chunk->parser.current_material, inherited);
+  wf_aabb_merge(&parser->bounds, &chunk->parser.bounds);
+
+  // Faces before the chunk's first s statement continue the current group
+  int inherit = 1;
+  for (wf_object_t* obj = shard->objects; obj && inherit; obj = obj->next) {
+    for (size_t i = 0; i < obj->face_count; i++) {
+      if (obj->faces[i].smoothing_group != WF_SMOOTHING_INHERIT) {
+        inherit = 0;
+        break;
+      }
+      obj->faces[i].smoothing_group = parser->current_smoothing;
+    }
+  }
+  if (chunk->parser.current_smoothing != WF_SMOOTHING_INHERIT)
+    parser->current_smoothing = chunk->parser.current_smoothing;
+
+  for (wf_object_t* obj = shard->objects; obj; obj = obj->next) {
+    for (size_t i = 0; i < obj->material_run_count; i++) {
+      wf_material_run_t* run = &obj->material_runs[i];
+      run->material_idx =
+          wf_obj_resolve_material(chunk, run->material_idx, inherited);
+    }
+  }
+
+  if (chunk->parser.implicit_first_object && cur) {
+    leading        = shard->objects;
+    shard->objects = leading->next;
+    leading->next  = NULL;
+
+    size_t base = cur->face_count;
+    if (leading->face_count) {
+      wf_face* faces = wf_arena_realloc_array(arena, cur->faces, &cur->face_cap,
+                                              base + leading->face_count,
+                                              sizeof(wf_face));
+      if (!faces) {
+        wf_set_error_with_line(parser, "Out of memory while merging faces");
+        goto fail;
+      }
+      cur->faces = faces;
+      memcpy(cur->faces + base, leading->faces,
+             leading->face_count * sizeof(wf_face));
+      cur->face_count += leading->face_count;
+    }
+    if (leading->material_run_count) {
+      size_t n = cur->material_run_count;
+      wf_material_run_t* runs =
+          wf_arena_realloc_array(arena, cur->material_runs,
+                                 &cur->material_run_cap,
+                                 n + leading->material_run_count,
+                                 sizeof(wf_material_run_t));
+      if (!runs) {
+        wf_set_error_with_line(parser, "Out of memory while merging faces");
+        goto fail;
+      }
+      cur->material_runs = runs;
+      for (size_t i = 0; i < leading->material_run_count; i++) {
+        cur->material_runs[n + i] = leading->material_runs[i];
+        cur->material_runs[n + i].start += base;
+      }
+      cur->material_run_count += leading->material_run_count;
+    }
+  }
+
+  if (shard->objects) {
+    if (*tail)
+      (*tail)->next = shard->objects;
+    else
+      parser->scene->objects = shard->objects;
+    wf_object_t* last = shard->objects;
+    while (last->next)
+      last = last->next;
+    *tail                  = last;
+    parser->current_object = last;
+    parser->last_object    = last;
+    shard->objects         = NULL;
+  }
+
+  wf_free_object_list(arena, leading);
   return WF_SUCCESS;
+
+fail:
+  // The shard's objects now live in the scene's arena
+  wf_free_object_list(arena, leading);
+  wf_free_object_list(arena, shard->objects);
+  shard->objects = NULL;
+  return result;
+}
+
+// Parse a mapped file on a thread pool. A counting pass gives each chunk its
+// exact share of the geometry arrays and the running v/vt/vn counts needed
+// to resolve relative indices, so the result matches a serial parse.
+static wf_error_t wf_obj_parse_parallel(wf_obj_parser_t* parser,
+                                        const char* data, size_t size,
+                                        size_t chunk_count) {
+  wf_obj_chunk_t* chunks = calloc(chunk_count, sizeof(wf_obj_chunk_t));
+  if (!chunks)
+    return wf_obj_parse_buffer(parser, data, size);
+  wf_thread_pool_t* pool = wf_thread_pool_create(chunk_count);
+  if (!pool) {
+    free(chunks);
+    return wf_obj_parse_buffer(parser, data, size);
+  }
+
+  // Split at newline boundaries
+  const char* limit = data + size;
+  const char* p     = data;
+  size_t      n     = 0;
+  for (; n < chunk_count && p < limit; n++) {
+    const char* end = data + size / chunk_count * (n + 1);
+    if (n + 1 == chunk_count || end >= limit) {
+      end = limit;
+    } else {
+      if (end < p)
+        end = p;
+      end = memchr(end, '\n', limit - end);
+      end = end ? end + 1 : limit;
+    }
+    chunks[n].data = p;
+    chunks[n].size = end - p;
+    p              = end;
+  }
+  chunk_count = n;
+
+  for (size_t i = 0; i < chunk_count; i++) {
+    if (wf_thread_pool_submit(pool, wf_obj_count_task, &chunks[i]) != 0)
+      wf_obj_count_task(&chunks[i]);
+  }
+  wf_thread_pool_wait(pool);
+
+  wf_obj_counts_t total = { 0 };
+  for (size_t i = 0; i < chunk_count; i++) {
+    total.vertices += chunks[i].counts.vertices;
+    total.texcoords += chunks[i].counts.texcoords;
+    total.normals += chunks[i].counts.normals;
+    total.parameters += chunks[i].counts.parameters;
+  }
+
+  wf_scene_t* scene = parser->scene;
+  wf_error_t  result = WF_SUCCESS;
+  wf_arena_t* arena = scene->arena;
+  if (total.vertices)
+    scene->vertices = wf_arena_alloc(arena, total.vertices * sizeof(wf_vec3));
+  if (total.texcoords)
+    scene->texcoords =
+        wf_arena_alloc(arena, total.texcoords * sizeof(wf_vec3));
+  if (total.normals)
+    scene->normals = wf_arena_alloc(arena, total.normals * sizeof(wf_vec3));
+  if (total.parameters)
+    scene->parameters =
+        wf_arena_alloc(arena, total.parameters * sizeof(wf_vec4));
+  if ((total.vertices && !scene->vertices)
+      || (total.texcoords && !scene->texcoords)
+      || (total.normals && !scene->normals)
+      || (total.parameters && !scene->parameters)) {
+    wf_set_error_with_line(parser, "Out of memory while allocating geometry");
+    wf_thread_pool_destroy(pool);
+    free(chunks);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  scene->vertex_cap    = total.vertices;
+  scene->texcoord_cap  = total.texcoords;
+  scene->normal_cap    = total.normals;
+  scene->parameter_cap = total.parameters;
+
+  wf_obj_counts_t base = { 0 };
+  base.lines           = parser->line_number;
+  for (size_t i = 0; i < chunk_count; i++) {
+    wf_obj_chunk_t*  c  = &chunks[i];
+    wf_obj_parser_t* cp = &c->parser;
+
+    c->shard.vertices      = scene->vertices + base.vertices;
+    c->shard.texcoords     = scene->texcoords + base.texcoords;
+    c->shard.normals       = scene->normals + base.normals;
+    c->shard.parameters    = scene->parameters + base.parameters;
+    c->shard.vertex_cap    = c->counts.vertices;
+    c->shard.texcoord_cap  = c->counts.texcoords;
+    c->shard.normal_cap    = c->counts.normals;
+    c->shard.parameter_cap = c->counts.parameters;
+
+    cp->options           = parser->options;
+    cp->scene             = &c->shard;
+    cp->line_capacity     = parser->line_capacity;
+    cp->line_number       = base.lines;
+    cp->vertex_base       = base.vertices;
+    cp->texcoord_base     = base.texcoords;
+    cp->normal_base       = base.normals;
+    cp->defer_materials   = 1;
+    cp->current_material  = WF_MATERIAL_INHERIT;
+    cp->bounds            = wf_aabb_empty();
+    cp->current_smoothing = WF_SMOOTHING_INHERIT;
+
+    base.lines += c->counts.lines;
+    base.vertices += c->counts.vertices;
+    base.texcoords += c->counts.texcoords;
+    base.normals += c->counts.normals;
+    base.parameters += c->counts.parameters;
+
+    // Workers allocate from private arenas, adopted by the scene on merge
+    if (arena && !(c->shard.arena = wf_arena_create(0))) {
+      c->result              = WF_ERROR_OUT_OF_MEMORY;
+      c->shard.error_message = wf_strdup("Out of memory while creating arena");
+      continue;
+    }
+    if (wf_thread_pool_submit(pool, wf_obj_parse_task, c) != 0)
+      wf_obj_parse_task(c);
+  }
+  wf_thread_pool_wait(pool);
+  wf_thread_pool_destroy(pool);
+
+  // Stitch chunks together in file order, stopping at the first failure
+  wf_object_t* tail = scene->objects;
+  while (tail && tail->next)
+    tail = tail->next;
+
+  size_t i = 0;
+  for (; i < chunk_count; i++) {
+    wf_obj_chunk_t* c = &chunks[i];
+    scene->vertex_count += c->shard.vertex_count;
+    scene->texcoord_count += c->shard.texcoord_count;
+    scene->normal_count += c->shard.normal_count;
+    scene->parameter_count += c->shard.parameter_count;
+
+    result = wf_obj_merge_chunk(parser, c, &tail);
+    if (result == WF_SUCCESS && c->result != WF_SUCCESS) {
+      result = c->result;
+      free(scene->error_message);
+      scene->error_message   = c->shard.error_message;
+      c->shard.error_message = NULL;
+    }
+    parser->line_number = c->parser.line_number;
+    if (result != WF_SUCCESS)
+      break;
+  }
+
+  for (size_t j = 0; j < chunk_count; j++) {
+    wf_free_object_list(chunks[j].shard.arena, chunks[j].shard.objects);
+    wf_arena_destroy(chunks[j].shard.arena);
+    free(chunks[j].shard.error_message);
+    wf_cleanup_parser_state(&chunks[j].parser);
+  }
+  free(chunks);
+
+  LOG_DEBUG("Parsed %zu chunks in parallel", chunk_count);
+  return result;
+}
+
+// Fallback for inputs that cannot be mapped (pipes, character devices)
+static wf_error_t wf_obj_parse_stream(wf_obj_parser_t* parser) {
+  parser->line_buffer = malloc(parser->line_capacity);
+  if (!parser->line_buffer) {
+    LOG_ERROR("Out of memory allocating line buffer");
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+
+  wf_error_t result = WF_SUCCESS;
+  while (fgets(parser->line_buffer, (int)parser->line_capacity, parser->file)) {
+    parser->line_number++;
+    size_t len = strlen(parser->line_buffer);
+    result     = wf_obj_parse_line(parser, parser->line_buffer,
+                                   parser->line_buffer + len);
+    if (result != WF_SUCCESS)
+      break;
+  }
+  return result;
+}
+
+// Parse a whole file held in memory
+static wf_error_t wf_obj_parse_data(wf_obj_parser_t* parser, const char* data,
+                                    size_t size) {
+  size_t threads = parser->options->num_threads;
+  if (threads == 0)
+    threads = wf_cpu_count();
+  size_t chunks = size / WF_OBJ_MIN_CHUNK_SIZE;
+  if (chunks > threads)
+    chunks = threads;
+
+  if (parser->stream)
+    return wf_obj_parse_buffer(parser, data, size);
+  if (chunks > 1)
+    return wf_obj_parse_parallel(parser, data, size, chunks);
+
+  wf_error_t result = WF_SUCCESS;
+  if (parser->options->size_hints)
+    result = wf_obj_reserve_geometry(parser, parser->options->size_hints);
+  else if (parser->options->presize)
+    result = wf_obj_presize(parser, data, size);
+  if (result == WF_SUCCESS)
+    result = wf_obj_parse_buffer(parser, data, size);
+  return result;
 }
 
 // Main parsing function
 wf_error_t wf_obj_parse_file(wf_obj_parser_t* parser, const char* filename) {
   LOG_INFO("Starting OBJ file parsing: %s", filename);
 
-  parser->file = fopen(filename, "r");
-  if (!parser->file) {
-    LOG_ERROR("Cannot open OBJ file: %s", filename);
-    return WF_ERROR_FILE_NOT_FOUND;
+  wf_io_buffer_t buffer = { 0 };
+  if (parser->options->io) {
+    wf_error_t result = wf_io_load(parser->options->io, filename, &buffer);
+    if (result != WF_SUCCESS) {
+      LOG_ERROR("Cannot open OBJ file: %s", filename);
+      return result;
+    }
+  } else {
+    parser->file = fopen(filename, "r");
+    if (!parser->file) {
+      LOG_ERROR("Cannot open OBJ file: %s", filename);
+      return WF_ERROR_FILE_NOT_FOUND;
+    }
   }
 
   const char* last_slash = strrchr(filename, '/');
@@ -552,58 +1494,160 @@ wf_error_t wf_obj_parse_file(wf_obj_parser_t* parser, const char* filename) {
     }
   }
 
-  parser->line_buffer = malloc(parser->line_capacity);
-  if (!parser->line_buffer) {
+  wf_error_t  result;
+  const char* data = NULL;
+  size_t      size = 0;
+  if (parser->options->io) {
+    result = wf_obj_parse_data(parser, buffer.data, buffer.size);
+    wf_io_release(&buffer);
+  } else if (parser->options->use_mmap
+             && wf_map_file(parser->file, &data, &size) == 0) {
+    LOG_DEBUG("Parsing memory-mapped file (%zu bytes)", size);
+    result = wf_obj_parse_data(parser, data, size);
+    wf_unmap_file(data, size);
+  } else {
+    result = WF_SUCCESS;
+    if (parser->options->size_hints && !parser->stream)
+      result = wf_obj_reserve_geometry(parser, parser->options->size_hints);
+    if (result == WF_SUCCESS)
+      result = wf_obj_parse_stream(parser);
+  }
+
+  if (parser->file)
     fclose(parser->file);
-    LOG_ERROR("Out of memory allocating line buffer");
-    return WF_ERROR_OUT_OF_MEMORY;
+  parser->file = NULL;
+  if (result == WF_SUCCESS && !parser->stream)
+    result = wf_finish_objects(parser);
+  wf_cleanup_parser_state(parser);
+
+  if (result == WF_SUCCESS) {
+    LOG_INFO("Successfully parsed OBJ file: %s", filename);
   }
 
-  wf_error_t result = WF_SUCCESS;
-  while (fgets(parser->line_buffer, (int)parser->line_capacity, parser->file)) {
-    parser->line_number++;
-    char* line = wf_trim(parser->line_buffer);
-    if (*line == '\0' || *line == '#')
-      continue;
+  return result;
+}
 
-    const wf_command_t* cmd          = WF_COMMANDS;
-    wf_line_handler_t   handler      = NULL;
-    const char*         handler_line = line;
+// Parse OBJ data supplied by the caller; mtllib names are used as written
+wf_error_t wf_obj_parse_memory(wf_obj_parser_t* parser, const char* data,
+                               size_t size) {
+  LOG_INFO("Starting OBJ parsing from memory (%zu bytes)", size);
+  wf_error_t result = wf_obj_parse_data(parser, data, size);
+  if (result == WF_SUCCESS && !parser->stream)
+    result = wf_finish_objects(parser);
+  wf_cleanup_parser_state(parser);
+  return result;
+}
 
-    while (cmd->command != NULL) {
-      if (strncmp(line, cmd->command, cmd->command_len) == 0) {
-        handler      = cmd->handler;
-        handler_line = line + cmd->command_len;
-        while (*handler_line == ' ' || *handler_line == '\t') {
-          handler_line++;
-        }
-        break;
-      }
-      cmd++;
-    }
+// Parse a file with elements reported to callbacks instead of stored
+wf_error_t wf_obj_stream_file(wf_obj_parser_t* parser, const char* filename,
+                              const wf_callbacks_t* callbacks, void* user) {
+  wf_obj_stream_t* stream = calloc(1, sizeof(wf_obj_stream_t));
+  if (!stream)
+    return WF_ERROR_OUT_OF_MEMORY;
+  stream->callbacks = callbacks;
+  stream->user      = user;
+  parser->stream    = stream;
+
+  wf_error_t result = wf_obj_parse_file(parser, filename);
+  if (result == WF_SUCCESS)
+    result = wf_stream_flush(parser);
+
+  parser->stream = NULL;
+  free(stream->corners);
+  free(stream->name);
+  free(stream);
+  return result;
+}
 
-    if (handler) {
-      LOG_DEBUG("handle command %s @%zu: [%s]", cmd->command,
-                parser->line_number, parser->line_buffer);
-      result = handler(parser, handler_line);
-    } else if (parser->options->strict_mode) {
-      wf_set_error_with_line(parser, "Unsupported command: %.50s", line);
-      result = WF_ERROR_UNSUPPORTED_FEATURE;
-    } else {
-      LOG_ERROR("Ignoring unsupported command at line %zu: %.50s",
-                parser->line_number, line);
-    }
+// Push parsing appends to whatever the scene already holds: negative
+// indices resolve against its elements and faces go to new objects
+wf_error_t wf_obj_push_begin(wf_obj_parser_t* parser, wf_scene_t* scene,
+                             const wf_parse_options_t* options) {
+  memset(parser, 0, sizeof(wf_obj_parser_t));
+  parser->options          = options;
+  parser->scene            = scene;
+  parser->current_material = WF_MATERIAL_NONE;
+  parser->bounds           = wf_aabb_empty();
+  for (wf_object_t* obj = scene->objects; obj; obj = obj->next)
+    parser->last_object = obj;
+  if (options->compute_bounds) {
+    parser->bounds = scene->has_bounds
+                       ? scene->bounds
+                       : wf_bounds_vertices(scene, 0, scene->vertex_count);
+  }
+  if (options->size_hints)
+    return wf_obj_reserve_geometry(parser, options->size_hints);
+  return WF_SUCCESS;
+}
 
-    if (result != WF_SUCCESS)
-      break;
+// Append to the partial line, keeping it NUL-terminated
+static wf_error_t wf_obj_push_partial(wf_obj_parser_t* parser,
+                                      const char* data, size_t size) {
+  char* buf = wf_realloc_array(parser->line_buffer, &parser->line_capacity,
+                               parser->line_length + size + 1, 1);
+  if (!buf) {
+    wf_set_error_with_line(parser, "Out of memory while reading line");
+    return WF_ERROR_OUT_OF_MEMORY;
   }
+  memcpy(buf + parser->line_length, data, size);
+  parser->line_buffer = buf;
+  parser->line_length += size;
+  parser->line_buffer[parser->line_length] = '\0';
+  return WF_SUCCESS;
+}
 
-  fclose(parser->file);
-  wf_cleanup_parser_state(parser);
+static wf_error_t wf_obj_push_line(wf_obj_parser_t* parser) {
+  size_t length       = parser->line_length;
+  parser->line_length = 0;
+  parser->line_number++;
+  return wf_obj_parse_line(parser, parser->line_buffer,
+                           parser->line_buffer + length);
+}
 
-  if (result == WF_SUCCESS) {
-    LOG_INFO("Successfully parsed OBJ file: %s", filename);
+// Complete lines are parsed in place; only the line left unfinished at the
+// end of data is copied, to be completed by the next call
+wf_error_t wf_obj_push_data(wf_obj_parser_t* parser, const char* data,
+                            size_t size) {
+  const char* p     = data;
+  const char* limit = data + size;
+  wf_error_t  result;
+
+  if (parser->line_length) {
+    const char* nl = memchr(p, '\n', size);
+    result = wf_obj_push_partial(parser, p, nl ? (size_t)(nl - p) : size);
+    if (result != WF_SUCCESS || !nl)
+      return result;
+    result = wf_obj_push_line(parser);
+    if (result != WF_SUCCESS)
+      return result;
+    p = nl + 1;
+  }
+
+  while (p < limit) {
+    const char* nl = memchr(p, '\n', limit - p);
+    if (!nl)
+      return wf_obj_push_partial(parser, p, limit - p);
+    parser->line_number++;
+    result = wf_obj_parse_line(parser, p, nl);
+    if (result != WF_SUCCESS)
+      return result;
+    p = nl + 1;
   }
+  return WF_SUCCESS;
+}
 
+// Parse an unterminated last line and finish the scene
+wf_error_t wf_obj_push_end(wf_obj_parser_t* parser) {
+  wf_error_t result = WF_SUCCESS;
+  if (parser->line_length)
+    result = wf_obj_push_line(parser);
+  if (result == WF_SUCCESS)
+    result = wf_finish_objects(parser);
+  wf_cleanup_parser_state(parser);
   return result;
 }
+
+// Release the parser after an error, leaving the scene as parsed so far
+void wf_obj_push_abort(wf_obj_parser_t* parser) {
+  wf_cleanup_parser_state(parser);
+}
@@ -2,6 +2,7 @@
 #ifndef OBJ_PARSER_H
 #define OBJ_PARSER_H
 
+#include <limits.h>
 #include <stdio.h>
 #include "wavefront.h"
 
@@ -9,57 +10,177 @@
 extern "C" {
 #endif
 
-typedef wf_error_t (*wf_line_handler_t)(void* parser, const char* line);
+typedef wf_error_t (*wf_line_handler_t)(void* parser, const char* line,
+                                        const char* end);
 
+// mtllib/usemtl statement recorded by a chunk worker and replayed in file
+// order once all chunks are parsed
 typedef struct {
-  const char*       command;
-  size_t            command_len;
-  wf_line_handler_t handler;
-} wf_command_t;
+  int    is_mtllib; /**< 1 for mtllib, 0 for usemtl */
+  char*  name;
+  size_t line_number;
+  size_t material_idx; /**< usemtl result, set on replay */
+} wf_obj_deferred_t;
+
+// Material of faces without usemtl
+#define WF_MATERIAL_NONE ((size_t)-1)
+
+// Run materials while a chunk is parsed, before its usemtl statements can be
+// resolved: the material current where the chunk starts, or the usemtl with
+// deferred index k
+#define WF_MATERIAL_INHERIT        ((size_t)-2)
+#define WF_MATERIAL_DEFERRED(k)    ((size_t)-3 - (k))
+#define WF_MATERIAL_DEFERRED_AT(m) ((size_t)-3 - (m))
+
+// Smoothing group of faces a chunk parses before its first s statement,
+// replaced on merge by the group current where the chunk starts
+#define WF_SMOOTHING_INHERIT UINT_MAX
+
+// Elements buffered before a batch callback
+#define WF_STREAM_BATCH 256
+
+typedef enum {
+  WF_STREAM_NONE = 0,
+  WF_STREAM_VERTICES,
+  WF_STREAM_TEXCOORDS,
+  WF_STREAM_NORMALS,
+  WF_STREAM_PARAMETERS
+} wf_stream_kind_t;
+
+// Streaming state: pending batch plus scratch space reused for every line
+typedef struct {
+  const wf_callbacks_t* callbacks;
+  void*                 user;
+  wf_stream_kind_t      kind;
+  size_t                count;
+  wf_vec3               vec3[WF_STREAM_BATCH];
+  wf_vec4               vec4[WF_STREAM_BATCH];
+  wf_vertex_index*      corners;
+  size_t                corner_cap;
+  char*                 name;
+  size_t                name_cap;
+} wf_obj_stream_t;
 
 typedef struct {
   FILE*                     file;
   char*                     line_buffer;
   size_t                    line_capacity;
+  size_t                    line_length; /**< Push parsing: partial line */
   size_t                    line_number;
   const wf_parse_options_t* options;
   wf_scene_t*               scene;
   char*                     current_mtl_dir;
   char*                     current_object_name;
   wf_object_t*              current_object;
+  wf_object_t*              last_object; /**< Tail of scene->objects */
+  size_t                    current_material; /**< Applies to new objects */
+  unsigned                  current_smoothing; /**< Applies to new faces */
+
+  // Chunked parsing: running counts of earlier chunks, used to resolve
+  // face indices against the whole file
+  size_t             vertex_base;
+  size_t             texcoord_base;
+  size_t             normal_base;
+  int                implicit_first_object;
+  int                defer_materials;
+  wf_obj_deferred_t* deferred;
+  size_t             deferred_count;
+  size_t             deferred_cap;
+
+  // Pre-sizing: exact face count of each object in creation order, slot 0
+  // being the implicit object before the first o/g
+  size_t* object_faces;
+  size_t  object_faces_count;
+  size_t  object_ordinal;
+
+  // Set by wf_parse_stream: elements go to callbacks instead of the scene,
+  // which then only tracks counts
+  wf_obj_stream_t* stream;
+
+  // Box of the vertices parsed so far, kept with options->compute_bounds
+  wf_aabb_t bounds;
 } wf_obj_parser_t;
 
+// Per-command line counts from a counting pass
+typedef struct {
+  size_t lines;
+  size_t vertices;
+  size_t texcoords;
+  size_t normals;
+  size_t parameters;
+} wf_obj_counts_t;
+
 wf_error_t wf_obj_parse_file(wf_obj_parser_t* parser, const char* filename);
+wf_error_t wf_obj_parse_memory(wf_obj_parser_t* parser, const char* data,
+                               size_t size);
+wf_error_t wf_obj_stream_file(wf_obj_parser_t* parser, const char* filename,
+                              const wf_callbacks_t* callbacks, void* user);
+wf_error_t wf_obj_push_begin(wf_obj_parser_t* parser, wf_scene_t* scene,
+                             const wf_parse_options_t* options);
+wf_error_t wf_obj_push_data(wf_obj_parser_t* parser, const char* data,
+                            size_t size);
+wf_error_t wf_obj_push_end(wf_obj_parser_t* parser);
+void       wf_obj_push_abort(wf_obj_parser_t* parser);
 
 // Forward declarations
-static wf_error_t wf_handle_vertex(void* parser, const char* line);
-static wf_error_t wf_handle_texcoord(void* parser, const char* line);
-static wf_error_t wf_handle_normal(void* parser, const char* line);
-static wf_error_t wf_handle_parameter(void* parser, const char* line);
-static wf_error_t wf_handle_face(void* parser, const char* line);
-static wf_error_t wf_handle_object(void* parser, const char* line);
-static wf_error_t wf_handle_group(void* parser, const char* line);
-static wf_error_t wf_handle_mtllib(void* parser, const char* line);
-static wf_error_t wf_handle_usemtl(void* parser, const char* line);
-static wf_error_t wf_handle_smoothing(void* parser, const char* line);
-static wf_error_t wf_handle_line_elem(void* parser, const char* line);
-static wf_error_t wf_handle_freeform(void* parser, const char* line);
+static wf_error_t wf_handle_vertex(void* parser, const char* line,
+                                   const char* end);
+static wf_error_t wf_handle_texcoord(void* parser, const char* line,
+                                     const char* end);
+static wf_error_t wf_handle_normal(void* parser, const char* line,
+                                   const char* end);
+static wf_error_t wf_handle_parameter(void* parser, const char* line,
+                                      const char* end);
+static wf_error_t wf_handle_face(void* parser, const char* line,
+                                 const char* end);
+static wf_error_t wf_handle_object(void* parser, const char* line,
+                                   const char* end);
+static wf_error_t wf_handle_group(void* parser, const char* line,
+                                  const char* end);
+static wf_error_t wf_handle_mtllib(void* parser, const char* line,
+                                   const char* end);
+static wf_error_t wf_handle_usemtl(void* parser, const char* line,
+                                   const char* end);
+static wf_error_t wf_handle_smoothing(void* parser, const char* line,
+                                      const char* end);
+static wf_error_t wf_handle_line_elem(void* parser, const char* line,
+                                      const char* end);
+static wf_error_t wf_handle_freeform(void* parser, const char* line,
+                                     const char* end);
 
 // Helper function declarations
 static wf_error_t wf_ensure_current_object(wf_obj_parser_t* parser);
 static wf_error_t wf_add_object_to_list(wf_obj_parser_t* parser,
                                         wf_object_t*     obj);
 static wf_error_t wf_parse_vertex_data(wf_obj_parser_t* parser,
-                                       const char* line, wf_vec3* vertex,
-                                       size_t* count, wf_vec3** array,
-                                       size_t* cap, size_t elem_size);
-static wf_error_t wf_parse_face_indices(wf_obj_parser_t*  parser,
-                                        const char*       line,
-                                        wf_vertex_index** indices,
-                                        size_t*           idx_count);
-static wf_error_t wf_add_faces_to_object(wf_obj_parser_t* parser,
-                                         wf_vertex_index* indices,
-                                         size_t           idx_count);
+                                       const char* line, const char* end,
+                                       wf_vec3* vertex, size_t* count,
+                                       wf_vec3** array, size_t* cap,
+                                       size_t           elem_size,
+                                       wf_stream_kind_t kind);
+static void       wf_parse_face_index(const wf_obj_parser_t* parser,
+                                      const char* token, const char* end,
+                                      wf_vertex_index* idx);
+static const char* wf_next_face_index(const wf_obj_parser_t* parser,
+                                      const char* p, const char* end,
+                                      wf_vertex_index* idx);
+static wf_error_t wf_stream_push(wf_obj_parser_t* parser,
+                                 wf_stream_kind_t kind, wf_vec4 v);
+static wf_error_t wf_stream_face(wf_obj_parser_t* parser, const char* line,
+                                 const char* end);
+static wf_error_t wf_stream_object(wf_obj_parser_t* parser, const char* line,
+                                   const char* end, int is_group);
+static wf_error_t wf_stream_name(wf_obj_parser_t* parser,
+                                 int (*callback)(void*, const char*),
+                                 const char* line, const char* end);
+static wf_error_t wf_push_face(wf_obj_parser_t* parser, wf_vertex_index a,
+                               wf_vertex_index b, wf_vertex_index c);
+static void       wf_reserve_object_faces(wf_obj_parser_t* parser,
+                                          wf_object_t* obj, size_t ordinal);
+static wf_error_t wf_begin_material_run(wf_obj_parser_t* parser,
+                                        wf_object_t* obj, size_t material);
+static wf_error_t wf_finish_material_runs(wf_obj_parser_t* parser);
+static wf_error_t wf_finish_objects(wf_obj_parser_t* parser);
 static char* wf_build_full_path(const char* base_dir, const char* filename);
 static void  wf_cleanup_parser_state(wf_obj_parser_t* parser);
 
@@ -0,0 +1,289 @@
+// src/quantize.c
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bounds.h"
+#include "log.h"
+#include "wavefront.h"
+
+// Round to nearest even, overflowing to infinity (F. Giesen's
+// float_to_half_fast3_rtne)
+static uint16_t wf_float_to_half(float value) {
+  const uint32_t f32_infinity = 255u << 23;
+  const uint32_t f16_max      = (127u + 16u) << 23;
+  const uint32_t denorm_bits  = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+  float          denorm_magic;
+  uint32_t       u;
+  memcpy(&denorm_magic, &denorm_bits, sizeof(float));
+  memcpy(&u, &value, sizeof(float));
+
+  uint32_t sign = u & 0x80000000u;
+  uint16_t h;
+  u ^= sign;
+  if (u >= f16_max) {
+    h = u > f32_infinity ? 0x7E00 : 0x7C00;
+  } else if (u < (113u << 23)) {
+    // Subnormal half: let the FPU round by adding a magic number
+    float f;
+    memcpy(&f, &u, sizeof(float));
+    f += denorm_magic;
+    memcpy(&u, &f, sizeof(float));
+    h = (uint16_t)(u - denorm_bits);
+  } else {
+    uint32_t odd = (u >> 13) & 1u;
+    u += ((15u - 127u) << 23) + 0xFFFu + odd;
+    h = (uint16_t)(u >> 13);
+  }
+  return h | (uint16_t)(sign >> 16);
+}
+
+static float wf_half_to_float(uint16_t h) {
+  uint32_t exponent = (h >> 10) & 0x1Fu;
+  uint32_t mantissa = h & 0x3FFu;
+  float    f;
+  if (exponent == 31) {
+    uint32_t u = ((uint32_t)(h & 0x8000u) << 16) | 0x7F800000u
+               | (mantissa << 13);
+    memcpy(&f, &u, sizeof(float));
+    return f;
+  }
+  if (exponent == 0)
+    f = ldexpf((float)mantissa, -24);
+  else
+    f = ldexpf((float)(mantissa | 0x400u), (int)exponent - 25);
+  return h & 0x8000u ? -f : f;
+}
+
+static uint16_t wf_unorm16(float value, float offset, float scale) {
+  if (!(scale > 0.0f))
+    return 0;
+  float q = (value - offset) / scale * 65535.0f;
+  q       = q < 0.0f ? 0.0f : q > 65535.0f ? 65535.0f : q;
+  return (uint16_t)lrintf(q);
+}
+
+static float wf_from_unorm16(uint16_t q, float offset, float scale) {
+  return offset + (float)q / 65535.0f * scale;
+}
+
+static float wf_sign(float x) {
+  return x < 0.0f ? -1.0f : 1.0f;
+}
+
+static wf_vec3 wf_oct_decode(int16_t qx, int16_t qy) {
+  float x = qx / 32767.0f;
+  float y = qy / 32767.0f;
+  float z = 1.0f - fabsf(x) - fabsf(y);
+  if (z < 0.0f) {
+    float ox = (1.0f - fabsf(y)) * wf_sign(x);
+    y        = (1.0f - fabsf(x)) * wf_sign(y);
+    x        = ox;
+  }
+  float length = sqrtf(x * x + y * y + z * z);
+  return (wf_vec3){ x / length, y / length, z / length };
+}
+
+// Angle between a and b. Unlike acos of the dot product, this stays
+// accurate for nearly parallel vectors.
+static float wf_angle(wf_vec3 a, wf_vec3 b) {
+  float cx = a.y * b.z - a.z * b.y;
+  float cy = a.z * b.x - a.x * b.z;
+  float cz = a.x * b.y - a.y * b.x;
+  return atan2f(sqrtf(cx * cx + cy * cy + cz * cz),
+                a.x * b.x + a.y * b.y + a.z * b.z);
+}
+
+// Octahedral encoding. Of the four snorm16 points around the exact one,
+// keep the one that decodes closest to n.
+static void wf_oct_encode(wf_vec3 n, int16_t* out) {
+  float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+  if (!(l1 > 0.0f)) {
+    out[0] = out[1] = 0;
+    return;
+  }
+  float x = n.x / l1;
+  float y = n.y / l1;
+  if (n.z < 0.0f) {
+    float ox = (1.0f - fabsf(y)) * wf_sign(x);
+    y        = (1.0f - fabsf(x)) * wf_sign(y);
+    x        = ox;
+  }
+
+  float best = 4.0f;
+  for (int i = 0; i < 4; i++) {
+    float   fx    = (i & 1 ? ceilf(x * 32767.0f) : floorf(x * 32767.0f));
+    float   fy    = (i & 2 ? ceilf(y * 32767.0f) : floorf(y * 32767.0f));
+    int16_t qx    = (int16_t)(fx < -32767.0f ? -32767.0f : fx);
+    int16_t qy    = (int16_t)(fy < -32767.0f ? -32767.0f : fy);
+    float   angle = wf_angle(wf_oct_decode(qx, qy), n);
+    if (angle < best) {
+      best   = angle;
+      out[0] = qx;
+      out[1] = qy;
+    }
+  }
+}
+
+wf_vec3 wf_quantized_position(const wf_quantized_scene_t* quantized,
+                              size_t                      i) {
+  const wf_quantize_header_t* h = &quantized->header;
+  const uint16_t*             q = &quantized->positions[3 * i];
+  if (h->position_format == WF_POSITION_HALF)
+    return (wf_vec3){ wf_half_to_float(q[0]), wf_half_to_float(q[1]),
+                      wf_half_to_float(q[2]) };
+  return (wf_vec3){
+    wf_from_unorm16(q[0], h->position_offset[0], h->position_scale[0]),
+    wf_from_unorm16(q[1], h->position_offset[1], h->position_scale[1]),
+    wf_from_unorm16(q[2], h->position_offset[2], h->position_scale[2])
+  };
+}
+
+wf_vec3 wf_quantized_texcoord(const wf_quantized_scene_t* quantized,
+                              size_t                      i) {
+  const wf_quantize_header_t* h = &quantized->header;
+  const uint16_t*             q = &quantized->texcoords[2 * i];
+  if (h->texcoord_format == WF_TEXCOORD_HALF)
+    return (wf_vec3){ wf_half_to_float(q[0]), wf_half_to_float(q[1]), 0.0f };
+  return (wf_vec3){
+    wf_from_unorm16(q[0], h->texcoord_offset[0], h->texcoord_scale[0]),
+    wf_from_unorm16(q[1], h->texcoord_offset[1], h->texcoord_scale[1]), 0.0f
+  };
+}
+
+wf_vec3 wf_quantized_normal(const wf_quantized_scene_t* quantized, size_t i) {
+  return wf_oct_decode(quantized->normals[2 * i],
+                       quantized->normals[2 * i + 1]);
+}
+
+static float wf_max_error(float error, float a, float b) {
+  float d = fabsf(a - b);
+  return d > error ? d : error;
+}
+
+static void wf_quantize_positions(const wf_scene_t*     scene,
+                                  wf_quantized_scene_t* q) {
+  wf_quantize_header_t* h = &q->header;
+  wf_aabb_t box = wf_bounds_vertices(scene, 0, scene->vertex_count);
+  if (scene->vertex_count) {
+    h->position_offset[0] = box.min.x;
+    h->position_offset[1] = box.min.y;
+    h->position_offset[2] = box.min.z;
+    h->position_scale[0]  = box.max.x - box.min.x;
+    h->position_scale[1]  = box.max.y - box.min.y;
+    h->position_scale[2]  = box.max.z - box.min.z;
+  }
+
+  for (size_t i = 0; i < scene->vertex_count; i++) {
+    wf_vec3   v    = wf_scene_vertex(scene, i);
+    float     c[3] = { v.x, v.y, v.z };
+    uint16_t* out  = &q->positions[3 * i];
+    for (int k = 0; k < 3; k++) {
+      out[k] = h->position_format == WF_POSITION_HALF
+                 ? wf_float_to_half(c[k])
+                 : wf_unorm16(c[k], h->position_offset[k],
+                              h->position_scale[k]);
+    }
+    wf_vec3 d         = wf_quantized_position(q, i);
+    h->position_error = wf_max_error(h->position_error, d.x, v.x);
+    h->position_error = wf_max_error(h->position_error, d.y, v.y);
+    h->position_error = wf_max_error(h->position_error, d.z, v.z);
+  }
+}
+
+static void wf_quantize_texcoords(const wf_scene_t*     scene,
+                                  wf_quantized_scene_t* q) {
+  wf_quantize_header_t* h     = &q->header;
+  float                 lo[2] = { 0.0f, 0.0f }, hi[2] = { 0.0f, 0.0f };
+  for (size_t i = 0; i < scene->texcoord_count; i++) {
+    wf_vec3 t = wf_scene_texcoord(scene, i);
+    if (i == 0 || t.x < lo[0])
+      lo[0] = t.x;
+    if (i == 0 || t.y < lo[1])
+      lo[1] = t.y;
+    if (i == 0 || t.x > hi[0])
+      hi[0] = t.x;
+    if (i == 0 || t.y > hi[1])
+      hi[1] = t.y;
+  }
+  for (int k = 0; k < 2; k++) {
+    h->texcoord_offset[k] = lo[k];
+    h->texcoord_scale[k]  = hi[k] - lo[k];
+  }
+
+  for (size_t i = 0; i < scene->texcoord_count; i++) {
+    wf_vec3   t    = wf_scene_texcoord(scene, i);
+    float     c[2] = { t.x, t.y };
+    uint16_t* out  = &q->texcoords[2 * i];
+    for (int k = 0; k < 2; k++) {
+      out[k] = h->texcoord_format == WF_TEXCOORD_HALF
+                 ? wf_float_to_half(c[k])
+                 : wf_unorm16(c[k], h->texcoord_offset[k],
+                              h->texcoord_scale[k]);
+    }
+    wf_vec3 d         = wf_quantized_texcoord(q, i);
+    h->texcoord_error = wf_max_error(h->texcoord_error, d.x, t.x);
+    h->texcoord_error = wf_max_error(h->texcoord_error, d.y, t.y);
+  }
+}
+
+static void wf_quantize_normals(const wf_scene_t*     scene,
+                                wf_quantized_scene_t* q) {
+  for (size_t i = 0; i < scene->normal_count; i++) {
+    wf_vec3 n = wf_scene_normal(scene, i);
+    wf_oct_encode(n, &q->normals[2 * i]);
+    if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+      continue;
+
+    float a = wf_angle(wf_quantized_normal(q, i), n);
+    if (a > q->header.normal_error)
+      q->header.normal_error = a;
+  }
+}
+
+wf_error_t wf_scene_quantize(const wf_scene_t*            scene,
+                             const wf_quantize_options_t* options,
+                             wf_quantized_scene_t*        quantized) {
+  if (!scene || !quantized) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  memset(quantized, 0, sizeof(wf_quantized_scene_t));
+  if (options) {
+    quantized->header.position_format = options->position_format;
+    quantized->header.texcoord_format = options->texcoord_format;
+  }
+
+  quantized->positions = malloc((3 * scene->vertex_count + 1)
+                                * sizeof(uint16_t));
+  quantized->texcoords = malloc((2 * scene->texcoord_count + 1)
+                                * sizeof(uint16_t));
+  quantized->normals   = malloc((2 * scene->normal_count + 1)
+                                * sizeof(int16_t));
+  if (!quantized->positions || !quantized->texcoords || !quantized->normals) {
+    wf_free_quantized_scene(quantized);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  quantized->vertex_count   = scene->vertex_count;
+  quantized->texcoord_count = scene->texcoord_count;
+  quantized->normal_count   = scene->normal_count;
+
+  wf_quantize_positions(scene, quantized);
+  wf_quantize_texcoords(scene, quantized);
+  wf_quantize_normals(scene, quantized);
+
+  const wf_quantize_header_t* h = &quantized->header;
+  LOG_INFO("Quantized %zu positions (error %g), %zu texture coordinates "
+           "(error %g), %zu normals (error %g rad)",
+           quantized->vertex_count, h->position_error,
+           quantized->texcoord_count, h->texcoord_error,
+           quantized->normal_count, h->normal_error);
+  return WF_SUCCESS;
+}
+
+void wf_free_quantized_scene(wf_quantized_scene_t* quantized) {
+  if (!quantized)
+    return;
+  free(quantized->positions);
+  free(quantized->texcoords);
+  free(quantized->normals);
+  memset(quantized, 0, sizeof(wf_quantized_scene_t));
+}
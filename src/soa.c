@@ -0,0 +1,140 @@
+// src/soa.c
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "lib.h"
+#include "wavefront.h"
+
+// Split count vec3 into one aligned block holding xs, ys and zs back to back
+static wf_error_t wf_soa3_from_aos(const wf_vec3* aos, size_t count,
+                                   size_t alignment, wf_soa3_t* soa) {
+  size_t lanes  = alignment / sizeof(float);
+  size_t padded = (count + lanes - 1) / lanes * lanes;
+  float* block  = wf_aligned_alloc(alignment, 3 * padded * sizeof(float));
+  if (!block)
+    return WF_ERROR_OUT_OF_MEMORY;
+
+  float* xs = block;
+  float* ys = xs + padded;
+  float* zs = ys + padded;
+  for (size_t i = 0; i < count; i++) {
+    xs[i] = aos[i].x;
+    ys[i] = aos[i].y;
+    zs[i] = aos[i].z;
+  }
+  for (size_t i = count; i < padded; i++)
+    xs[i] = ys[i] = zs[i] = 0.0f;
+
+  soa->xs           = xs;
+  soa->ys           = ys;
+  soa->zs           = zs;
+  soa->count        = count;
+  soa->padded_count = padded;
+  return WF_SUCCESS;
+}
+
+static wf_vec3* wf_soa3_to_aos(wf_arena_t* arena, const wf_soa3_t* soa) {
+  wf_vec3* aos = wf_arena_alloc(arena, (soa->count ? soa->count : 1)
+                                           * sizeof(wf_vec3));
+  if (!aos)
+    return NULL;
+  for (size_t i = 0; i < soa->count; i++)
+    aos[i] = (wf_vec3){ soa->xs[i], soa->ys[i], soa->zs[i] };
+  return aos;
+}
+
+static void wf_soa3_free(wf_soa3_t* soa) {
+  wf_aligned_free(soa->xs);
+  memset(soa, 0, sizeof(wf_soa3_t));
+}
+
+wf_error_t wf_scene_convert_to_soa(wf_scene_t* scene, size_t alignment) {
+  if (!scene || (alignment != 16 && alignment != 32 && alignment != 64)) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  if (scene->soa.alignment == alignment)
+    return WF_SUCCESS;
+  wf_error_t result = wf_scene_convert_to_aos(scene);
+  if (result != WF_SUCCESS)
+    return result;
+
+  wf_soa3_t vertices = { 0 }, texcoords = { 0 }, normals = { 0 };
+  result = wf_soa3_from_aos(scene->vertices, scene->vertex_count, alignment,
+                            &vertices);
+  if (result == WF_SUCCESS)
+    result = wf_soa3_from_aos(scene->texcoords, scene->texcoord_count,
+                              alignment, &texcoords);
+  if (result == WF_SUCCESS)
+    result = wf_soa3_from_aos(scene->normals, scene->normal_count, alignment,
+                              &normals);
+  if (result != WF_SUCCESS) {
+    wf_soa3_free(&vertices);
+    wf_soa3_free(&texcoords);
+    wf_soa3_free(&normals);
+    return result;
+  }
+
+  wf_arena_free(scene->arena, scene->vertices);
+  wf_arena_free(scene->arena, scene->texcoords);
+  wf_arena_free(scene->arena, scene->normals);
+  scene->vertices      = NULL;
+  scene->texcoords     = NULL;
+  scene->normals       = NULL;
+  scene->vertex_cap    = 0;
+  scene->texcoord_cap  = 0;
+  scene->normal_cap    = 0;
+  scene->soa.vertices  = vertices;
+  scene->soa.texcoords = texcoords;
+  scene->soa.normals   = normals;
+  scene->soa.alignment = alignment;
+  return WF_SUCCESS;
+}
+
+wf_error_t wf_scene_convert_to_aos(wf_scene_t* scene) {
+  if (!scene) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  if (!scene->soa.alignment)
+    return WF_SUCCESS;
+
+  wf_vec3* vertices  = wf_soa3_to_aos(scene->arena, &scene->soa.vertices);
+  wf_vec3* texcoords = wf_soa3_to_aos(scene->arena, &scene->soa.texcoords);
+  wf_vec3* normals   = wf_soa3_to_aos(scene->arena, &scene->soa.normals);
+  if (!vertices || !texcoords || !normals) {
+    wf_arena_free(scene->arena, vertices);
+    wf_arena_free(scene->arena, texcoords);
+    wf_arena_free(scene->arena, normals);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+
+  scene->vertices     = vertices;
+  scene->texcoords    = texcoords;
+  scene->normals      = normals;
+  scene->vertex_cap   = scene->vertex_count;
+  scene->texcoord_cap = scene->texcoord_count;
+  scene->normal_cap   = scene->normal_count;
+  wf_soa3_free(&scene->soa.vertices);
+  wf_soa3_free(&scene->soa.texcoords);
+  wf_soa3_free(&scene->soa.normals);
+  scene->soa.alignment = 0;
+  return WF_SUCCESS;
+}
+
+static wf_vec3 wf_soa3_get(const wf_soa3_t* soa, size_t i) {
+  return (wf_vec3){ soa->xs[i], soa->ys[i], soa->zs[i] };
+}
+
+wf_vec3 wf_scene_vertex(const wf_scene_t* scene, size_t i) {
+  return scene->soa.alignment ? wf_soa3_get(&scene->soa.vertices, i)
+                              : scene->vertices[i];
+}
+
+wf_vec3 wf_scene_texcoord(const wf_scene_t* scene, size_t i) {
+  return scene->soa.alignment ? wf_soa3_get(&scene->soa.texcoords, i)
+                              : scene->texcoords[i];
+}
+
+wf_vec3 wf_scene_normal(const wf_scene_t* scene, size_t i) {
+  return scene->soa.alignment ? wf_soa3_get(&scene->soa.normals, i)
+                              : scene->normals[i];
+}
@@ -0,0 +1,140 @@
+// src/thread_pool.c
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct wf_task_s {
+  wf_task_fn_t      fn;
+  void*             arg;
+  struct wf_task_s* next;
+} wf_task_t;
+
+struct wf_thread_pool_s {
+  pthread_t*      threads;
+  size_t          thread_count;
+  wf_task_t*      head;
+  wf_task_t*      tail;
+  size_t          pending; /**< Queued plus running tasks */
+  int             stop;
+  pthread_mutex_t lock;
+  pthread_cond_t  work_cond;
+  pthread_cond_t  done_cond;
+};
+
+size_t wf_cpu_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return (size_t)n;
+#endif
+  return 1;
+}
+
+static void* wf_thread_pool_worker(void* arg) {
+  wf_thread_pool_t* pool = (wf_thread_pool_t*)arg;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->head && !pool->stop)
+      pthread_cond_wait(&pool->work_cond, &pool->lock);
+    if (!pool->head)
+      break;
+
+    wf_task_t* task = pool->head;
+    pool->head      = task->next;
+    if (!pool->head)
+      pool->tail = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    task->fn(task->arg);
+    free(task);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0)
+      pthread_cond_broadcast(&pool->done_cond);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+wf_thread_pool_t* wf_thread_pool_create(size_t thread_count) {
+  if (thread_count == 0)
+    thread_count = wf_cpu_count();
+
+  wf_thread_pool_t* pool = calloc(1, sizeof(wf_thread_pool_t));
+  if (!pool)
+    return NULL;
+  pool->threads = calloc(thread_count, sizeof(pthread_t));
+  if (!pool->threads) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  for (size_t i = 0; i < thread_count; i++) {
+    if (pthread_create(&pool->threads[i], NULL, wf_thread_pool_worker, pool)
+        != 0) {
+      break;
+    }
+    pool->thread_count++;
+  }
+  if (pool->thread_count == 0) {
+    wf_thread_pool_destroy(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+int wf_thread_pool_submit(wf_thread_pool_t* pool, wf_task_fn_t fn, void* arg) {
+  wf_task_t* task = malloc(sizeof(wf_task_t));
+  if (!task)
+    return -1;
+  task->fn   = fn;
+  task->arg  = arg;
+  task->next = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail)
+    pool->tail->next = task;
+  else
+    pool->head = task;
+  pool->tail = task;
+  pool->pending++;
+  pthread_cond_signal(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+void wf_thread_pool_wait(wf_thread_pool_t* pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0)
+    pthread_cond_wait(&pool->done_cond, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void wf_thread_pool_destroy(wf_thread_pool_t* pool) {
+  if (!pool)
+    return;
+
+  wf_thread_pool_wait(pool);
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->thread_count; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->threads);
+  free(pool);
+}
+
+size_t wf_thread_pool_size(const wf_thread_pool_t* pool) {
+  return pool ? pool->thread_count : 0;
+}
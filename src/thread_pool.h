@@ -0,0 +1,35 @@
+// src/thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct wf_thread_pool_s wf_thread_pool_t;
+typedef void (*wf_task_fn_t)(void* arg);
+
+// Number of online processors, at least 1
+size_t wf_cpu_count(void);
+
+// Create a pool with thread_count workers (0 means one per processor)
+wf_thread_pool_t* wf_thread_pool_create(size_t thread_count);
+
+// Queue a task; returns 0 on success, -1 when out of memory
+int wf_thread_pool_submit(wf_thread_pool_t* pool, wf_task_fn_t fn, void* arg);
+
+// Block until every submitted task has finished
+void wf_thread_pool_wait(wf_thread_pool_t* pool);
+
+// Wait for pending tasks, then stop and join the workers
+void wf_thread_pool_destroy(wf_thread_pool_t* pool);
+
+size_t wf_thread_pool_size(const wf_thread_pool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // THREAD_POOL_H
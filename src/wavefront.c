@@ -3,8 +3,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include "log4c.h"
+#include "arena.h"
+#include "bounds.h"
+#include "lib.h"
+#include "log.h"
+#include "material_run.h"
 #include "mtl_parser.h"
+#include "name_index.h"
 #include "obj_parser.h"
 
 static const wf_parse_options_t DEFAULT_OPTIONS       = { .triangulate      = 1,
@@ -12,7 +17,18 @@ static const wf_parse_options_t DEFAULT_OPTIONS       = { .triangulate      = 1,
                                                           .load_textures    = 1,
                                                           .strict_mode      = 0,
                                                           .preserve_indices = 0,
-                                                          .max_line_length  = 4096 };
+                                                          .max_line_length  = 4096,
+                                                          .use_mmap         = 1,
+                                                          .num_threads      = 1,
+                                                          .presize          = 0,
+                                                          .size_hints       = NULL,
+                                                          .use_arena        = 0,
+                                                          .io               = NULL,
+                                                          .soa_alignment    = 0,
+                                                          .compute_bounds   = 0,
+                                                          .compress_cache   = 0,
+                                                          .cancel           = NULL,
+                                                          .use_mtl_cache    = 0 };
 static const wf_print_options_t DEFAULT_PRINT_OPTIONS = {
   .vertex_limit     = -1,
   .texcoord_limit   = -1,
@@ -28,21 +44,153 @@ void wf_parse_options_init(wf_parse_options_t* options) {
   }
 }
 
+// Shared setup of wf_load_obj and wf_load_obj_from_memory
+static wf_error_t wf_begin_load(wf_obj_parser_t* parser, wf_scene_t* scene,
+                                wf_parse_options_t* opts) {
+  memset(scene, 0, sizeof(wf_scene_t));
+  memset(parser, 0, sizeof(wf_obj_parser_t));
+  parser->options          = opts;
+  parser->scene            = scene;
+  parser->line_capacity    = opts->max_line_length;
+  parser->current_material = WF_MATERIAL_NONE;
+  parser->bounds           = wf_aabb_empty();
+
+  if (opts->use_arena) {
+    scene->arena = wf_arena_create(0);
+    if (!scene->arena)
+      return WF_ERROR_OUT_OF_MEMORY;
+  }
+  return WF_SUCCESS;
+}
+
 wf_error_t wf_load_obj(const char* filename, wf_scene_t* scene,
                        const wf_parse_options_t* options) {
   if (!filename || !scene) {
     return WF_ERROR_INVALID_FORMAT;
   }
 
-  memset(scene, 0, sizeof(wf_scene_t));
+  wf_parse_options_t opts = options ? *options : DEFAULT_OPTIONS;
+  wf_obj_parser_t    parser;
+  wf_error_t         result = wf_begin_load(&parser, scene, &opts);
+  if (result != WF_SUCCESS)
+    return result;
+
+  result = wf_obj_parse_file(&parser, filename);
+  if (result == WF_SUCCESS && opts.soa_alignment)
+    result = wf_scene_convert_to_soa(scene, opts.soa_alignment);
+  return result;
+}
+
+wf_error_t wf_load_obj_from_memory(const char* data, size_t size,
+                                   wf_scene_t*               scene,
+                                   const wf_parse_options_t* options) {
+  if ((!data && size) || !scene) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+
+  wf_parse_options_t opts = options ? *options : DEFAULT_OPTIONS;
+  wf_obj_parser_t    parser;
+  wf_error_t         result = wf_begin_load(&parser, scene, &opts);
+  if (result != WF_SUCCESS)
+    return result;
+
+  result = wf_obj_parse_memory(&parser, data, size);
+  if (result == WF_SUCCESS && opts.soa_alignment)
+    result = wf_scene_convert_to_soa(scene, opts.soa_alignment);
+  return result;
+}
+
+struct wf_push_parser_s {
+  wf_obj_parser_t    parser;
+  wf_parse_options_t options;
+  size_t             soa_alignment; /**< Layout restored by finish */
+  wf_error_t         error;         /**< First error, sticky */
+};
+
+static int wf_scene_is_empty(const wf_scene_t* scene) {
+  return !scene->vertex_count && !scene->texcoord_count
+      && !scene->normal_count && !scene->parameter_count
+      && !scene->material_count && !scene->objects;
+}
+
+wf_push_parser_t* wf_obj_parser_create(wf_scene_t*               scene,
+                                       const wf_parse_options_t* options) {
+  if (!scene) {
+    return NULL;
+  }
+
+  wf_push_parser_t* push = calloc(1, sizeof(wf_push_parser_t));
+  if (!push)
+    return NULL;
+  push->options       = options ? *options : DEFAULT_OPTIONS;
+  push->soa_alignment = push->options.soa_alignment;
+  if (!push->soa_alignment)
+    push->soa_alignment = scene->soa.alignment;
+  if (scene->has_bounds)
+    push->options.compute_bounds = 1;
+
+  // The parser appends to wf_vec3 arrays; a fresh arena only suits a scene
+  // with nothing allocated yet
+  if ((scene->soa.alignment && wf_scene_convert_to_aos(scene) != WF_SUCCESS)
+      || (push->options.use_arena && !scene->arena && wf_scene_is_empty(scene)
+          && !(scene->arena = wf_arena_create(0)))) {
+    free(push);
+    return NULL;
+  }
+  push->error = wf_obj_push_begin(&push->parser, scene, &push->options);
+  return push;
+}
+
+wf_error_t wf_obj_parser_feed(wf_push_parser_t* parser, const char* data,
+                              size_t size) {
+  if (!parser || (!data && size)) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  if (parser->error == WF_SUCCESS)
+    parser->error = wf_obj_push_data(&parser->parser, data, size);
+  return parser->error;
+}
+
+wf_error_t wf_obj_parser_finish(wf_push_parser_t* parser) {
+  if (!parser) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+
+  wf_scene_t* scene  = parser->parser.scene;
+  wf_error_t  result = parser->error;
+  if (result == WF_SUCCESS)
+    result = wf_obj_push_end(&parser->parser);
+  else
+    wf_obj_push_abort(&parser->parser);
+  if (result == WF_SUCCESS && parser->soa_alignment)
+    result = wf_scene_convert_to_soa(scene, parser->soa_alignment);
+  free(parser);
+  return result;
+}
+
+wf_error_t wf_parse_stream(const char*           filename,
+                           const wf_callbacks_t* callbacks, void* user) {
+  return wf_parse_stream_ex(filename, NULL, callbacks, user);
+}
+
+wf_error_t wf_parse_stream_ex(const char*               filename,
+                              const wf_parse_options_t* options,
+                              const wf_callbacks_t* callbacks, void* user) {
+  if (!filename || !callbacks) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
 
+  // The scene only carries element counts for index resolution
+  wf_scene_t         counts = { 0 };
   wf_parse_options_t opts   = options ? *options : DEFAULT_OPTIONS;
   wf_obj_parser_t    parser = { 0 };
   parser.options            = &opts;
-  parser.scene              = scene;
+  parser.scene              = &counts;
   parser.line_capacity      = opts.max_line_length;
 
-  return wf_obj_parse_file(&parser, filename);
+  wf_error_t result = wf_obj_stream_file(&parser, filename, callbacks, user);
+  free(counts.error_message);
+  return result;
 }
 
 wf_error_t wf_load_mtl(const char* filename, wf_material_t** materials,
@@ -52,10 +200,36 @@ wf_error_t wf_load_mtl(const char* filename, wf_material_t** materials,
                            material_cap);
 }
 
+wf_error_t wf_load_mtl_from_memory(const char* data, size_t size,
+                                   wf_material_t** materials,
+                                   size_t*         material_count,
+                                   size_t*         material_cap) {
+  if (!data && size) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+
+  wf_mtl_parser_t parser = { 0 };
+  return wf_mtl_parse_buffer(&parser, data, size, materials, material_count,
+                             material_cap);
+}
+
 void wf_free_scene(wf_scene_t* scene) {
   if (!scene)
     return;
 
+  // SoA blocks are separately aligned allocations
+  wf_aligned_free(scene->soa.vertices.xs);
+  wf_aligned_free(scene->soa.texcoords.xs);
+  wf_aligned_free(scene->soa.normals.xs);
+
+  // Everything but the error message lives in the arena
+  if (scene->arena) {
+    wf_arena_destroy(scene->arena);
+    free(scene->error_message);
+    memset(scene, 0, sizeof(wf_scene_t));
+    return;
+  }
+
   free(scene->vertices);
   free(scene->texcoords);
   free(scene->normals);
@@ -80,9 +254,12 @@ void wf_free_scene(wf_scene_t* scene) {
     wf_object_t* next = obj->next;
     free(obj->name);
     free(obj->faces);
+    free(obj->material_runs);
     free(obj);
     obj = next;
   }
+  wf_name_index_destroy(scene->object_index);
+  wf_name_index_destroy(scene->material_index);
 
   free(scene->error_message);
   memset(scene, 0, sizeof(wf_scene_t));
@@ -118,6 +295,16 @@ int wf_validate_scene(const wf_scene_t* scene) {
   return 1;
 }
 
+// Copy an object's faces, taking each face's material from its run
+static void wf_copy_object_faces(const wf_object_t* obj, wf_face* out) {
+  memcpy(out, obj->faces, obj->face_count * sizeof(wf_face));
+  for (size_t r = 0; r < obj->material_run_count; r++) {
+    const wf_material_run_t* run = &obj->material_runs[r];
+    for (size_t i = 0; i < run->count; i++)
+      out[run->start + i].material_idx = run->material_idx;
+  }
+}
+
 wf_error_t wf_scene_to_triangles(const wf_scene_t* scene, wf_face** triangles,
                                  size_t* triangle_count) {
   if (!scene || !triangles || !triangle_count) {
@@ -145,10 +332,7 @@ wf_error_t wf_scene_to_triangles(const wf_scene_t* scene, wf_face** triangles,
   size_t idx = 0;
   obj        = scene->objects;
   while (obj) {
-    memcpy(&tris[idx], obj->faces, obj->face_count * sizeof(wf_face));
-    for (size_t i = 0; i < obj->face_count; i++) {
-      tris[idx + i].material_idx = obj->material_idx;
-    }
+    wf_copy_object_faces(obj, &tris[idx]);
     idx += obj->face_count;
     obj = obj->next;
   }
@@ -158,6 +342,95 @@ wf_error_t wf_scene_to_triangles(const wf_scene_t* scene, wf_face** triangles,
   return WF_SUCCESS;
 }
 
+wf_error_t wf_scene_triangles_by_material(const wf_scene_t*     scene,
+                                          wf_face**             triangles,
+                                          size_t*               triangle_count,
+                                          wf_material_batch_t** batches,
+                                          size_t*               batch_count) {
+  if (!scene || !triangles || !triangle_count || !batches || !batch_count) {
+    return WF_ERROR_INVALID_FORMAT;
+  }
+  *triangles      = NULL;
+  *triangle_count = 0;
+  *batches        = NULL;
+  *batch_count    = 0;
+
+  // Counting sort of the runs: bucket m holds material m, the last bucket
+  // faces without a material
+  size_t  buckets = scene->material_count + 1;
+  size_t* offsets = calloc(buckets, sizeof(size_t));
+  if (!offsets) {
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    wf_material_run_t        whole;
+    size_t                   run_count;
+    const wf_material_run_t* runs = wf_object_runs(obj, &whole, &run_count);
+    for (size_t r = 0; r < run_count; r++) {
+      const wf_material_run_t* run = &runs[r];
+      size_t b = run->material_idx < scene->material_count ? run->material_idx
+                                                            : buckets - 1;
+      offsets[b] += run->count;
+    }
+  }
+
+  size_t total = 0, used = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    size_t count = offsets[b];
+    offsets[b]   = total;
+    total += count;
+    used += count > 0;
+  }
+  if (total == 0) {
+    free(offsets);
+    return WF_SUCCESS;
+  }
+
+  wf_face*             tris  = malloc(total * sizeof(wf_face));
+  wf_material_batch_t* batch = malloc(used * sizeof(wf_material_batch_t));
+  if (!tris || !batch) {
+    free(tris);
+    free(batch);
+    free(offsets);
+    return WF_ERROR_OUT_OF_MEMORY;
+  }
+
+  size_t n = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    size_t end = b + 1 < buckets ? offsets[b + 1] : total;
+    if (end == offsets[b])
+      continue;
+    batch[n].material_idx   = b < scene->material_count ? b : (size_t)-1;
+    batch[n].first_triangle = offsets[b];
+    batch[n].triangle_count = end - offsets[b];
+    n++;
+  }
+
+  for (const wf_object_t* obj = scene->objects; obj; obj = obj->next) {
+    wf_material_run_t        whole;
+    size_t                   run_count;
+    const wf_material_run_t* runs = wf_object_runs(obj, &whole, &run_count);
+    for (size_t r = 0; r < run_count; r++) {
+      const wf_material_run_t* run = &runs[r];
+      size_t b = run->material_idx < scene->material_count ? run->material_idx
+                                                            : buckets - 1;
+      size_t   material = b < scene->material_count ? b : (size_t)-1;
+      wf_face* out      = tris + offsets[b];
+      memcpy(out, obj->faces + run->start, run->count * sizeof(wf_face));
+      for (size_t i = 0; i < run->count; i++)
+        out[i].material_idx = material;
+      offsets[b] += run->count;
+    }
+  }
+  free(offsets);
+
+  *triangles      = tris;
+  *triangle_count = total;
+  *batches        = batch;
+  *batch_count    = used;
+  return WF_SUCCESS;
+}
+
 // ANSI color code
 #define WF_COLOR_RESET   "\x1b[0m"
 #define WF_COLOR_RED     "\x1b[31m"
@@ -248,7 +521,7 @@ void wf_print_scene(const wf_scene_t* scene, wf_print_options_t* opt) {
     wf_print_header("VERTICES", WF_COLOR_GREEN);
     size_t max_vertices = (scene->vertex_count > 10) ? 10 : scene->vertex_count;
     for (size_t i = 0; i < max_vertices; i++) {
-      wf_print_vec3("v", scene->vertices[i], WF_COLOR_GREEN);
+      wf_print_vec3("v", wf_scene_vertex(scene, i), WF_COLOR_GREEN);
     }
     if (scene->vertex_count > 10) {
       fprintf(stderr, "... and %zu more vertices\n", scene->vertex_count - 10);
@@ -261,7 +534,7 @@ void wf_print_scene(const wf_scene_t* scene, wf_print_options_t* opt) {
     size_t max_texcoords =
         (scene->texcoord_count > 10) ? 10 : scene->texcoord_count;
     for (size_t i = 0; i < max_texcoords; i++) {
-      wf_print_vec3("vt", scene->texcoords[i], WF_COLOR_CYAN);
+      wf_print_vec3("vt", wf_scene_texcoord(scene, i), WF_COLOR_CYAN);
     }
     if (scene->texcoord_count > 10) {
       fprintf(stderr, "... and %zu more texture coordinates\n",
@@ -274,7 +547,7 @@ void wf_print_scene(const wf_scene_t* scene, wf_print_options_t* opt) {
     wf_print_header("NORMALS", WF_COLOR_BLUE);
     size_t max_normals = (scene->normal_count > 10) ? 10 : scene->normal_count;
     for (size_t i = 0; i < max_normals; i++) {
-      wf_print_vec3("vn", scene->normals[i], WF_COLOR_BLUE);
+      wf_print_vec3("vn", wf_scene_normal(scene, i), WF_COLOR_BLUE);
     }
     if (scene->normal_count > 10) {
       fprintf(stderr, "... and %zu more normals\n", scene->normal_count - 10);
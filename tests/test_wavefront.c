@@ -1,13 +1,18 @@
 // tests/test_wavefront.c
+#include <float.h>
+#include <locale.h>
+#include <math.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 #include <cmocka.h>
-#include "log4c.h"
 #include "wavefront.h"
 
 // Test data
@@ -52,7 +57,7 @@ static int setup_test_scene(void** state) {
   create_test_file("test_data/cube.obj", test_cube_obj);
   create_test_file("test_data/cube.mtl", test_cube_mtl);
 
-  wf_scene_t* scene = malloc(sizeof(wf_scene_t));
+  wf_scene_t* scene = calloc(1, sizeof(wf_scene_t));
   *state            = scene;
   return 0;
 }
@@ -195,9 +200,1569 @@ static void test_invalid_face(void** state) {
   wf_free_scene(&scene);
 }
 
+// Test: Memory-mapped and stdio readers produce the same scene
+static void test_mmap_matches_stdio(void** state) {
+  // CRLF line endings and no newline after the last line
+  const char* obj = "o quad\r\n"
+                    "v 0 0 0\r\n"
+                    "v 1 0 0\r\n"
+                    "v 1 1 0\r\n"
+                    "v 0 1 0\r\n"
+                    "f 1 2 3 4";
+  create_test_file("test_data/quad.obj", obj);
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+
+  wf_scene_t mapped, streamed;
+  options.use_mmap = 1;
+  assert_int_equal(wf_load_obj("test_data/quad.obj", &mapped, &options),
+                   WF_SUCCESS);
+  options.use_mmap = 0;
+  assert_int_equal(wf_load_obj("test_data/quad.obj", &streamed, &options),
+                   WF_SUCCESS);
+
+  assert_int_equal(mapped.vertex_count, 4);
+  assert_int_equal(streamed.vertex_count, 4);
+  assert_memory_equal(mapped.vertices, streamed.vertices,
+                      4 * sizeof(wf_vec3));
+  assert_non_null(mapped.objects);
+  assert_string_equal(mapped.objects->name, "quad");
+  assert_string_equal(streamed.objects->name, "quad");
+  assert_int_equal(mapped.objects->face_count, 2);
+  assert_int_equal(streamed.objects->face_count, 2);
+  for (size_t i = 0; i < 2; i++) {
+    assert_memory_equal(mapped.objects->faces[i].vertices,
+                        streamed.objects->faces[i].vertices,
+                        sizeof(mapped.objects->faces[i].vertices));
+  }
+
+  wf_free_scene(&mapped);
+  wf_free_scene(&streamed);
+}
+
+// Compare two loaded scenes element by element
+static void assert_scenes_equal(const wf_scene_t* a, const wf_scene_t* b) {
+  assert_int_equal(a->vertex_count, b->vertex_count);
+  assert_int_equal(a->texcoord_count, b->texcoord_count);
+  assert_int_equal(a->normal_count, b->normal_count);
+  assert_int_equal(a->material_count, b->material_count);
+  if (a->vertex_count)
+    assert_memory_equal(a->vertices, b->vertices,
+                        a->vertex_count * sizeof(wf_vec3));
+  if (a->texcoord_count)
+    assert_memory_equal(a->texcoords, b->texcoords,
+                        a->texcoord_count * sizeof(wf_vec3));
+  if (a->normal_count)
+    assert_memory_equal(a->normals, b->normals,
+                        a->normal_count * sizeof(wf_vec3));
+
+  const wf_object_t* oa = a->objects;
+  const wf_object_t* ob = b->objects;
+  while (oa && ob) {
+    if (oa->name || ob->name)
+      assert_string_equal(oa->name, ob->name);
+    assert_int_equal(oa->material_idx, ob->material_idx);
+    assert_int_equal(oa->face_count, ob->face_count);
+    assert_int_equal(oa->material_run_count, ob->material_run_count);
+    if (oa->material_run_count)
+      assert_memory_equal(oa->material_runs, ob->material_runs,
+                          oa->material_run_count * sizeof(wf_material_run_t));
+    for (size_t i = 0; i < oa->face_count; i++) {
+      assert_memory_equal(oa->faces[i].vertices, ob->faces[i].vertices,
+                          sizeof(oa->faces[i].vertices));
+      assert_int_equal(oa->faces[i].smoothing_group,
+                       ob->faces[i].smoothing_group);
+      assert_int_equal(oa->faces[i].material_idx, ob->faces[i].material_idx);
+    }
+    oa = oa->next;
+    ob = ob->next;
+  }
+  assert_null(oa);
+  assert_null(ob);
+}
+
+// Test: Parallel parsing matches a serial parse
+static void test_parallel_matches_serial(void** state) {
+  FILE* f = fopen("test_data/big.obj", "w");
+  assert_non_null(f);
+  fprintf(f, "mtllib cube.mtl\n");
+  for (int i = 0; i < 40000; i++) {
+    if (i % 997 == 0)
+      fprintf(f, "%c part%d\n", (i / 997) % 2 ? 'g' : 'o', i);
+    if (i % 1511 == 0)
+      fprintf(f, "usemtl white\n");
+    if (i % 1201 == 600)
+      fprintf(f, i % 3 ? "s %d\n" : "s off\n", i);
+    fprintf(f, "v %d.%03d %d -%d.5\n", i, i % 1000, i * 7, i % 13);
+    fprintf(f, "vn 0 0 1\n");
+    if (i >= 3)
+      fprintf(f, "f -3//-1 -2//-2 %d//%d %d\n", i, i, i + 1);
+  }
+  fclose(f);
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+
+  wf_scene_t serial, parallel;
+  options.num_threads = 1;
+  assert_int_equal(wf_load_obj("test_data/big.obj", &serial, &options),
+                   WF_SUCCESS);
+  options.num_threads = 4;
+  assert_int_equal(wf_load_obj("test_data/big.obj", &parallel, &options),
+                   WF_SUCCESS);
+
+  assert_int_equal(serial.vertex_count, 40000);
+  assert_scenes_equal(&serial, &parallel);
+
+  wf_free_scene(&serial);
+  wf_free_scene(&parallel);
+}
+
+// Test: Numbers are rounded correctly and ignore the current locale
+static void test_float_parsing(void** state) {
+  const char* obj = "mtllib floats.mtl\n"
+                    "v 0.1 -2.5e-3 16777217\n"
+                    "v 3.4028235e38 1e-45 -0\n"
+                    "v 1.00000005960464477539062500001 .5 5.\n"
+                    "vt 0.333333333333333333333333 1E1 +7\n";
+  const char* mtl = "newmtl white\n"
+                    "Kd 0.8 0.25 1e-1\n"
+                    "Ns 96.078431\n";
+  create_test_file("test_data/floats.obj", obj);
+  create_test_file("test_data/floats.mtl", mtl);
+
+  // A comma decimal separator must not change the result
+  const char* locales[] = { "de_DE.UTF-8", "fr_FR.UTF-8", "de_DE" };
+  for (size_t i = 0; i < sizeof(locales) / sizeof(locales[0]); i++) {
+    if (setlocale(LC_NUMERIC, locales[i]))
+      break;
+  }
+
+  wf_scene_t scene;
+  assert_int_equal(wf_load_obj("test_data/floats.obj", &scene, NULL),
+                   WF_SUCCESS);
+  setlocale(LC_NUMERIC, "C");
+
+  assert_int_equal(scene.vertex_count, 3);
+  assert_true(scene.vertices[0].x == 0.1f);
+  assert_true(scene.vertices[0].y == -2.5e-3f);
+  assert_true(scene.vertices[0].z == 16777216.0f); // ties to even
+  assert_true(scene.vertices[1].x == 3.4028235e38f);
+  assert_true(scene.vertices[1].y == 1e-45f);
+  assert_true(scene.vertices[1].z == 0.0f);
+  assert_true(scene.vertices[2].x == 1.00000012f); // just above halfway
+  assert_true(scene.vertices[2].y == 0.5f);
+  assert_true(scene.vertices[2].z == 5.0f);
+  assert_int_equal(scene.texcoord_count, 1);
+  assert_true(scene.texcoords[0].x == 0.333333333f);
+  assert_true(scene.texcoords[0].y == 10.0f);
+  assert_true(scene.texcoords[0].z == 7.0f);
+
+  assert_int_equal(scene.material_count, 1);
+  assert_true(scene.materials[0].Kd.x == 0.8f);
+  assert_true(scene.materials[0].Kd.y == 0.25f);
+  assert_true(scene.materials[0].Kd.z == 0.1f);
+  assert_true(scene.materials[0].Ns == 96.078431f);
+
+  wf_free_scene(&scene);
+}
+
+// Test: Every face index format and fan triangulation of polygons
+static void test_face_formats(void** state) {
+  const char* obj = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 2 0\n"
+                    "vt 0 0\nvt 1 0\nvt 1 1\n"
+                    "vn 0 0 1\n"
+                    "f 1/1 2/2 3/3\n"
+                    "f 1//1 2//1 3//1\n"
+                    "f 1/1/1\t2/2/1   3/3/1\n"
+                    "f -5 -4 -3 -2 -1\n";
+  create_test_file("test_data/formats.obj", obj);
+
+  wf_scene_t scene;
+  assert_int_equal(wf_load_obj("test_data/formats.obj", &scene, NULL),
+                   WF_SUCCESS);
+  assert_non_null(scene.objects);
+  assert_int_equal(scene.objects->face_count, 6);
+
+  const wf_face* faces = scene.objects->faces;
+  // v/vt
+  assert_int_equal(faces[0].vertices[2].v_idx, 2);
+  assert_int_equal(faces[0].vertices[2].vt_idx, 2);
+  assert_int_equal(faces[0].vertices[2].vn_idx, -1);
+  // v//vn
+  assert_int_equal(faces[1].vertices[1].v_idx, 1);
+  assert_int_equal(faces[1].vertices[1].vt_idx, -1);
+  assert_int_equal(faces[1].vertices[1].vn_idx, 0);
+  // v/vt/vn with mixed separators
+  assert_int_equal(faces[2].vertices[1].v_idx, 1);
+  assert_int_equal(faces[2].vertices[1].vt_idx, 1);
+  assert_int_equal(faces[2].vertices[1].vn_idx, 0);
+  // Pentagon with relative indices becomes a fan around its first vertex
+  for (size_t i = 0; i < 3; i++) {
+    assert_int_equal(faces[3 + i].vertices[0].v_idx, 0);
+    assert_int_equal(faces[3 + i].vertices[1].v_idx, (int)i + 1);
+    assert_int_equal(faces[3 + i].vertices[2].v_idx, (int)i + 2);
+  }
+
+  wf_free_scene(&scene);
+}
+
+// Test: Pre-sizing allocates every array at its exact size
+static void test_presize(void** state) {
+  const char* obj = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 2 0\n"
+                    "vn 0 0 1\n"
+                    "f 1 2 3\n"
+                    "o pentagon\n"
+                    "f 1 2 3 4 5\n"
+                    "g quads\n"
+                    "f 1 2 3 4\nf 2 3 4 5\n";
+  create_test_file("test_data/presize.obj", obj);
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.presize = 1;
+
+  wf_scene_t counted;
+  assert_int_equal(wf_load_obj("test_data/presize.obj", &counted, &options),
+                   WF_SUCCESS);
+  assert_int_equal(counted.vertex_cap, 5);
+  assert_int_equal(counted.normal_cap, 1);
+  assert_int_equal(counted.texcoord_cap, 0);
+  size_t expected_faces[] = { 1, 3, 4 };
+  size_t n                = 0;
+  for (const wf_object_t* o = counted.objects; o; o = o->next, n++) {
+    assert_true(n < 3);
+    assert_int_equal(o->face_count, expected_faces[n]);
+    assert_int_equal(o->face_cap, expected_faces[n]);
+  }
+  assert_int_equal(n, 3);
+
+  // Caller-provided counts skip the counting pass
+  wf_size_hints_t hints = { .vertices = 5, .normals = 1 };
+  options.presize       = 0;
+  options.size_hints    = &hints;
+  wf_scene_t hinted;
+  assert_int_equal(wf_load_obj("test_data/presize.obj", &hinted, &options),
+                   WF_SUCCESS);
+  assert_int_equal(hinted.vertex_cap, 5);
+  assert_int_equal(hinted.normal_cap, 1);
+  assert_scenes_equal(&counted, &hinted);
+
+  wf_free_scene(&counted);
+  wf_free_scene(&hinted);
+}
+
+// Test: Arena-backed scenes match heap-allocated ones
+static void test_arena_scene(void** state) {
+  const char* obj = "mtllib cube.mtl\n"
+                    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                    "o first\nusemtl white\nf 1 2 3 4\n"
+                    "g second\nf 4 3 2 1\n";
+  create_test_file("test_data/arena.obj", obj);
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+
+  wf_scene_t heap, arena;
+  assert_int_equal(wf_load_obj("test_data/arena.obj", &heap, &options),
+                   WF_SUCCESS);
+  options.use_arena = 1;
+  assert_int_equal(wf_load_obj("test_data/arena.obj", &arena, &options),
+                   WF_SUCCESS);
+  assert_null(heap.arena);
+  assert_non_null(arena.arena);
+  assert_scenes_equal(&heap, &arena);
+  assert_string_equal(arena.materials[0].name, heap.materials[0].name);
+
+  wf_free_scene(&arena);
+  assert_null(arena.arena);
+  assert_null(arena.objects);
+  wf_free_scene(&heap);
+
+  // Many objects whose faces each need a dedicated arena block, serial and
+  // in parallel chunks
+  FILE* f = fopen("test_data/arena_objects.obj", "w");
+  assert_non_null(f);
+  for (int i = 0; i < 402; i++)
+    fprintf(f, "v %d 0 0\n", i);
+  for (int o = 0; o < 2000; o++) {
+    fprintf(f, "o part%d\n", o);
+    for (int i = 1; i <= 400; i++)
+      fprintf(f, "f %d %d %d\n", i, i + 1, i + 2);
+  }
+  fclose(f);
+  options.use_arena = 0;
+  assert_int_equal(wf_load_obj("test_data/arena_objects.obj", &heap,
+                               &options),
+                   WF_SUCCESS);
+  options.use_arena = 1;
+  for (size_t threads = 1; threads <= 4; threads += 3) {
+    options.num_threads = threads;
+    assert_int_equal(wf_load_obj("test_data/arena_objects.obj", &arena,
+                                 &options),
+                     WF_SUCCESS);
+    assert_scenes_equal(&heap, &arena);
+    assert_int_equal(wf_scene_convert_to_soa(&arena, 16), WF_SUCCESS);
+    wf_free_scene(&arena);
+  }
+  wf_free_scene(&heap);
+}
+
+// Counts warnings passed to the log callback
+static void count_warnings(wf_log_level_t level, const char* message,
+                           void* user) {
+  if (level == WF_LOG_WARN && strstr(message, "line 2"))
+    (*(int*)user)++;
+}
+
+// Test: Log messages reach the installed callback
+static void test_log_callback(void** state) {
+  create_test_file("test_data/short_face.obj", "v 1 2 3\nf 1 1\n");
+
+  int warnings = 0;
+  wf_set_log_callback(count_warnings, &warnings);
+
+  wf_scene_t scene;
+  wf_error_t err = wf_load_obj("test_data/short_face.obj", &scene, NULL);
+  wf_set_log_callback(NULL, NULL);
+
+  assert_int_equal(err, WF_SUCCESS);
+  assert_int_equal(warnings, 1);
+  wf_free_scene(&scene);
+}
+
+// Collects what wf_parse_stream reports
+typedef struct {
+  size_t vertices;
+  size_t triangles;
+  size_t objects;
+  int    last_v_idx;
+  char   usemtl[32];
+  size_t stop_after;
+} stream_counts_t;
+
+static int count_vertices(void* user, const wf_vec3* v, size_t count) {
+  ((stream_counts_t*)user)->vertices += count;
+  return 0;
+}
+
+static int count_face(void* user, const wf_vertex_index* idx, size_t count) {
+  stream_counts_t* c = user;
+  assert_int_equal(count, 3);
+  c->last_v_idx = idx[2].v_idx;
+  c->triangles++;
+  return c->stop_after && c->triangles == c->stop_after;
+}
+
+static int count_object(void* user, const char* name, int is_group) {
+  ((stream_counts_t*)user)->objects++;
+  return 0;
+}
+
+static int record_usemtl(void* user, const char* name) {
+  strncpy(((stream_counts_t*)user)->usemtl, name, 31);
+  return 0;
+}
+
+// Test: Streaming reports every element without building a scene
+static void test_parse_stream(void** state) {
+  wf_callbacks_t callbacks = { .vertices = count_vertices,
+                               .face     = count_face,
+                               .object   = count_object,
+                               .usemtl   = record_usemtl };
+
+  stream_counts_t counts = { 0 };
+  assert_int_equal(
+      wf_parse_stream("test_data/cube.obj", &callbacks, &counts), WF_SUCCESS);
+  assert_int_equal(counts.vertices, 8);
+  assert_int_equal(counts.triangles, 12);
+  assert_int_equal(counts.last_v_idx, 0);
+
+  const char* obj = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                    "o a\nusemtl white\nf -4 -3 -2 -1\n"
+                    "g b\nf 1 2 3\n";
+  create_test_file("test_data/stream.obj", obj);
+  memset(&counts, 0, sizeof(counts));
+  assert_int_equal(
+      wf_parse_stream("test_data/stream.obj", &callbacks, &counts), WF_SUCCESS);
+  assert_int_equal(counts.vertices, 4);
+  assert_int_equal(counts.triangles, 3);
+  assert_int_equal(counts.objects, 2);
+  assert_string_equal(counts.usemtl, "white");
+
+  // A non-zero return stops the parse
+  memset(&counts, 0, sizeof(counts));
+  counts.stop_after = 1;
+  assert_int_equal(
+      wf_parse_stream("test_data/stream.obj", &callbacks, &counts),
+      WF_ERROR_CANCELLED);
+  assert_int_equal(counts.triangles, 1);
+}
+
+// In-memory archive used as an I/O provider
+typedef struct {
+  const char* path;
+  const char* data;
+} packed_file_t;
+
+static const packed_file_t* find_packed(void* user, const char* path) {
+  for (const packed_file_t* f = user; f->path; f++)
+    if (!strcmp(f->path, path))
+      return f;
+  return NULL;
+}
+
+static int packed_lookup(void* user, const char* path, const char** data,
+                         size_t* size) {
+  const packed_file_t* f = find_packed(user, path);
+  if (!f)
+    return -1;
+  *data = f->data;
+  *size = strlen(f->data);
+  return 0;
+}
+
+// Read-based access hands out the remaining bytes a few at a time
+typedef struct {
+  const char* data;
+  size_t      left;
+} packed_handle_t;
+
+static void* packed_open(void* user, const char* path) {
+  const packed_file_t* f = find_packed(user, path);
+  if (!f)
+    return NULL;
+  packed_handle_t* h = malloc(sizeof(packed_handle_t));
+  h->data            = f->data;
+  h->left            = strlen(f->data);
+  return h;
+}
+
+static size_t packed_read(void* user, void* handle, char* data, size_t size) {
+  packed_handle_t* h = handle;
+  size_t           n = size < 5 ? size : 5;
+  if (n > h->left)
+    n = h->left;
+  memcpy(data, h->data, n);
+  h->data += n;
+  h->left -= n;
+  return n;
+}
+
+static void packed_close(void* user, void* handle) {
+  free(handle);
+}
+
+// Test: OBJ and MTL files load from memory and from an I/O provider
+static void test_load_from_memory(void** state) {
+  const char*   obj     = "mtllib cube.mtl\n"
+                          "v 0 0 0\nv 1 0 0\nv 1 1 0\n"
+                          "usemtl white\nf 1 2 3\n";
+  packed_file_t files[] = { { "pack/cube.obj", obj },
+                            { "pack/cube.mtl", test_cube_mtl },
+                            { "cube.mtl", test_cube_mtl },
+                            { NULL, NULL } };
+
+  wf_io_t io = { .lookup = packed_lookup, .user = files };
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.io = &io;
+
+  // mtllib resolves next to the OBJ inside the provider
+  wf_scene_t scene;
+  assert_int_equal(wf_load_obj("pack/cube.obj", &scene, &options), WF_SUCCESS);
+  assert_int_equal(scene.vertex_count, 3);
+  assert_int_equal(scene.material_count, 1);
+  assert_int_equal(scene.objects->material_idx, 0);
+  wf_free_scene(&scene);
+  assert_int_equal(wf_load_obj("pack/missing.obj", &scene, &options),
+                   WF_ERROR_FILE_NOT_FOUND);
+  wf_free_scene(&scene);
+
+  // The same files through open/read/close
+  wf_io_t reader = { .open  = packed_open,
+                     .read  = packed_read,
+                     .close = packed_close,
+                     .user  = files };
+  options.io     = &reader;
+  assert_int_equal(wf_load_obj("pack/cube.obj", &scene, &options), WF_SUCCESS);
+  assert_int_equal(scene.material_count, 1);
+  assert_float_equal(scene.materials[0].Kd.x, 1.0f, 1e-6f);
+  wf_free_scene(&scene);
+
+  // A buffer without a terminating NUL or newline
+  char buffer[64];
+  size_t size = strlen(obj) - 1;
+  memcpy(buffer, obj, size);
+  memset(buffer + size, 'x', sizeof(buffer) - size);
+  assert_int_equal(wf_load_obj_from_memory(buffer, size, &scene, &options),
+                   WF_SUCCESS);
+  assert_int_equal(scene.objects->face_count, 1);
+  assert_int_equal(scene.material_count, 1);
+  wf_free_scene(&scene);
+
+  wf_material_t* materials = NULL;
+  size_t         count = 0, cap = 0;
+  assert_int_equal(wf_load_mtl_from_memory(test_cube_mtl, 13, &materials,
+                                           &count, &cap),
+                   WF_SUCCESS);
+  assert_int_equal(count, 1);
+  assert_string_equal(materials[0].name, "white");
+  free(materials[0].name);
+  free(materials);
+}
+
+// Test: Keywords must be followed by whitespace
+static void test_keyword_boundaries(void** state) {
+  const char* obj = "v 0 0 0\nv\t1 0 0\nvx 5 5 5\nv 0 1 0\n"
+                    "vt 0 0\nvtx 1 1\nfoo 1 2 3\n"
+                    "curv2 1 2\nf 1 2 3\nf\n";
+
+  wf_scene_t scene;
+  assert_int_equal(wf_load_obj_from_memory(obj, strlen(obj), &scene, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(scene.vertex_count, 3);
+  assert_int_equal(scene.texcoord_count, 1);
+  assert_float_equal(scene.vertices[2].y, 1.0f, 1e-6f);
+  assert_int_equal(scene.objects->face_count, 1);
+  wf_free_scene(&scene);
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.strict_mode = 1;
+  assert_int_equal(wf_load_obj_from_memory(obj, strlen(obj), &scene, &options),
+                   WF_ERROR_UNSUPPORTED_FEATURE);
+  wf_free_scene(&scene);
+}
+
+// Test: Identical corners share one vertex of the indexed mesh
+static void test_indexed_mesh(void** state) {
+  const char* obj = "mtllib cube.mtl\n"
+                    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                    "vt 0 0\nvt 1 1\nvn 0 0 1\n"
+                    "o a\nusemtl unknown\nf 1/1/1 2/1/1 3/1/1 4/1/1\n"
+                    "o b\nusemtl white\nf 1/2/1 2/1/1 3/1/1\n"
+                    "o c\nusemtl white\nf 3//1 4//1 1//1\n";
+  create_test_file("test_data/indexed.obj", obj);
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/indexed.obj", scene, NULL),
+                   WF_SUCCESS);
+
+  // Per object: 4 + 1 (vertex 1 with vt 2) + 3 (no texture coordinates)
+  wf_indexed_mesh_t mesh;
+  assert_int_equal(wf_scene_build_indexed_mesh(scene, NULL, &mesh),
+                   WF_SUCCESS);
+  assert_int_equal(mesh.vertex_count, 8);
+  assert_int_equal(mesh.index_count, 12);
+  assert_int_equal(mesh.group_count, 3);
+  assert_string_equal(mesh.groups[1].name, "b");
+  assert_int_equal(mesh.groups[1].first_index, 6);
+  assert_int_equal(mesh.groups[1].material_idx, 0);
+  assert_int_equal(mesh.groups[0].material_idx, (size_t)-1);
+  assert_int_equal(mesh.indices[0], mesh.indices[3]);
+  assert_float_equal(mesh.vertices[mesh.indices[6]].u, 1.0f, 1e-6f);
+  assert_float_equal(mesh.vertices[mesh.indices[7]].normal.z, 1.0f, 1e-6f);
+  for (size_t i = 0; i < mesh.index_count; i++)
+    assert_true(mesh.indices[i] < mesh.vertex_count);
+  wf_free_indexed_mesh(&mesh);
+
+  // Per material, separate streams: objects b and c share one group
+  wf_mesh_options_t options = { .separate_streams = 1, .by_material = 1 };
+  assert_int_equal(wf_scene_build_indexed_mesh(scene, &options, &mesh),
+                   WF_SUCCESS);
+  assert_int_equal(mesh.group_count, 2);
+  assert_int_equal(mesh.groups[0].material_idx, 0);
+  assert_int_equal(mesh.groups[0].index_count, 6);
+  assert_int_equal(mesh.groups[1].material_idx, (size_t)-1);
+  assert_null(mesh.vertices);
+  assert_non_null(mesh.texcoords);
+  assert_float_equal(mesh.positions[mesh.indices[2]].y, 1.0f, 1e-6f);
+  wf_free_indexed_mesh(&mesh);
+}
+
+// Test: Structure-of-arrays geometry is aligned, padded and readable
+static void test_soa_layout(void** state) {
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.soa_alignment = 32;
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/cube.obj", scene, &options),
+                   WF_SUCCESS);
+  assert_null(scene->vertices);
+  assert_int_equal(scene->soa.alignment, 32);
+  assert_int_equal(scene->soa.vertices.count, 8);
+  assert_int_equal(scene->soa.vertices.padded_count, 8);
+  assert_int_equal((size_t)scene->soa.vertices.ys % 32, 0);
+  assert_float_equal(scene->soa.vertices.xs[1], 1.0f, 1e-6f);
+  assert_float_equal(wf_scene_vertex(scene, 6).z, 1.0f, 1e-6f);
+
+  // Re-layout pads to the wider SIMD width with zeros
+  assert_int_equal(wf_scene_convert_to_soa(scene, 64), WF_SUCCESS);
+  assert_int_equal(scene->soa.vertices.padded_count, 16);
+  assert_int_equal((size_t)scene->soa.vertices.zs % 64, 0);
+  assert_float_equal(scene->soa.vertices.zs[15], 0.0f, 0.0f);
+  assert_float_equal(wf_scene_vertex(scene, 3).y, 1.0f, 1e-6f);
+
+  // Code that needs wf_vec3 arrays can convert back
+  assert_int_equal(wf_scene_convert_to_aos(scene), WF_SUCCESS);
+  assert_int_equal(scene->soa.alignment, 0);
+  assert_float_equal(scene->vertices[7].x, -1.0f, 1e-6f);
+  assert_int_equal(wf_scene_convert_to_soa(scene, 24),
+                   WF_ERROR_INVALID_FORMAT);
+}
+
+// Test: usemtl changes inside an object split it into material runs
+static void test_material_runs(void** state) {
+  const char* obj = "mtllib runs.mtl\n"
+                    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                    "f 1 2 3\n"
+                    "o a\nusemtl blue\nf 1 2 3\nf 1 3 4\n"
+                    "usemtl red\nf 2 3 4\nusemtl blue\nusemtl blue\n"
+                    "f 1 2 4\n"
+                    "g b\nf 4 3 2\n";
+  const char* mtl = "newmtl red\nKd 1 0 0\n"
+                    "newmtl blue\nKd 0 0 1\n";
+  create_test_file("test_data/runs.obj", obj);
+  create_test_file("test_data/runs.mtl", mtl);
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/runs.obj", scene, NULL),
+                   WF_SUCCESS);
+
+  // Faces before any usemtl have no material
+  const wf_object_t* o = scene->objects;
+  assert_int_equal(o->material_run_count, 1);
+  assert_int_equal(o->material_runs[0].material_idx, (size_t)-1);
+  assert_int_equal(o->material_idx, (size_t)-1);
+
+  o = o->next;
+  assert_string_equal(o->name, "a");
+  assert_int_equal(o->material_run_count, 3);
+  assert_int_equal(o->material_runs[0].count, 2);
+  assert_int_equal(o->material_runs[1].start, 2);
+  assert_int_equal(o->material_runs[1].material_idx, 0);
+  assert_int_equal(o->material_runs[2].material_idx, 1);
+  assert_int_equal(o->material_idx, 1);
+
+  // The material stays current across o/g
+  o = o->next;
+  assert_int_equal(o->material_run_count, 1);
+  assert_int_equal(o->material_runs[0].material_idx, 1);
+
+  wf_face* tris  = NULL;
+  size_t   count = 0;
+  assert_int_equal(wf_scene_to_triangles(scene, &tris, &count), WF_SUCCESS);
+  assert_int_equal(count, 6);
+  assert_int_equal(tris[3].material_idx, 0);
+  assert_int_equal(tris[4].material_idx, 1);
+  free(tris);
+
+  // Batches: red, blue, then faces without a material
+  wf_material_batch_t* batches     = NULL;
+  size_t               batch_count = 0;
+  assert_int_equal(wf_scene_triangles_by_material(scene, &tris, &count,
+                                                  &batches, &batch_count),
+                   WF_SUCCESS);
+  assert_int_equal(count, 6);
+  assert_int_equal(batch_count, 3);
+  assert_int_equal(batches[0].material_idx, 0);
+  assert_int_equal(batches[0].triangle_count, 1);
+  assert_int_equal(batches[1].first_triangle, 1);
+  assert_int_equal(batches[1].triangle_count, 4);
+  assert_int_equal(batches[2].material_idx, (size_t)-1);
+  assert_int_equal(tris[0].vertices[0].v_idx, 1);
+  assert_int_equal(tris[4].vertices[0].v_idx, 3);
+  assert_int_equal(tris[4].material_idx, 1);
+  assert_int_equal(tris[5].material_idx, (size_t)-1);
+  free(tris);
+  free(batches);
+
+  // Chunked parsing resolves runs that cross chunk boundaries
+  FILE* f = fopen("test_data/runs_big.obj", "w");
+  assert_non_null(f);
+  fprintf(f, "mtllib runs.mtl\n");
+  for (int i = 0; i < 30000; i++) {
+    if (i % 4999 == 0)
+      fprintf(f, "g part%d\n", i);
+    if (i % 1733 == 0)
+      fprintf(f, "usemtl %s\n", (i / 1733) % 3 ? "red" : "blue");
+    fprintf(f, "v %d 0 1\n", i);
+    if (i >= 3)
+      fprintf(f, "f -3 -2 -1\n");
+  }
+  fclose(f);
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  wf_scene_t serial, parallel;
+  options.num_threads = 1;
+  assert_int_equal(wf_load_obj("test_data/runs_big.obj", &serial, &options),
+                   WF_SUCCESS);
+  options.num_threads = 4;
+  assert_int_equal(wf_load_obj("test_data/runs_big.obj", &parallel, &options),
+                   WF_SUCCESS);
+  assert_true(serial.objects->material_run_count > 1);
+  assert_scenes_equal(&serial, &parallel);
+  wf_free_scene(&serial);
+  wf_free_scene(&parallel);
+}
+
+// Test: Binary scenes and the sidecar cache reproduce the parsed scene
+static void test_binary_scene(void** state) {
+  const char* obj = "mtllib binary.mtl\n"
+                    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                    "vt 0 0\nvn 0 0 1\n"
+                    "o quad\nusemtl brick\nf 1/1/1 2/1/1 3/1/1 4/1/1\n"
+                    "g rest\nusemtl none\nf 1 3 4\n";
+  const char* mtl = "newmtl brick\nKd 0.5 0.25 0\nmap_Kd brick.png\n";
+  create_test_file("test_data/binary.obj", obj);
+  create_test_file("test_data/binary.mtl", mtl);
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/binary.obj", scene, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(
+      wf_save_scene_binary(scene, "test_data/binary.wfscene", NULL),
+      WF_SUCCESS);
+
+  wf_binary_options_t options;
+  wf_binary_options_init(&options);
+  for (int mmap = 0; mmap < 2; mmap++) {
+    options.use_mmap = mmap;
+    wf_scene_t loaded;
+    assert_int_equal(
+        wf_load_scene_binary("test_data/binary.wfscene", &loaded, &options),
+        WF_SUCCESS);
+    assert_scenes_equal(scene, &loaded);
+    assert_string_equal(loaded.materials[0].map_Kd, "brick.png");
+    assert_string_equal(loaded.objects->next->name, "rest");
+    assert_int_equal((size_t)loaded.vertices % 64, 0);
+
+    // The loaded scene can still be changed
+    assert_int_equal(wf_scene_convert_to_soa(&loaded, 16), WF_SUCCESS);
+    assert_float_equal(wf_scene_vertex(&loaded, 2).y, 1.0f, 0.0f);
+    wf_free_scene(&loaded);
+  }
+
+  // Faces record their run's material, and saving is reproducible
+  assert_int_equal(scene->objects->faces[1].material_idx, 0);
+  assert_int_equal(scene->objects->next->faces[0].material_idx, (size_t)-1);
+  FILE* f = fopen("test_data/binary.wfscene", "r+b");
+  assert_non_null(f);
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  char* data = malloc(size);
+  f          = fopen("test_data/binary.wfscene", "rb");
+  assert_int_equal(fread(data, 1, size, f), size);
+  fclose(f);
+  wf_scene_t again;
+  assert_int_equal(wf_load_obj("test_data/binary.obj", &again, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(
+      wf_save_scene_binary(&again, "test_data/binary2.wfscene", NULL),
+      WF_SUCCESS);
+  wf_free_scene(&again);
+  char* saved = malloc(size);
+  f           = fopen("test_data/binary2.wfscene", "rb");
+  assert_non_null(f);
+  assert_int_equal(fread(saved, 1, size, f), size);
+  assert_int_equal(fgetc(f), EOF);
+  fclose(f);
+  assert_memory_equal(data, saved, size);
+  free(saved);
+
+  // Truncated files are rejected
+  f = fopen("test_data/truncated.wfscene", "wb");
+  fwrite(data, 1, size - 8, f);
+  fclose(f);
+  free(data);
+  wf_scene_t loaded;
+  assert_int_equal(wf_load_scene_binary("test_data/truncated.wfscene",
+                                        &loaded, NULL),
+                   WF_ERROR_INVALID_FORMAT);
+  assert_non_null(wf_get_error(&loaded));
+  wf_free_scene(&loaded);
+
+  // The sidecar cache is written on the first load and follows the source
+  remove("test_data/binary.obj.wfcache");
+  assert_int_equal(wf_load_obj_cached("test_data/binary.obj", NULL, &loaded,
+                                      NULL),
+                   WF_SUCCESS);
+  wf_free_scene(&loaded);
+  f = fopen("test_data/binary.obj.wfcache", "rb");
+  assert_non_null(f);
+  fclose(f);
+  assert_int_equal(wf_load_obj_cached("test_data/binary.obj", NULL, &loaded,
+                                      NULL),
+                   WF_SUCCESS);
+  assert_non_null(loaded.arena); // mapped from the cache, not parsed
+  assert_scenes_equal(scene, &loaded);
+  wf_free_scene(&loaded);
+
+  f = fopen("test_data/binary.obj", "a");
+  fputs("v 2 2 2\n", f);
+  fclose(f);
+  assert_int_equal(wf_load_obj_cached("test_data/binary.obj", NULL, &loaded,
+                                      NULL),
+                   WF_SUCCESS);
+  assert_null(loaded.arena);
+  assert_int_equal(loaded.vertex_count, 5);
+  wf_free_scene(&loaded);
+}
+
+// Test: Objects are found by name through the scene index
+static void test_find_object(void** state) {
+  wf_scene_t* scene = *state;
+  const char* obj   = "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                      "f 1 2 3\n"
+                      "g wheel\nf 1 2 3\n"
+                      "o body\nf 1 2 3\nf 3 2 1\n"
+                      "g wheel\nf 3 2 1\n";
+  assert_int_equal(wf_load_obj_from_memory(obj, strlen(obj), scene, NULL),
+                   WF_SUCCESS);
+  assert_non_null(scene->object_index);
+
+  wf_object_t* body = wf_scene_find_object(scene, "body");
+  assert_non_null(body);
+  assert_int_equal(body->face_count, 2);
+  // Repeated names resolve to the first object
+  assert_ptr_equal(wf_scene_find_object(scene, "wheel"),
+                   scene->objects->next);
+  assert_null(wf_scene_find_object(scene, "whee"));
+  assert_null(wf_scene_find_object(scene, ""));
+
+  // Scenes without an index are scanned
+  wf_scene_t plain = { .objects = scene->objects };
+  assert_ptr_equal(wf_scene_find_object(&plain, "body"), body);
+}
+
+// Test: usemtl and wf_scene_find_material match whole names only
+static void test_find_material(void** state) {
+  const char* obj = "mtllib woods.mtl\n"
+                    "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                    "usemtl wood_dark\nf 1 2 3\n"
+                    "usemtl woo\nf 1 2 3\n"
+                    "usemtl wood\nf 1 2 3\n";
+  const char* mtl = "newmtl wood\nKd 1 0 0\n"
+                    "newmtl wood_dark\nKd 0 1 0\n"
+                    "newmtl wood\nKd 0 0 1\n";
+  create_test_file("test_data/woods.obj", obj);
+  create_test_file("test_data/woods.mtl", mtl);
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/woods.obj", scene, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(scene->material_count, 3);
+
+  // wood_dark is not taken for wood, nor woo for either
+  const wf_object_t* o = scene->objects;
+  assert_int_equal(o->material_run_count, 3);
+  assert_int_equal(o->material_runs[0].material_idx, 1);
+  assert_int_equal(o->material_runs[1].material_idx, (size_t)-1);
+  assert_int_equal(o->material_runs[2].material_idx, 0);
+
+  assert_int_equal(wf_scene_find_material(scene, "wood_dark"), 1);
+  assert_int_equal(wf_scene_find_material(scene, "wood"), 0);
+  assert_int_equal(wf_scene_find_material(scene, "wood_"), (size_t)-1);
+
+  // Scenes without an index are scanned
+  wf_scene_t plain = { .materials      = scene->materials,
+                       .material_count = scene->material_count };
+  assert_int_equal(wf_scene_find_material(&plain, "wood_dark"), 1);
+}
+
+static void test_bounds(void** state) {
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/cube.obj", scene, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(scene->has_bounds, 0);
+
+  wf_bounds_t bounds;
+  assert_int_equal(wf_scene_compute_bounds(scene, NULL, &bounds), WF_SUCCESS);
+  assert_float_equal(bounds.scene.min.x, -1.0f, 0.0f);
+  assert_float_equal(bounds.scene.max.z, 1.0f, 0.0f);
+  assert_int_equal(bounds.object_count, 1);
+  assert_float_equal(bounds.objects[0].min.y, -1.0f, 0.0f);
+  assert_float_equal(bounds.spheres[0].center.x, 0.0f, 0.0f);
+  assert_float_equal(bounds.spheres[0].radius, sqrtf(3.0f), 1e-6f);
+  wf_free_bounds(&bounds);
+  wf_free_scene(scene);
+
+  // Enough vertices for every SIMD width plus a tail; object b only uses
+  // the last three
+  char   obj[8192];
+  size_t n = 0;
+  for (int i = 0; i < 101; i++) {
+    n += snprintf(obj + n, sizeof(obj) - n, "v %d %g %d\n", i % 7 - 3,
+                  i * 0.5 - 10, -(i % 11));
+  }
+  n += snprintf(obj + n, sizeof(obj) - n,
+                "o a\nf 1 2 3\nf 50 60 70\no b\nf 99 100 101\n");
+
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.compute_bounds = 1;
+  assert_int_equal(wf_load_obj_from_memory(obj, n, scene, &options),
+                   WF_SUCCESS);
+  assert_int_equal(scene->has_bounds, 1);
+  assert_float_equal(scene->bounds.min.x, -3.0f, 0.0f);
+  assert_float_equal(scene->bounds.max.x, 3.0f, 0.0f);
+  assert_float_equal(scene->bounds.min.y, -10.0f, 0.0f);
+  assert_float_equal(scene->bounds.max.y, 40.0f, 0.0f);
+  assert_float_equal(scene->bounds.min.z, -10.0f, 0.0f);
+  assert_float_equal(scene->bounds.max.z, 0.0f, 0.0f);
+
+  // The kernels agree with the parser on either layout
+  wf_bounds_options_t bounds_options = { .num_threads = 4 };
+  scene->has_bounds                  = 0;
+  for (int soa = 0; soa < 2; soa++) {
+    if (soa)
+      assert_int_equal(wf_scene_convert_to_soa(scene, 32), WF_SUCCESS);
+    assert_int_equal(wf_scene_compute_bounds(scene, &bounds_options, &bounds),
+                     WF_SUCCESS);
+    assert_memory_equal(&bounds.scene, &scene->bounds, sizeof(wf_aabb_t));
+    assert_int_equal(bounds.object_count, 2);
+    assert_float_equal(bounds.objects[0].max.y, 24.5f, 0.0f);
+    assert_float_equal(bounds.objects[1].min.x, -3.0f, 0.0f);
+    assert_float_equal(bounds.objects[1].max.x, -1.0f, 0.0f);
+    assert_float_equal(bounds.spheres[1].center.y, 39.5f, 0.0f);
+    assert_float_equal(bounds.spheres[1].center.z, -5.0f, 0.0f);
+    assert_float_equal(bounds.spheres[1].radius, sqrtf(26.25f), 1e-5f);
+    wf_free_bounds(&bounds);
+  }
+}
+
+static void test_bvh(void** state) {
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/cube.obj", scene, NULL),
+                   WF_SUCCESS);
+  wf_face* tris;
+  size_t   tri_count;
+  assert_int_equal(wf_scene_to_triangles(scene, &tris, &tri_count),
+                   WF_SUCCESS);
+
+  wf_bvh_t bvh;
+  assert_int_equal(sizeof(wf_bvh_node_t), 32);
+  assert_int_equal(wf_bvh_build(scene, tris, tri_count, NULL, &bvh),
+                   WF_SUCCESS);
+  assert_int_equal(bvh.triangle_count, 12);
+  assert_float_equal(bvh.nodes[0].min[0], -1.0f, 0.0f);
+  assert_float_equal(bvh.nodes[0].max[2], 1.0f, 0.0f);
+  int seen[12] = { 0 };
+  for (size_t i = 0; i < bvh.triangle_count; i++)
+    seen[bvh.indices[i]]++;
+  for (size_t i = 0; i < 12; i++)
+    assert_int_equal(seen[i], 1);
+
+  // Face 3 of the cube is z = 1, triangulated into triangles 4 and 5
+  wf_bvh_hit_t hit;
+  wf_vec3      down = { 0.0f, 0.0f, -1.0f };
+  assert_true(wf_bvh_intersect(&bvh, (wf_vec3){ 0.25f, 0.5f, 5.0f }, down,
+                               FLT_MAX, &hit));
+  assert_float_equal(hit.t, 4.0f, 1e-6f);
+  assert_int_equal(hit.triangle / 2, 2);
+  assert_false(wf_bvh_intersect(&bvh, (wf_vec3){ 0.25f, 0.5f, 5.0f }, down,
+                                3.0f, &hit));
+  assert_false(wf_bvh_intersect(&bvh, (wf_vec3){ 5.0f, 5.0f, 5.0f }, down,
+                                FLT_MAX, &hit));
+  wf_free_bvh(&bvh);
+  free(tris);
+
+  // A grid large enough to be built by several threads gives the same tree
+  // as one thread
+  enum { N = 100 };
+  wf_scene_t grid = { 0 };
+  grid.vertices     = malloc((N + 1) * (N + 1) * sizeof(wf_vec3));
+  grid.vertex_count = (N + 1) * (N + 1);
+  tris              = calloc(2 * N * N, sizeof(wf_face));
+  assert_non_null(grid.vertices);
+  assert_non_null(tris);
+  for (int y = 0; y <= N; y++) {
+    for (int x = 0; x <= N; x++)
+      grid.vertices[y * (N + 1) + x] = (wf_vec3){ (float)x, (float)y, 0.0f };
+  }
+  for (int q = 0; q < N * N; q++) {
+    int v = q / N * (N + 1) + q % N;
+    int c[2][3] = { { v, v + 1, v + N + 2 }, { v, v + N + 2, v + N + 1 } };
+    for (int k = 0; k < 2; k++) {
+      for (int j = 0; j < 3; j++)
+        tris[2 * q + k].vertices[j].v_idx = c[k][j];
+    }
+  }
+
+  wf_bvh_options_t options = { .num_threads = 1, .max_leaf_size = 2 };
+  wf_bvh_t         serial;
+  assert_int_equal(wf_bvh_build(&grid, tris, 2 * N * N, &options, &serial),
+                   WF_SUCCESS);
+  options.num_threads = 4;
+  assert_int_equal(wf_bvh_build(&grid, tris, 2 * N * N, &options, &bvh),
+                   WF_SUCCESS);
+  assert_int_equal(bvh.triangle_count, 2 * N * N);
+  assert_int_equal(bvh.node_count, serial.node_count);
+  assert_memory_equal(bvh.nodes, serial.nodes,
+                      bvh.node_count * sizeof(wf_bvh_node_t));
+  assert_memory_equal(bvh.indices, serial.indices,
+                      bvh.triangle_count * sizeof(uint32_t));
+  assert_true(bvh.node_count < 2 * bvh.triangle_count);
+  for (size_t i = 0; i < bvh.node_count; i++)
+    assert_true(bvh.nodes[i].count <= 2);
+
+  for (int i = 0; i < 1000; i++) {
+    float x = (i * 37 % 997) * 0.1f + 0.05f;
+    float y = (i * 53 % 991) * 0.1f + 0.03f;
+    assert_true(wf_bvh_intersect(&bvh, (wf_vec3){ x, y, 10.0f }, down,
+                                 FLT_MAX, &hit));
+    assert_float_equal(hit.t, 10.0f, 1e-5f);
+    assert_int_equal(hit.triangle / 2, (int)y * N + (int)x);
+  }
+  wf_free_bvh(&serial);
+  wf_free_bvh(&bvh);
+  free(grid.vertices);
+  free(tris);
+}
+
+static void test_generate_normals(void** state) {
+  const char* cube = "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\n"
+                     "v -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n"
+                     "s 1\nf 1 2 3 4\nf 2 6 7 3\nf 6 5 8 7\n"
+                     "s %s\nf 5 1 4 8\nf 4 3 7 8\nf 5 6 2 1\n";
+  char        obj[512];
+
+  // One smoothing group: one normal per corner of the cube along the
+  // diagonal whatever the triangulation, inwards as the faces are wound
+  wf_normal_options_t options = { .weighting = WF_NORMAL_WEIGHT_ANGLE };
+  wf_scene_t*         scene   = *state;
+  snprintf(obj, sizeof(obj), cube, "1");
+  assert_int_equal(wf_load_obj_from_memory(obj, strlen(obj), scene, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(scene->objects->faces[0].smoothing_group, 1);
+  assert_int_equal(wf_scene_generate_normals(scene, &options), WF_SUCCESS);
+  assert_int_equal(scene->normal_count, 8);
+  for (size_t i = 0; i < scene->objects->face_count; i++) {
+    for (int j = 0; j < 3; j++) {
+      wf_vertex_index c = scene->objects->faces[i].vertices[j];
+      wf_vec3         p = scene->vertices[c.v_idx];
+      wf_vec3         n = scene->normals[c.vn_idx];
+      assert_float_equal(n.x, -p.x / sqrtf(3.0f), 1e-5f);
+      assert_float_equal(n.y, -p.y / sqrtf(3.0f), 1e-5f);
+      assert_float_equal(n.z, -p.z / sqrtf(3.0f), 1e-5f);
+    }
+  }
+  wf_free_scene(scene);
+
+  // Two groups meet at every corner
+  snprintf(obj, sizeof(obj), cube, "2");
+  assert_int_equal(wf_load_obj_from_memory(obj, strlen(obj), scene, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(wf_scene_generate_normals(scene, NULL), WF_SUCCESS);
+  assert_int_equal(scene->normal_count, 16);
+  wf_free_scene(scene);
+
+  // Flat faces get their face normal, and SoA scenes stay SoA
+  wf_parse_options_t parse;
+  wf_parse_options_init(&parse);
+  parse.soa_alignment = 16;
+  snprintf(obj, sizeof(obj), cube, "off");
+  assert_int_equal(wf_load_obj_from_memory(obj, strlen(obj), scene, &parse),
+                   WF_SUCCESS);
+  assert_int_equal(scene->objects->faces[6].smoothing_group, 0);
+  assert_int_equal(wf_scene_generate_normals(scene, &options), WF_SUCCESS);
+  assert_int_equal(scene->soa.alignment, 16);
+  assert_int_equal(scene->normal_count, 8 + 6);
+  const wf_face* top = &scene->objects->faces[8];
+  assert_int_equal(top->vertices[0].vn_idx, top->vertices[2].vn_idx);
+  assert_int_equal(top->vertices[0].vn_idx, 8 + 2);
+  assert_float_equal(wf_scene_normal(scene, 10).y, -1.0f, 1e-6f);
+  assert_float_equal(wf_scene_normal(scene, 10).x, 0.0f, 1e-6f);
+}
+
+static void test_optimize_mesh(void** state) {
+  // A 30 x 30 grid of quads listed in scrambled order, then a second object
+  enum { N = 30 };
+  size_t size = 64 * (N + 1) * (N + 1) + 64 * N * N;
+  char*  obj  = malloc(size);
+  size_t n    = 0;
+  assert_non_null(obj);
+  for (int y = 0; y <= N; y++) {
+    for (int x = 0; x <= N; x++)
+      n += snprintf(obj + n, size - n, "v %d %d 0\n", x, y);
+  }
+  n += snprintf(obj + n, size - n, "o grid\n");
+  for (int i = 0; i < N * N; i++) {
+    int q = i * 7919 % (N * N);
+    int v = q / N * (N + 1) + q % N + 1;
+    n += snprintf(obj + n, size - n, "f %d %d %d %d\n", v, v + 1, v + N + 2,
+                  v + N + 1);
+  }
+  n += snprintf(obj + n, size - n, "o tail\nf 1 2 3\n");
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj_from_memory(obj, n, scene, NULL), WF_SUCCESS);
+  free(obj);
+  wf_indexed_mesh_t mesh;
+  assert_int_equal(wf_scene_build_indexed_mesh(scene, NULL, &mesh),
+                   WF_SUCCESS);
+
+  wf_vec3 sum_before = { 0 };
+  for (size_t i = 0; i < mesh.index_count; i++) {
+    sum_before.x += mesh.vertices[mesh.indices[i]].position.x;
+    sum_before.y += mesh.vertices[mesh.indices[i]].position.y;
+  }
+
+  wf_mesh_cache_stats_t before, after, measured;
+  assert_int_equal(wf_indexed_mesh_optimize(&mesh, NULL, &before, &after),
+                   WF_SUCCESS);
+  assert_true(after.acmr < before.acmr);
+  assert_true(after.acmr < 0.8f);
+  assert_true(after.atvr >= 1.0f && after.atvr < before.atvr);
+  assert_int_equal(wf_indexed_mesh_cache_stats(&mesh, 0, &measured),
+                   WF_SUCCESS);
+  assert_memory_equal(&measured, &after, sizeof(after));
+
+  // Same triangles per group, vertices numbered by first use
+  assert_int_equal(mesh.group_count, 2);
+  assert_int_equal(mesh.groups[1].first_index, 6 * N * N);
+  wf_vec3  sum_after = { 0 };
+  uint32_t next      = 0;
+  for (size_t i = 0; i < mesh.index_count; i++) {
+    assert_true(mesh.indices[i] <= next);
+    if (mesh.indices[i] == next)
+      next++;
+    sum_after.x += mesh.vertices[mesh.indices[i]].position.x;
+    sum_after.y += mesh.vertices[mesh.indices[i]].position.y;
+  }
+  assert_float_equal(sum_after.x, sum_before.x, 0.0f);
+  assert_float_equal(sum_after.y, sum_before.y, 0.0f);
+  wf_free_indexed_mesh(&mesh);
+}
+
+static void test_quantize(void** state) {
+  const char obj[] = "v -1 0 2\nv 3 0.5 2\nv 0.25 -2 7\nv 1e-3 0 2\n"
+                     "vt 0 0\nvt 1 0.5\nvt 0.3 1\n"
+                     "vn 0 0 1\nvn 0.6 -0.8 0\nvn -1 -2 -3\nvn 0 0 0\n"
+                     "f 1/1/1 2/2/2 3/3/3\nf 1/1/1 3/3/3 4/1/4\n";
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj_from_memory(obj, sizeof(obj) - 1, scene, NULL),
+                   WF_SUCCESS);
+
+  wf_quantized_scene_t q;
+  assert_int_equal(wf_scene_quantize(scene, NULL, &q), WF_SUCCESS);
+  assert_int_equal(q.vertex_count, 4);
+  assert_int_equal(q.texcoord_count, 3);
+  assert_int_equal(q.normal_count, 4);
+  // Within a step of 16-bit fixed point across the widest extent (5)
+  assert_true(q.header.position_error <= 5.0f / 65535.0f);
+  assert_true(q.header.texcoord_error <= 1.0f / 65535.0f);
+  assert_true(q.header.normal_error < 1e-4f);
+  for (size_t i = 0; i < q.vertex_count; i++) {
+    wf_vec3 v = wf_scene_vertex(scene, i);
+    wf_vec3 d = wf_quantized_position(&q, i);
+    assert_float_equal(d.x, v.x, q.header.position_error);
+    assert_float_equal(d.y, v.y, q.header.position_error);
+    assert_float_equal(d.z, v.z, q.header.position_error);
+  }
+  // The box corners round-trip exactly
+  assert_float_equal(wf_quantized_position(&q, 0).x, -1.0f, 0.0f);
+  assert_float_equal(wf_quantized_position(&q, 2).z, 7.0f, 0.0f);
+  wf_vec3 t = wf_quantized_texcoord(&q, 2);
+  assert_float_equal(t.x, 0.3f, q.header.texcoord_error);
+  assert_float_equal(t.y, 1.0f, 0.0f);
+  wf_vec3 n = wf_quantized_normal(&q, 2);
+  float   s = sqrtf(14.0f);
+  assert_float_equal(n.x, -1.0f / s, 1e-4f);
+  assert_float_equal(n.y, -2.0f / s, 1e-4f);
+  assert_float_equal(n.z, -3.0f / s, 1e-4f);
+  n = wf_quantized_normal(&q, 3);
+  assert_float_equal(n.z, 1.0f, 0.0f);
+  wf_free_quantized_scene(&q);
+
+  // Half floats keep small coordinates precise, and work on SoA scenes
+  wf_quantize_options_t options = { WF_POSITION_HALF, WF_TEXCOORD_HALF };
+  assert_int_equal(wf_scene_convert_to_soa(scene, 32), WF_SUCCESS);
+  assert_int_equal(wf_scene_quantize(scene, &options, &q), WF_SUCCESS);
+  assert_true(q.header.position_error <= 7.0f / 2048.0f);
+  assert_float_equal(wf_quantized_position(&q, 3).x, 1e-3f, 1e-6f);
+  assert_float_equal(wf_quantized_position(&q, 1).y, 0.5f, 0.0f);
+  assert_float_equal(wf_quantized_texcoord(&q, 2).x, 0.3f, 1.0f / 4096.0f);
+  wf_free_quantized_scene(&q);
+}
+
+// Test: Index buffers and packed binary scene faces round-trip exactly
+static void test_index_codec(void** state) {
+  // Optimized grid, then arbitrary values including -1
+  enum { N = 40 };
+  char*  obj  = malloc(64 * (N + 1) * (N + 1) + 64 * N * N);
+  size_t n    = 0;
+  assert_non_null(obj);
+  for (int y = 0; y <= N; y++) {
+    for (int x = 0; x <= N; x++)
+      n += sprintf(obj + n, "v %d %d 0\nvt 0 %d\n", x, y, x % 3);
+  }
+  n += sprintf(obj + n, "s 1\n");
+  for (int i = 0; i < N * N; i++) {
+    int v = i / N * (N + 1) + i % N + 1;
+    if (i == N * N / 2)
+      n += sprintf(obj + n, "s off\nusemtl half\n");
+    n += sprintf(obj + n, "f %d/%d %d/%d %d/%d %d/%d\n", v, v, v + 1, v + 1,
+                 v + N + 2, v + N + 2, v + N + 1, v + N + 1);
+  }
+  n += sprintf(obj + n, "o normals\nvn 0 0 1\nf 1//1 2//1 3//1\n");
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj_from_memory(obj, n, scene, NULL), WF_SUCCESS);
+  free(obj);
+  wf_indexed_mesh_t mesh;
+  assert_int_equal(wf_scene_build_indexed_mesh(scene, NULL, &mesh),
+                   WF_SUCCESS);
+  assert_int_equal(wf_indexed_mesh_optimize(&mesh, NULL, NULL, NULL),
+                   WF_SUCCESS);
+
+  size_t         bound   = wf_index_buffer_bound(mesh.index_count);
+  unsigned char* data    = malloc(bound);
+  uint32_t*      decoded = malloc(mesh.index_count * sizeof(uint32_t));
+  size_t         size;
+  assert_int_equal(wf_encode_index_buffer(mesh.indices, mesh.index_count,
+                                          data, bound, &size),
+                   WF_SUCCESS);
+  assert_true(size * 5 < mesh.index_count * sizeof(uint32_t));
+  assert_int_equal(wf_decode_index_buffer(data, size, decoded,
+                                          mesh.index_count),
+                   WF_SUCCESS);
+  assert_memory_equal(decoded, mesh.indices,
+                      mesh.index_count * sizeof(uint32_t));
+  assert_int_equal(wf_decode_index_buffer(data, size - 1, decoded,
+                                          mesh.index_count),
+                   WF_ERROR_INVALID_FORMAT);
+  assert_int_equal(wf_decode_index_buffer(data, size, decoded,
+                                          mesh.index_count - 3),
+                   WF_ERROR_INVALID_FORMAT);
+
+  uint32_t any[12] = { 7, 7, 7, UINT32_MAX, 0, 5, 0, 5, 1u << 31, 5, 0, 9 };
+  assert_int_equal(wf_encode_index_buffer(any, 12, data, bound, &size),
+                   WF_SUCCESS);
+  assert_int_equal(wf_decode_index_buffer(data, size, decoded, 12),
+                   WF_SUCCESS);
+  assert_memory_equal(decoded, any, sizeof(any));
+  free(data);
+  free(decoded);
+  wf_free_indexed_mesh(&mesh);
+
+  // Packed binary scenes load like plain ones
+  wf_binary_options_t options;
+  wf_binary_options_init(&options);
+  options.compress_faces = 1;
+  assert_int_equal(
+      wf_save_scene_binary(scene, "test_data/packed.wfscene", &options),
+      WF_SUCCESS);
+  for (int mmap = 0; mmap < 2; mmap++) {
+    options.use_mmap = mmap;
+    wf_scene_t loaded;
+    assert_int_equal(
+        wf_load_scene_binary("test_data/packed.wfscene", &loaded, &options),
+        WF_SUCCESS);
+    assert_scenes_equal(scene, &loaded);
+    const wf_object_t* b = loaded.objects;
+    for (const wf_object_t* a = scene->objects; a; a = a->next, b = b->next) {
+      for (size_t i = 0; i < a->face_count; i++)
+        assert_int_equal(a->faces[i].material_idx, b->faces[i].material_idx);
+    }
+    wf_free_scene(&loaded);
+  }
+
+  // Face materials are rebuilt from the material runs
+  wf_scene_t plain, loaded;
+  create_test_file("test_data/packed.obj", "mtllib cube.mtl\n"
+                                           "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                                           "f 1 2 3\nusemtl white\nf 3 2 1\n");
+  assert_int_equal(wf_load_obj("test_data/packed.obj", &plain, NULL),
+                   WF_SUCCESS);
+  assert_int_equal(
+      wf_save_scene_binary(&plain, "test_data/packed.wfscene", &options),
+      WF_SUCCESS);
+  assert_int_equal(
+      wf_load_scene_binary("test_data/packed.wfscene", &loaded, &options),
+      WF_SUCCESS);
+  assert_scenes_equal(&plain, &loaded);
+  assert_int_equal(loaded.objects->faces[0].material_idx, (size_t)-1);
+  assert_int_equal(loaded.objects->faces[1].material_idx, 0);
+  wf_free_scene(&plain);
+  wf_free_scene(&loaded);
+}
+
+// Test: The push parser matches a one-shot parse however the data is split
+static void test_push_parser(void** state) {
+  const char obj[] = "# pieces\nv 0 0 0\nv 1 0 0\r\nv 1 1 0\nv 0 1 0\n"
+                     "vt 0 0\nvn 0 0 1\n\no quad\ns 1\n"
+                     "f 1/1/1 2/1/1 3/1/1 4/1/1\ng tail\nf -1 -2 -3";
+  const size_t size  = sizeof(obj) - 1;
+  wf_scene_t*  scene = *state;
+  assert_int_equal(wf_load_obj_from_memory(obj, size, scene, NULL),
+                   WF_SUCCESS);
+
+  for (size_t piece = 1; piece <= 9; piece++) {
+    wf_scene_t        pushed = { 0 };
+    wf_push_parser_t* parser = wf_obj_parser_create(&pushed, NULL);
+    assert_non_null(parser);
+    for (size_t i = 0; i < size; i += piece) {
+      size_t n = size - i < piece ? size - i : piece;
+      assert_int_equal(wf_obj_parser_feed(parser, obj + i, n), WF_SUCCESS);
+    }
+    assert_int_equal(wf_obj_parser_finish(parser), WF_SUCCESS);
+    assert_scenes_equal(scene, &pushed);
+    assert_non_null(wf_scene_find_object(&pushed, "tail"));
+    wf_free_scene(&pushed);
+  }
+
+  // Appending to a populated SoA scene with bounds
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.soa_alignment  = 16;
+  options.compute_bounds = 1;
+  wf_scene_t appended;
+  assert_int_equal(wf_load_obj_from_memory(obj, size, &appended, &options),
+                   WF_SUCCESS);
+  wf_push_parser_t* parser = wf_obj_parser_create(&appended, NULL);
+  assert_non_null(parser);
+  const char more[] = "v 5 -1 2\nf 1 -1 2\n";
+  assert_int_equal(wf_obj_parser_feed(parser, more, sizeof(more) - 1),
+                   WF_SUCCESS);
+  assert_int_equal(wf_obj_parser_finish(parser), WF_SUCCESS);
+  assert_int_equal(appended.vertex_count, 5);
+  assert_int_equal(appended.soa.alignment, 16);
+  assert_float_equal(wf_scene_vertex(&appended, 4).x, 5.0f, 0.0f);
+  assert_float_equal(appended.bounds.max.x, 5.0f, 0.0f);
+  assert_float_equal(appended.bounds.min.y, -1.0f, 0.0f);
+  const wf_object_t* last = appended.objects->next->next;
+  assert_non_null(last);
+  assert_null(last->name);
+  assert_int_equal(last->face_count, 1);
+  assert_int_equal(last->faces[0].vertices[1].v_idx, 4);
+  wf_free_scene(&appended);
+
+  // Errors stick until finish
+  wf_scene_t strict = { 0 };
+  options.strict_mode = 1;
+  parser              = wf_obj_parser_create(&strict, &options);
+  assert_non_null(parser);
+  assert_int_equal(wf_obj_parser_feed(parser, "v 0 0 0\nbogus", 13),
+                   WF_SUCCESS);
+  assert_int_equal(wf_obj_parser_feed(parser, " 1\nv 1 1 1\n", 11),
+                   WF_ERROR_UNSUPPORTED_FEATURE);
+  assert_int_equal(wf_obj_parser_feed(parser, "v 2 2 2\n", 8),
+                   WF_ERROR_UNSUPPORTED_FEATURE);
+  assert_int_equal(wf_obj_parser_finish(parser), WF_ERROR_UNSUPPORTED_FEATURE);
+  assert_int_equal(strict.vertex_count, 1);
+  assert_non_null(wf_get_error(&strict));
+  wf_free_scene(&strict);
+}
+
+static void count_load(void* user, wf_error_t result, wf_scene_t* scene) {
+  int* calls = (int*)user;
+  (*calls)++;
+  if (result == WF_SUCCESS)
+    assert_int_equal(scene->vertex_count, 3000);
+}
+
+// Test: Background loads match wf_load_obj and can be cancelled
+static void test_async_load(void** state) {
+  FILE* f = fopen("test_data/async.obj", "w");
+  assert_non_null(f);
+  for (int i = 0; i < 3000; i++)
+    fprintf(f, "v %d 0 0\n", i);
+  for (int i = 0; i < 1000; i++)
+    fprintf(f, "f %d %d %d\n", 3 * i + 1, 3 * i + 2, 3 * i + 3);
+  fclose(f);
+
+  wf_scene_t* scene = *state;
+  assert_int_equal(wf_load_obj("test_data/async.obj", scene, NULL),
+                   WF_SUCCESS);
+
+  int        calls = 0;
+  wf_load_t* load =
+      wf_load_obj_async("test_data/async.obj", NULL, count_load, &calls);
+  assert_non_null(load);
+  while (!wf_load_poll(load))
+    ;
+  assert_int_equal(calls, 1);
+  wf_scene_t loaded;
+  assert_int_equal(wf_load_wait(load, &loaded), WF_SUCCESS);
+  assert_scenes_equal(scene, &loaded);
+  wf_free_scene(&loaded);
+
+  // Several loads at once, one released without taking its scene
+  wf_load_t* loads[4];
+  for (int i = 0; i < 4; i++) {
+    loads[i] = wf_load_obj_async("test_data/async.obj", NULL, NULL, NULL);
+    assert_non_null(loads[i]);
+  }
+  assert_int_equal(wf_load_wait(loads[0], NULL), WF_SUCCESS);
+  for (int i = 1; i < 4; i++) {
+    assert_int_equal(wf_load_wait(loads[i], &loaded), WF_SUCCESS);
+    assert_int_equal(loaded.objects->face_count, 1000);
+    wf_free_scene(&loaded);
+  }
+
+#ifndef _WIN32
+  // A cancelled load keeps only the reason. Reading from a pipe, the parse
+  // cannot get past line 2000 before the cancel.
+  remove("test_data/async.fifo");
+  assert_int_equal(mkfifo("test_data/async.fifo", 0600), 0);
+  calls = 0;
+  load  = wf_load_obj_async("test_data/async.fifo", NULL, count_load, &calls);
+  assert_non_null(load);
+  f = fopen("test_data/async.fifo", "w");
+  assert_non_null(f);
+  for (int i = 0; i < 2000; i++)
+    fprintf(f, "v %d 0 0\n", i);
+  fflush(f);
+  wf_load_cancel(load);
+  for (int i = 0; i < 100; i++)
+    fputs("v 1 0 0\n", f);
+  fclose(f);
+  assert_int_equal(wf_load_wait(load, &loaded), WF_ERROR_CANCELLED);
+  assert_int_equal(calls, 1);
+  assert_int_equal(loaded.vertex_count, 0);
+  assert_null(loaded.objects);
+  assert_non_null(wf_get_error(&loaded));
+  wf_free_scene(&loaded);
+#endif
+
+  // The parse loop itself stops within 1024 lines
+  volatile int       cancel = 1;
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  options.cancel = &cancel;
+  for (int mmap = 0; mmap < 2; mmap++) {
+    options.use_mmap = mmap;
+    assert_int_equal(wf_load_obj("test_data/async.obj", &loaded, &options),
+                     WF_ERROR_CANCELLED);
+    assert_true(loaded.vertex_count < 1024);
+    wf_free_scene(&loaded);
+  }
+}
+
+static void test_mtl_cache(void** state) {
+  create_test_file("test_data/cached.obj", "mtllib cached.mtl\n"
+                                           "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                                           "usemtl red\nf 1 2 3\n");
+  create_test_file("test_data/cached.mtl", "newmtl red\nKd 1 0 0\n"
+                                           "map_Kd red.png\n"
+                                           "newmtl blue\nKd 0 0 1\n");
+  wf_mtl_cache_clear();
+
+  wf_scene_t*        scene = *state;
+  wf_parse_options_t options;
+  wf_parse_options_init(&options);
+  assert_int_equal(wf_load_obj("test_data/cached.obj", scene, &options),
+                   WF_SUCCESS);
+  options.use_mtl_cache = 1;
+
+  // The first load parses, the others copy, from the heap or an arena
+  wf_mtl_cache_stats_t stats;
+  wf_scene_t           cached[3];
+  for (int i = 0; i < 3; i++) {
+    options.use_arena = i == 2;
+    assert_int_equal(wf_load_obj("test_data/cached.obj", &cached[i],
+                                 &options),
+                     WF_SUCCESS);
+    assert_int_equal(cached[i].material_count, scene->material_count);
+    for (size_t m = 0; m < scene->material_count; m++) {
+      const wf_material_t* a = &scene->materials[m];
+      const wf_material_t* b = &cached[i].materials[m];
+      assert_string_equal(a->name, b->name);
+      assert_true(a->Kd.x == b->Kd.x && a->Kd.z == b->Kd.z);
+      assert_true(!a->map_Kd || strcmp(a->map_Kd, b->map_Kd) == 0);
+    }
+    assert_int_equal(cached[i].objects->material_idx, 0);
+  }
+  wf_mtl_cache_get_stats(&stats);
+  assert_int_equal(stats.entries, 1);
+  assert_int_equal(stats.misses, 1);
+  assert_int_equal(stats.hits, 2);
+
+  // Copies outlive the cache
+  wf_mtl_cache_clear();
+  wf_mtl_cache_get_stats(&stats);
+  assert_int_equal(stats.entries + stats.hits + stats.misses, 0);
+  assert_string_equal(cached[1].materials[0].map_Kd, "red.png");
+  for (int i = 0; i < 3; i++)
+    wf_free_scene(&cached[i]);
+
+  // A changed file is parsed again
+  options.use_arena = 0;
+  assert_int_equal(wf_load_obj("test_data/cached.obj", &cached[0], &options),
+                   WF_SUCCESS);
+  wf_free_scene(&cached[0]);
+  create_test_file("test_data/cached.mtl", "newmtl red\nKd 0.5 0 0\n");
+  assert_int_equal(wf_load_obj("test_data/cached.obj", &cached[0], &options),
+                   WF_SUCCESS);
+  assert_int_equal(cached[0].material_count, 1);
+  assert_true(cached[0].materials[0].Kd.x == 0.5f);
+  wf_free_scene(&cached[0]);
+  wf_mtl_cache_get_stats(&stats);
+  assert_int_equal(stats.entries, 1);
+  assert_int_equal(stats.misses, 2);
+  wf_mtl_cache_clear();
+}
+
+// Test: Objects of a scene assembled by hand have faces but no material
+// runs; all their faces take the object's material
+static void test_hand_built_scene(void** state) {
+  (void)state;
+  wf_vec3       vertices[4] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 },
+                                { 0, 1, 0 } };
+  wf_material_t material    = { .name = "white" };
+  wf_face       faces[2]    = { { { { 0, -1, -1 }, { 1, -1, -1 },
+                                    { 2, -1, -1 } } },
+                                { { { 0, -1, -1 }, { 2, -1, -1 },
+                                    { 3, -1, -1 } } } };
+  wf_object_t   object      = { .name         = "quad",
+                                .faces        = faces,
+                                .face_count   = 2,
+                                .material_idx = 0 };
+  wf_scene_t    scene       = { 0 };
+  scene.vertices            = vertices;
+  scene.vertex_count        = 4;
+  scene.materials           = &material;
+  scene.material_count      = 1;
+  scene.objects             = &object;
+
+  wf_indexed_mesh_t mesh;
+  assert_int_equal(wf_scene_build_indexed_mesh(&scene, NULL, &mesh),
+                   WF_SUCCESS);
+  assert_int_equal(mesh.vertex_count, 4);
+  assert_int_equal(mesh.index_count, 6);
+  assert_int_equal(mesh.group_count, 1);
+  assert_int_equal(mesh.groups[0].material_idx, 0);
+  wf_free_indexed_mesh(&mesh);
+
+  wf_mesh_options_t options = { .by_material = 1 };
+  assert_int_equal(wf_scene_build_indexed_mesh(&scene, &options, &mesh),
+                   WF_SUCCESS);
+  assert_int_equal(mesh.index_count, 6);
+  assert_int_equal(mesh.groups[0].material_idx, 0);
+  wf_free_indexed_mesh(&mesh);
+
+  wf_face*             tris;
+  size_t               tri_count, batch_count;
+  wf_material_batch_t* batches;
+  assert_int_equal(wf_scene_triangles_by_material(&scene, &tris, &tri_count,
+                                                  &batches, &batch_count),
+                   WF_SUCCESS);
+  assert_int_equal(tri_count, 2);
+  assert_int_equal(batch_count, 1);
+  assert_int_equal(batches[0].material_idx, 0);
+  assert_int_equal(tris[1].vertices[2].v_idx, 3);
+  free(tris);
+  free(batches);
+}
+
 int main(void) {
-  log_init(LOG_LEVEL_FATAL); // Quiet logging for tests
-  // log_init(LOG_LEVEL_DEBUG); // Quiet logging for tests
+  wf_set_log_callback(NULL, NULL); // Quiet logging for tests
 
   const struct CMUnitTest tests[] = {
     cmocka_unit_test_setup_teardown(test_load_basic_obj, setup_test_scene,
@@ -211,6 +1776,57 @@ int main(void) {
     cmocka_unit_test(test_file_not_found),
     cmocka_unit_test_setup_teardown(test_invalid_face, setup_test_scene,
                                     teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_mmap_matches_stdio, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_parallel_matches_serial,
+                                    setup_test_scene, teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_float_parsing, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_face_formats, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_presize, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_arena_scene, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_log_callback, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_parse_stream, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_load_from_memory, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_keyword_boundaries, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_indexed_mesh, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_soa_layout, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_material_runs, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_binary_scene, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_find_object, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_find_material, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_bounds, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_bvh, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_generate_normals, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_optimize_mesh, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_quantize, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_index_codec, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_push_parser, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_async_load, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test_setup_teardown(test_mtl_cache, setup_test_scene,
+                                    teardown_test_scene),
+    cmocka_unit_test(test_hand_built_scene),
   };
 
   return cmocka_run_group_tests(tests, NULL, NULL);